@@ -0,0 +1,374 @@
+/**
+ * @file  benchmark.cpp
+ * @brief Implementation of the microbenchmark harness.
+ */
+
+#include "benchmark.hpp"
+#include "exceptions.hpp"
+#include "alloc_tracker.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <fstream>
+#include <algorithm>
+
+
+#ifndef TRACK_ALLOCS
+
+namespace
+{
+
+long long allocCount = 0;
+long long allocBytes = 0;
+
+} // namespace
+
+
+// Global allocator replacements counting every allocation of the process. With
+// `TRACK_ALLOCS` defined, the game replaces them itself (see `AllocTracker`)
+
+void *operator new (std::size_t size)
+{
+    ++allocCount;
+    allocBytes += size;
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[] (std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete (void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[] (void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete (void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[] (void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+
+long long process_alloc_count ()
+{
+    return allocCount;
+}
+
+long long process_alloc_bytes ()
+{
+    return allocBytes;
+}
+
+#else
+
+long long process_alloc_count ()
+{
+    return AllocTracker::get_total_allocs();
+}
+
+long long process_alloc_bytes ()
+{
+    return AllocTracker::get_total_bytes();
+}
+
+#endif
+
+
+BenchState::BenchState (long long iterations, PerfCounters *counters)
+    : iterations(iterations)
+    , counters(counters)
+    , paused(true)
+    , elapsedNs(0)
+    , allocsStart(0), allocBytesStart(0)
+    , allocs(0), allocBytes(0)
+{}
+
+long long BenchState::get_iterations () const
+{
+    return iterations;
+}
+
+void BenchState::pause_timing ()
+{
+    if (!paused)
+    {
+        elapsedNs += std::chrono::duration<double, std::nano>(
+            Clock::now() - start
+        ).count();
+        if (counters)
+        {
+            counters->disable();
+        }
+        allocs += process_alloc_count() - allocsStart;
+        allocBytes += process_alloc_bytes() - allocBytesStart;
+        paused = true;
+    }
+}
+
+void BenchState::resume_timing ()
+{
+    if (paused)
+    {
+        paused = false;
+        allocsStart = process_alloc_count();
+        allocBytesStart = process_alloc_bytes();
+        if (counters)
+        {
+            counters->enable();
+        }
+        start = Clock::now();
+    }
+}
+
+double BenchState::get_elapsed_ns () const
+{
+    return elapsedNs;
+}
+
+long long BenchState::get_allocs () const
+{
+    return allocs;
+}
+
+long long BenchState::get_alloc_bytes () const
+{
+    return allocBytes;
+}
+
+
+void BenchmarkRunner::add (const std::string &name, BenchFunction function)
+{
+    benchmarks.push_back({name, function});
+}
+
+void BenchmarkRunner::run (const std::string &filter, int repetitions)
+{
+    countersAvailable = counters.init();
+    if (!countersAvailable)
+    {
+        printf("Hardware counters unavailable (%s)\n", counters.get_error().c_str());
+    }
+
+    for (const auto &benchmark : benchmarks)
+    {
+        if (benchmark.first.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        // Grow the iteration count until a repetition takes long enough
+        long long iterations = 1;
+        BenchState state = run_once(benchmark.second, iterations);
+        while (state.get_elapsed_ns() < MIN_REPETITION_NS && iterations < (1LL << 40))
+        {
+            double perOp = state.get_elapsed_ns() / iterations;
+            long long needed = perOp > 0 ? MIN_REPETITION_NS / perOp * 1.2 : 0;
+            iterations = std::max(iterations * 2, std::min(needed, iterations * 100));
+            state = run_once(benchmark.second, iterations);
+        }
+
+        std::vector<double> perOp;
+        long long allocs = 0, bytes = 0;
+        long long counts[PerfCounters::COUNTERS_TOTAL] = {};
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            long long repCounts[PerfCounters::COUNTERS_TOTAL];
+            state = run_once(benchmark.second, iterations, repCounts);
+            perOp.push_back(state.get_elapsed_ns() / iterations);
+            allocs += state.get_allocs();
+            bytes += state.get_alloc_bytes();
+            for (int counter = 0; counter < PerfCounters::COUNTERS_TOTAL; ++counter)
+            {
+                counts[counter] = counts[counter] < 0 || repCounts[counter] < 0
+                    ? -1 : counts[counter] + repCounts[counter];
+            }
+        }
+
+        BenchResult result;
+        result.name = benchmark.first;
+        result.iterations = iterations;
+        result.repetitions = repetitions;
+
+        double sum = 0;
+        for (double ns : perOp)
+        {
+            sum += ns;
+        }
+        result.meanNs = sum / repetitions;
+
+        double squares = 0;
+        for (double ns : perOp)
+        {
+            squares += (ns - result.meanNs) * (ns - result.meanNs);
+        }
+        result.stddevNs = repetitions > 1
+            ? std::sqrt(squares / (repetitions - 1)) : 0;
+
+        std::sort(perOp.begin(), perOp.end());
+        result.medianNs = perOp[repetitions / 2];
+        result.minNs = perOp.front();
+        result.maxNs = perOp.back();
+
+        result.allocsPerOp = double(allocs) / (iterations * repetitions);
+        result.allocBytesPerOp = double(bytes) / (iterations * repetitions);
+
+        for (int counter = 0; counter < PerfCounters::COUNTERS_TOTAL; ++counter)
+        {
+            result.countsPerOp[counter] = counts[counter] < 0
+                ? -1 : double(counts[counter]) / (iterations * repetitions);
+        }
+        long long cycles = counts[PerfCounters::CYCLES];
+        long long instructions = counts[PerfCounters::INSTRUCTIONS];
+        result.ipc = cycles > 0 && instructions >= 0
+            ? double(instructions) / cycles : -1;
+
+        results.push_back(result);
+
+        printf(
+            "%-40s %12.1f ns/op\n", result.name.c_str(), result.medianNs
+        );
+        fflush(stdout);
+    }
+
+    counters.free();
+}
+
+const std::vector<BenchResult> &BenchmarkRunner::get_results () const
+{
+    return results;
+}
+
+void BenchmarkRunner::print_results () const
+{
+    printf(
+        "\n%-32s %11s %11s %9s %9s %9s %6s %9s %9s %9s\n",
+        "benchmark", "median ns", "mean ns", "stddev %", "allocs/op", "bytes/op",
+        "IPC", "L1D m/op", "LLC m/op", "br m/op"
+    );
+    for (const BenchResult &result : results)
+    {
+        printf(
+            "%-32s %11.1f %11.1f %9.2f %9.2f %9.1f",
+            result.name.c_str(), result.medianNs, result.meanNs,
+            result.meanNs > 0 ? 100 * result.stddevNs / result.meanNs : 0,
+            result.allocsPerOp, result.allocBytesPerOp
+        );
+        if (result.ipc < 0)
+        {
+            printf(" %6s", "-");
+        }
+        else
+        {
+            printf(" %6.2f", result.ipc);
+        }
+        for (
+            PerfCounters::Counter counter :
+            {PerfCounters::L1D_MISSES, PerfCounters::LLC_MISSES,
+                PerfCounters::BRANCH_MISSES}
+        )
+        {
+            if (result.countsPerOp[counter] < 0)
+            {
+                printf(" %9s", "-");
+            }
+            else
+            {
+                printf(" %9.3f", result.countsPerOp[counter]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+void BenchmarkRunner::write_json (const std::string &path) const
+{
+    std::ofstream fout(path);
+    if (fout.fail())
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    fout << "{\n  \"benchmarks\": [\n";
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        const BenchResult &result = results[i];
+        fout << "    {\"name\": \"" << result.name << "\""
+            << ", \"iterations\": " << result.iterations
+            << ", \"repetitions\": " << result.repetitions
+            << ", \"median_ns\": " << result.medianNs
+            << ", \"mean_ns\": " << result.meanNs
+            << ", \"stddev_ns\": " << result.stddevNs
+            << ", \"min_ns\": " << result.minNs
+            << ", \"max_ns\": " << result.maxNs
+            << ", \"allocs_per_op\": " << result.allocsPerOp
+            << ", \"bytes_per_op\": " << result.allocBytesPerOp;
+        for (int counter = 0; counter < PerfCounters::COUNTERS_TOTAL; ++counter)
+        {
+            fout << ", \"" << PerfCounters::get_name(PerfCounters::Counter(counter))
+                << "_per_op\": ";
+            if (result.countsPerOp[counter] < 0)
+            {
+                fout << "null";
+            }
+            else
+            {
+                fout << result.countsPerOp[counter];
+            }
+        }
+        fout << ", \"ipc\": ";
+        if (result.ipc < 0)
+        {
+            fout << "null";
+        }
+        else
+        {
+            fout << result.ipc;
+        }
+        fout << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    fout << "  ]\n}\n";
+
+    if (fout.fail())
+    {
+        std::string msg = "Could not write to \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+}
+
+BenchState BenchmarkRunner::run_once (
+    BenchFunction function, long long iterations,
+    long long counts[PerfCounters::COUNTERS_TOTAL]
+)
+{
+    BenchState state(iterations, counts && countersAvailable ? &counters : nullptr);
+    if (counts)
+    {
+        counters.reset();
+    }
+    state.resume_timing();
+    function(state);
+    state.pause_timing();
+    if (counts)
+    {
+        counters.read(counts);
+    }
+    return state;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file  benchmark.hpp
+ * @brief Include file for the microbenchmark harness.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+
+#include "perf_counters.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+/**
+ * @brief Timing state passed to a benchmark function.
+ * @example
+ *
+ *     void bench_something (BenchState &state)
+ *     {
+ *         for (long long i = 0; i < state.get_iterations(); ++i)
+ *         {
+ *             state.pause_timing();
+ *             // Setup that should not be measured
+ *             state.resume_timing();
+ *             // Measured code
+ *         }
+ *     }
+ */
+class BenchState
+{
+public:
+    /**
+     * @brief Set the amount of iterations the benchmark function must do.
+     * @param iterations The amount of iterations.
+     * @param counters Hardware counters to enable while measuring; `nullptr` to
+     *     not count.
+     */
+    BenchState(long long iterations, PerfCounters *counters);
+
+    /// Get the amount of iterations the benchmark function must do.
+    long long get_iterations() const;
+
+    /// Stop measuring time, allocations and counters until `resume_timing` is called.
+    void pause_timing();
+
+    /// Continue measuring time, allocations and counters.
+    void resume_timing();
+
+    /// Get total measured time in ns.
+    double get_elapsed_ns() const;
+
+    /// Get the amount of allocations made while measuring.
+    long long get_allocs() const;
+
+    /// Get the amount of bytes allocated while measuring.
+    long long get_alloc_bytes() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    long long iterations;
+    PerfCounters *counters;
+    bool paused;
+    Clock::time_point start;
+    double elapsedNs;
+    long long allocsStart, allocBytesStart;
+    long long allocs, allocBytes;
+};
+
+/// A benchmark function.
+using BenchFunction = void (*)(BenchState &state);
+
+/// Measurement summary of a single benchmark.
+struct BenchResult
+{
+    std::string name;
+    long long iterations; // Iterations per repetition.
+    int repetitions;
+    double meanNs, medianNs, minNs, maxNs; // Per operation.
+    double stddevNs; // Standard deviation of per operation time between repetitions.
+    double allocsPerOp, allocBytesPerOp;
+
+    /// Hardware counter values per operation; negative if unavailable.
+    double countsPerOp[PerfCounters::COUNTERS_TOTAL];
+    double ipc; // Instructions per cycle; negative if unavailable.
+};
+
+/**
+ * @brief Runs registered benchmarks and reports the results.
+ * @details
+ * Each benchmark is calibrated so that a repetition takes at least
+ * `MIN_REPETITION_NS`, then run `repetitions` times. Per operation time statistics
+ * are computed over the repetitions. Hardware counters are summed over the
+ * repetitions when available.
+ */
+class BenchmarkRunner
+{
+public:
+    /// Minimum time a single repetition should take.
+    static constexpr double MIN_REPETITION_NS = 5e6;
+
+    /// Register `function` under `name`.
+    void add(const std::string &name, BenchFunction function);
+
+    /**
+     * @brief Run the benchmarks.
+     * @param filter Only run benchmarks with names containing `filter`.
+     * @param repetitions Amount of measured repetitions.
+     */
+    void run(const std::string &filter, int repetitions);
+
+    /// Print a results table to stdout.
+    void print_results() const;
+
+    /// Get the results of the benchmarks run so far.
+    const std::vector<BenchResult> &get_results() const;
+
+    /**
+     * @brief Write the results to `path` in JSON.
+     * @throws `ExceptionFile` thrown if `path` could not be written.
+     */
+    void write_json(const std::string &path) const;
+
+private:
+    /**
+     * @brief Run `function` with `iterations`.
+     * @param function The benchmark function.
+     * @param iterations The amount of iterations.
+     * @param[out] counts Counter values of the run; `nullptr` to not count.
+     * @return The state after the run.
+     */
+    BenchState run_once(
+        BenchFunction function, long long iterations,
+        long long counts[PerfCounters::COUNTERS_TOTAL]=nullptr
+    );
+
+    PerfCounters counters;
+    bool countersAvailable = false;
+
+    std::vector<std::pair<std::string, BenchFunction>> benchmarks;
+    std::vector<BenchResult> results;
+};
+
+/// Get the amount of allocations made by the process so far.
+long long process_alloc_count();
+
+/// Get the amount of bytes allocated by the process so far.
+long long process_alloc_bytes();
+
+/**
+ * @brief Prevent the compiler from optimizing away a computed `value`.
+ * @note Should be used on results of benchmarked code that are not used otherwise.
+ */
+template <typename T>
+inline void do_not_optimize (const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+
+#endif
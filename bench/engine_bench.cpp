@@ -0,0 +1,644 @@
+/**
+ * @file  engine_bench.cpp
+ * @brief Microbenchmarks for the tetris engine hot paths.
+ * @details
+ * Usage: `bench [--filter <substring>] [--reps <repetitions>] [--out <path>]
+ * [--check-allocs]`.
+ * Results are printed to stdout and written in JSON to `bench_results.json` or to
+ * the path given with `--out`. Has to be run from the game directory as it loads
+ * the game schemes, textures and font.
+ *
+ * With `--check-allocs`, exits with 1 if any `steady_state/` benchmark, which runs
+ * whole gameplay frames, allocated. Gameplay frames are expected not to allocate at
+ * all; see `ALLOC_FRAME_BUDGET`.
+ */
+
+#include "benchmark.hpp"
+#include "game.hpp"
+#include "window.hpp"
+#include "renderer.hpp"
+#include "font.hpp"
+#include "texture.hpp"
+#include "key_layout.hpp"
+#include "tetris_field.hpp"
+#include "tetrimino.hpp"
+#include "tetris_layout.hpp"
+#include "text.hpp"
+#include "timer.hpp"
+#include "flight_recorder.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+
+
+/**
+ * @brief Gives the benchmarks access to engine internals.
+ * @note Declared a friend of `Tetrimino`, `TetrisField` and `TetrisLayout`.
+ */
+class EngineBench
+{
+public:
+    /// Initialize the objects shared by all benchmarks.
+    static void init();
+
+    /// Free the shared objects.
+    static void free();
+
+    /// Register all benchmarks with `runner`.
+    static void add_benchmarks(BenchmarkRunner &runner);
+
+    /// Name prefix of the benchmarks running whole gameplay frames.
+    static constexpr const char *STEADY_STATE_PREFIX = "steady_state/";
+
+private:
+    /// Amount of fields prepared at once for benchmarks that consume their fields.
+    static constexpr int FIELD_BATCH = 64;
+
+    /// Remove all blocks from `field`.
+    static void empty_field(TetrisField &field);
+
+    /**
+     * @brief Fill `field` from the bottom.
+     * @param fullRows Amount of rows with every cell filled.
+     * @param gapRows Amount of rows with a single empty cell above the full rows.
+     */
+    static void fill_field(TetrisField &field, int fullRows, int gapRows);
+
+    /// Start a new game in `layout`.
+    static void reset_layout();
+
+    /// Prepare `FIELD_BATCH` fields for clearing and clear them.
+    template <int fullRows, int gapRows>
+    static void bench_clear_lines(BenchState &state);
+
+    static void bench_rotate_free(BenchState &state);
+    static void bench_rotate_kick(BenchState &state);
+    static void bench_rotate_blocked(BenchState &state);
+    static void bench_collision_left(BenchState &state);
+    static void bench_collision_right(BenchState &state);
+    static void bench_collision_bottom(BenchState &state);
+    static void bench_drop_empty(BenchState &state);
+    static void bench_drop_stack(BenchState &state);
+    static void bench_spawn_stop(BenchState &state);
+    static void bench_render_config(BenchState &state);
+    static void bench_fit_font(BenchState &state);
+    static void bench_steady_state_frame(BenchState &state);
+    static void bench_steady_state_clear(BenchState &state);
+    static void bench_flight_recorder_tick(BenchState &state);
+
+    static Game game;
+    static Window window;
+    static Renderer renderer;
+    static Font font;
+    static Texture blockTextureSheet;
+    static KeyLayout keyLayout;
+    static KeyMap tetriminoKeyMap;
+    static TetrisField fields[FIELD_BATCH];
+    static Tetrimino tetrimino;
+
+    // A full single player layout
+    static Texture bgTexture, fieldBgTexture, fieldFrameTexture, fieldClearTexture;
+    static Texture fieldClearParticleTextureSheet;
+    static Text linesClearedText, linesClearedPromptText, scoreText, scorePromptText;
+    static Text highScoreText, highScorePromptText, msgText, comboText;
+    static Timer tetriminoTimer, clearLineTimer, gameOverTimer, msgTextTimer;
+    static TetrisLayout layout;
+};
+
+
+Game EngineBench::game;
+Window EngineBench::window;
+Renderer EngineBench::renderer;
+Font EngineBench::font;
+Texture EngineBench::blockTextureSheet;
+KeyLayout EngineBench::keyLayout;
+KeyMap EngineBench::tetriminoKeyMap{
+    {Tetrimino::Commands::RIGHT, {SDLK_RIGHT}},
+    {Tetrimino::Commands::LEFT, {SDLK_LEFT}},
+    {Tetrimino::Commands::ACC, {SDLK_DOWN}},
+    {Tetrimino::Commands::DROP, {SDLK_UP}},
+    {Tetrimino::Commands::ROT_CCW, {SDLK_RSHIFT}},
+    {Tetrimino::Commands::ROT_CW, {SDLK_KP_1}},
+};
+TetrisField EngineBench::fields[EngineBench::FIELD_BATCH];
+Tetrimino EngineBench::tetrimino;
+Texture EngineBench::bgTexture, EngineBench::fieldBgTexture;
+Texture EngineBench::fieldFrameTexture, EngineBench::fieldClearTexture;
+Texture EngineBench::fieldClearParticleTextureSheet;
+Text EngineBench::linesClearedText, EngineBench::linesClearedPromptText;
+Text EngineBench::scoreText, EngineBench::scorePromptText;
+Text EngineBench::highScoreText, EngineBench::highScorePromptText;
+Text EngineBench::msgText, EngineBench::comboText;
+Timer EngineBench::tetriminoTimer, EngineBench::clearLineTimer;
+Timer EngineBench::gameOverTimer, EngineBench::msgTextTimer;
+TetrisLayout EngineBench::layout;
+
+
+void EngineBench::init ()
+{
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, IMG_GetError());
+    }
+    if (TTF_Init() == -1)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+    }
+
+    // Record like the game does, so that trace zones cost the same
+    FlightRecorder::init();
+
+    window.init(game);
+    renderer.init(window);
+    font.init("fonts/font.ttf", 30);
+    blockTextureSheet.load_from_file(renderer, "textures/blocks.png", &CYAN);
+    game.create_key_loadout(keyLayout, tetriminoKeyMap);
+
+    Tetrimino::load_schemes("schemes.txt");
+    Tetrimino::init_clips();
+
+    for (TetrisField &field : fields)
+    {
+        field.init(
+            TETRIS_FIELD_WIDTH, TETRIS_FIELD_HEIGHT,
+            nullptr, nullptr, nullptr, nullptr
+        );
+    }
+    tetrimino.init(&fields[0], &blockTextureSheet, &keyLayout);
+
+    bgTexture.load_from_file(renderer, "textures/bg.png");
+    fieldBgTexture.load_from_file(renderer, "textures/field_bg.png");
+    fieldFrameTexture.load_from_file(renderer, "textures/field_frame.png");
+    fieldClearTexture.load_from_file(renderer, "textures/field_clear.png");
+    fieldClearParticleTextureSheet.load_from_file(
+        renderer, "textures/field_particles.png", &CYAN
+    );
+    linesClearedText.init(renderer, font, "0000", WHITE, "999999999");
+    linesClearedPromptText.init(renderer, font, "Lines cleared:", WHITE);
+    scoreText.init(renderer, font, "000000000", WHITE, "999999999");
+    scorePromptText.init(renderer, font, "Score:", WHITE, "High score:");
+    highScoreText.init(renderer, font, "000000000", WHITE, "999999999");
+    highScorePromptText.init(renderer, font, "High score:", WHITE);
+    msgText.init(renderer, font, "", WHITE, std::string(24, 'W'));
+    comboText.init(renderer, font, "Combo: 0", WHITE, "Combo: 99");
+    reset_layout();
+}
+
+void EngineBench::free ()
+{
+    layout.free();
+    for (
+        Text *text :
+        {&linesClearedText, &linesClearedPromptText, &scoreText, &scorePromptText,
+            &highScoreText, &highScorePromptText, &msgText, &comboText}
+    )
+    {
+        text->free();
+    }
+    for (
+        Texture *texture :
+        {&bgTexture, &fieldBgTexture, &fieldFrameTexture, &fieldClearTexture,
+            &fieldClearParticleTextureSheet}
+    )
+    {
+        texture->free();
+    }
+
+    tetrimino.free();
+    for (TetrisField &field : fields)
+    {
+        field.free();
+    }
+    blockTextureSheet.free();
+    font.free();
+    renderer.free();
+    window.free();
+
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+}
+
+void EngineBench::add_benchmarks (BenchmarkRunner &runner)
+{
+    runner.add("clear_lines/0/solid", bench_clear_lines<0, 0>);
+    runner.add("clear_lines/1/solid", bench_clear_lines<1, 0>);
+    runner.add("clear_lines/2/solid", bench_clear_lines<2, 0>);
+    runner.add("clear_lines/3/solid", bench_clear_lines<3, 0>);
+    runner.add("clear_lines/4/solid", bench_clear_lines<4, 0>);
+    runner.add("clear_lines/0/gaps", bench_clear_lines<0, 12>);
+    runner.add("clear_lines/1/gaps", bench_clear_lines<1, 12>);
+    runner.add("clear_lines/2/gaps", bench_clear_lines<2, 12>);
+    runner.add("clear_lines/3/gaps", bench_clear_lines<3, 12>);
+    runner.add("clear_lines/4/gaps", bench_clear_lines<4, 12>);
+    runner.add("rotate/free", bench_rotate_free);
+    runner.add("rotate/kick", bench_rotate_kick);
+    runner.add("rotate/blocked", bench_rotate_blocked);
+    runner.add("check_collision_left", bench_collision_left);
+    runner.add("check_collision_right", bench_collision_right);
+    runner.add("check_collision_bottom", bench_collision_bottom);
+    runner.add("drop/empty", bench_drop_empty);
+    runner.add("drop/stack", bench_drop_stack);
+    runner.add("spawn_stop", bench_spawn_stop);
+    runner.add("render_config", bench_render_config);
+    runner.add("fit_font", bench_fit_font);
+    runner.add("steady_state/frame", bench_steady_state_frame);
+    runner.add("steady_state/clear", bench_steady_state_clear);
+    runner.add("flight_recorder/tick", bench_flight_recorder_tick);
+}
+
+void EngineBench::empty_field (TetrisField &field)
+{
+    for (std::vector<Block *> &row : field.field)
+    {
+        for (Block *&block : row)
+        {
+            if (block != nullptr)
+            {
+                field.destroy_block(block);
+                block = nullptr;
+            }
+        }
+    }
+    std::fill(field.columns.begin(), field.columns.end(), 0);
+}
+
+void EngineBench::fill_field (TetrisField &field, int fullRows, int gapRows)
+{
+    empty_field(field);
+    int height = field.get_height(), width = field.get_width();
+    for (int row = height - 1; row >= height - fullRows - gapRows; --row)
+    {
+        // Full rows go first so that gap rows have to be shifted down
+        int gap = row >= height - fullRows ? -1 : (row * 7) % width;
+        for (int col = 0; col < width; ++col)
+        {
+            if (col != gap)
+            {
+                field.add_block(
+                    col, row, field.create_block(&blockTextureSheet, nullptr)
+                );
+            }
+        }
+    }
+}
+
+void EngineBench::reset_layout ()
+{
+    layout.free();
+    layout.init(
+        TETRIS_FIELD_WIDTH, TETRIS_FIELD_HEIGHT,
+        &keyLayout, &keyLayout,
+        &tetriminoTimer, &clearLineTimer, &gameOverTimer, &msgTextTimer,
+        &bgTexture, &blockTextureSheet,
+        &fieldBgTexture, &fieldFrameTexture, &fieldClearTexture,
+        &fieldClearParticleTextureSheet,
+        &linesClearedText, &linesClearedPromptText,
+        &scoreText, &scorePromptText,
+        &highScoreText, &highScorePromptText,
+        &msgText, &comboText
+    );
+    layout.spawn_tetrimino();
+    layout.publish();
+
+    // Texts have to be rendered before their text is set
+    layout.render(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+}
+
+template <int fullRows, int gapRows>
+void EngineBench::bench_clear_lines (BenchState &state)
+{
+    for (long long i = 0; i < state.get_iterations(); i += FIELD_BATCH)
+    {
+        int batch = std::min<long long>(FIELD_BATCH, state.get_iterations() - i);
+
+        state.pause_timing();
+        for (int j = 0; j < batch; ++j)
+        {
+            fill_field(fields[j], fullRows, gapRows);
+        }
+        state.resume_timing();
+
+        for (int j = 0; j < batch; ++j)
+        {
+            do_not_optimize(fields[j].clear_lines());
+        }
+    }
+}
+
+void EngineBench::bench_rotate_free (BenchState &state)
+{
+    empty_field(fields[0]);
+    tetrimino.spawn(
+        3, 8, 1000, {Tetrimino::TETRIMINO_T, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(tetrimino.rotate(1));
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_rotate_kick (BenchState &state)
+{
+    // A vertical I against the left wall has to be shifted to become horizontal
+    empty_field(fields[0]);
+    tetrimino.spawn(
+        -1, 8, 1000, {Tetrimino::TETRIMINO_I, Tetrimino::TETRIMINO_ROTATION_90}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        tetrimino.posX = -1;
+        tetrimino.rot = Tetrimino::TETRIMINO_ROTATION_90;
+        do_not_optimize(tetrimino.rotate(1));
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_rotate_blocked (BenchState &state)
+{
+    // A vertical I in a field full of blocks fails every kick
+    fill_field(fields[0], TETRIS_FIELD_HEIGHT, 0);
+    for (int row = 8; row < 12; ++row)
+    {
+        fields[0].destroy_block(fields[0].field[row][4]);
+        fields[0].field[row][4] = nullptr;
+    }
+    tetrimino.spawn(
+        3, 8, 1000, {Tetrimino::TETRIMINO_I, Tetrimino::TETRIMINO_ROTATION_90}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(tetrimino.rotate(1));
+    }
+    tetrimino.free(false);
+    empty_field(fields[0]);
+}
+
+void EngineBench::bench_collision_left (BenchState &state)
+{
+    fill_field(fields[0], 0, 12);
+    tetrimino.spawn(
+        3, 2, 1000, {Tetrimino::TETRIMINO_L, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(tetrimino.check_collision_left());
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_collision_right (BenchState &state)
+{
+    fill_field(fields[0], 0, 12);
+    tetrimino.spawn(
+        3, 2, 1000, {Tetrimino::TETRIMINO_L, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(tetrimino.check_collision_right());
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_collision_bottom (BenchState &state)
+{
+    fill_field(fields[0], 0, 12);
+    tetrimino.spawn(
+        3, 2, 1000, {Tetrimino::TETRIMINO_L, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(tetrimino.check_collision_bottom());
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_drop_empty (BenchState &state)
+{
+    empty_field(fields[0]);
+    tetrimino.spawn(
+        3, 0, 1000, {Tetrimino::TETRIMINO_T, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        tetrimino.posY = 0;
+        tetrimino.drop();
+        do_not_optimize(tetrimino.posY);
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_drop_stack (BenchState &state)
+{
+    fill_field(fields[0], 0, 12);
+    tetrimino.spawn(
+        3, 0, 1000, {Tetrimino::TETRIMINO_T, Tetrimino::TETRIMINO_ROTATION_0}
+    );
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        tetrimino.posY = 0;
+        tetrimino.drop();
+        do_not_optimize(tetrimino.posY);
+    }
+    tetrimino.free(false);
+}
+
+void EngineBench::bench_spawn_stop (BenchState &state)
+{
+    empty_field(fields[0]);
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        tetrimino.spawn(
+            3, 0, 1000,
+            TetriminoConfig(
+                Tetrimino::TetriminoType(i % Tetrimino::TETRIMINO_TOTAL),
+                Tetrimino::TETRIMINO_ROTATION_0
+            )
+        );
+        tetrimino.stop();
+
+        state.pause_timing();
+        empty_field(fields[0]);
+        state.resume_timing();
+    }
+}
+
+void EngineBench::bench_render_config (BenchState &state)
+{
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        Tetrimino::render_config(
+            TetriminoConfig(
+                Tetrimino::TetriminoType(i % Tetrimino::TETRIMINO_TOTAL),
+                Tetrimino::TETRIMINO_ROTATION_0
+            ),
+            0, 0, 30, &blockTextureSheet
+        );
+    }
+}
+
+void EngineBench::bench_fit_font (BenchState &state)
+{
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        do_not_optimize(font.fit_font("Score: 1234567", 400, 60));
+    }
+}
+
+void EngineBench::bench_steady_state_frame (BenchState &state)
+{
+    // Tetriminos fall a row every frame and wander randomly, so that frames spawn,
+    // stop and occasionally clear lines
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        if (layout.game_over())
+        {
+            state.pause_timing();
+            reset_layout();
+            state.resume_timing();
+        }
+        layout.tetrimino.fallDelay = 0;
+        layout.tetrimino.shift(rand() % 3 - 1);
+        layout.do_logic();
+        layout.publish();
+        layout.render(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+        renderer.flush();
+    }
+}
+
+void EngineBench::bench_steady_state_clear (BenchState &state)
+{
+    // Every frame a tetrimino lands on a full row, clearing it
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        state.pause_timing();
+        if (layout.game_over())
+        {
+            reset_layout();
+        }
+        layout.tetrimino.free(false);
+        fill_field(layout.field, 1, 0);
+        layout.tetrimino.spawn(
+            3, 0, 0,
+            TetriminoConfig(
+                Tetrimino::TetriminoType(i % Tetrimino::TETRIMINO_TOTAL),
+                Tetrimino::TETRIMINO_ROTATION_0
+            )
+        );
+        layout.tetrimino.drop();
+        state.resume_timing();
+
+        layout.do_logic();
+        layout.publish();
+        layout.render(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+        renderer.flush();
+    }
+}
+
+void EngineBench::bench_flight_recorder_tick (BenchState &state)
+{
+    // What a gameplay tick records besides its trace zones: the tick, a key press
+    // and the checksum of the layout
+    SDL_Event e{};
+    e.type = SDL_KEYDOWN;
+    e.key.keysym.sym = SDLK_LEFT;
+    for (long long i = 0; i < state.get_iterations(); ++i)
+    {
+        FlightRecorder::record_tick();
+        FlightRecorder::record_input(e);
+        FlightRecorder::record_checksum(0, layout.get_checksum());
+    }
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string filter = "", outPath = "bench_results.json";
+    int repetitions = 10;
+    bool checkAllocs = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--check-allocs") == 0)
+        {
+            checkAllocs = true;
+        }
+        else if (i + 1 == argc)
+        {
+            break;
+        }
+        else if (strcmp(argv[i], "--filter") == 0)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--reps") == 0)
+        {
+            repetitions = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--out") == 0)
+        {
+            outPath = argv[++i];
+        }
+    }
+
+    int exitCode = 0;
+    try
+    {
+        Logger::get()->init("bench_log.txt");
+        EngineBench::init();
+
+        BenchmarkRunner runner;
+        EngineBench::add_benchmarks(runner);
+        runner.run(filter, repetitions);
+        runner.print_results();
+        runner.write_json(outPath);
+
+        if (checkAllocs)
+        {
+            for (const BenchResult &result : runner.get_results())
+            {
+                if (
+                    result.name.rfind(EngineBench::STEADY_STATE_PREFIX, 0) == 0
+                    && result.allocsPerOp > 0
+                )
+                {
+                    printf(
+                        "%s: %.3f allocations per frame, expected none\n",
+                        result.name.c_str(), result.allocsPerOp
+                    );
+                    exitCode = 1;
+                }
+            }
+        }
+
+        EngineBench::free();
+    }
+    catch (const Exception &e)
+    {
+        printf("%s\n", e.what().c_str());
+        exitCode = e.get_exit_code();
+    }
+    catch (std::exception &e)
+    {
+        printf("Standard exception: %s\n", e.what());
+        exitCode = -1;
+    }
+
+    Logger::get()->flush();
+    Logger::get()->free();
+
+    return exitCode;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file  perf_counters.cpp
+ * @brief Implementation of the class PerfCounters.
+ */
+
+#include "perf_counters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#endif
+
+
+#ifdef __linux__
+
+namespace
+{
+
+/// Event type and config for each `PerfCounters::Counter`.
+const struct
+{
+    uint32_t type;
+    uint64_t config;
+} EVENTS[PerfCounters::COUNTERS_TOTAL] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8
+            | PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+    },
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/// Counter value layout for `PERF_FORMAT_TOTAL_TIME_ENABLED | _RUNNING`.
+struct ReadFormat
+{
+    uint64_t value;
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+};
+
+} // namespace
+
+bool PerfCounters::init ()
+{
+    error = "";
+    for (int counter = 0; counter < COUNTERS_TOTAL; ++counter)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[counter].type;
+        attr.config = EVENTS[counter].config;
+        attr.disabled = leader == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds[counter] = syscall(
+            SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC
+        );
+        if (fds[counter] == -1)
+        {
+            if (error.empty())
+            {
+                error = std::string(get_name(Counter(counter))) + ": "
+                    + strerror(errno);
+            }
+        }
+        else if (leader == -1)
+        {
+            leader = fds[counter];
+        }
+    }
+    return leader != -1;
+}
+
+void PerfCounters::free ()
+{
+    for (int &fd : fds)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    leader = -1;
+}
+
+void PerfCounters::reset ()
+{
+    if (leader != -1)
+    {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::enable ()
+{
+    if (leader != -1)
+    {
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::disable ()
+{
+    if (leader != -1)
+    {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::read (long long values[COUNTERS_TOTAL]) const
+{
+    for (int counter = 0; counter < COUNTERS_TOTAL; ++counter)
+    {
+        values[counter] = -1;
+        ReadFormat data;
+        if (
+            fds[counter] != -1
+            && ::read(fds[counter], &data, sizeof(data)) == sizeof(data)
+            && data.timeRunning > 0
+        )
+        {
+            values[counter] = double(data.value) * data.timeEnabled
+                / data.timeRunning;
+        }
+    }
+}
+
+#else
+
+bool PerfCounters::init ()
+{
+    error = "hardware counters are only supported on Linux";
+    return false;
+}
+
+void PerfCounters::free ()
+{}
+
+void PerfCounters::reset ()
+{}
+
+void PerfCounters::enable ()
+{}
+
+void PerfCounters::disable ()
+{}
+
+void PerfCounters::read (long long values[COUNTERS_TOTAL]) const
+{
+    for (int counter = 0; counter < COUNTERS_TOTAL; ++counter)
+    {
+        values[counter] = -1;
+    }
+}
+
+#endif
+
+bool PerfCounters::is_available (Counter counter) const
+{
+    return fds[counter] != -1;
+}
+
+const std::string &PerfCounters::get_error () const
+{
+    return error;
+}
+
+const char *PerfCounters::get_name (Counter counter)
+{
+    static const char *names[COUNTERS_TOTAL] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+    };
+    return names[counter];
+}
@@ -0,0 +1,73 @@
+/**
+ * @file  perf_counters.hpp
+ * @brief Include file for PerfCounters class.
+ */
+
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+
+#include <string>
+
+
+/**
+ * @brief Hardware performance counters of the calling thread.
+ * @details
+ * Uses Linux `perf_event_open`. Counters that can not be opened, for example in
+ * containers, on other platforms or with a restrictive `perf_event_paranoid`, are
+ * reported as unavailable and the rest keep working.
+ */
+class PerfCounters
+{
+public:
+    /// Counted hardware events.
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES, // L1 data cache read misses.
+        LLC_MISSES, // Last level cache misses.
+        BRANCH_MISSES,
+        COUNTERS_TOTAL,
+    };
+
+    /**
+     * @brief Open the counters in a disabled state.
+     * @return `true` if at least one counter is available.
+     */
+    bool init();
+
+    /// Close the counters.
+    void free();
+
+    /// `true` if `counter` was opened.
+    bool is_available(Counter counter) const;
+
+    /// Get the reason no counters are available after `init()` returned `false`.
+    const std::string &get_error() const;
+
+    /// Set all counters to zero.
+    void reset();
+
+    /// Start counting.
+    void enable();
+
+    /// Stop counting.
+    void disable();
+
+    /**
+     * @brief Read the counters scaled for multiplexing.
+     * @param[out] values Counter values; `-1` for unavailable counters.
+     */
+    void read(long long values[COUNTERS_TOTAL]) const;
+
+    /// Get the name of `counter`.
+    static const char *get_name(Counter counter);
+
+private:
+    int fds[COUNTERS_TOTAL] = {-1, -1, -1, -1, -1};
+    int leader = -1; // All counters are in the group of the first opened one.
+    std::string error;
+};
+
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * @file  alloc_tracker.cpp
+ * @brief Implementation of the class AllocTracker and the global allocator
+ *     replacements.
+ */
+
+#include "alloc_tracker.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#include <cstdlib>
+#include <new>
+
+
+AllocTracker::Tag AllocTracker::tags[AllocTracker::TAGS_MAX];
+AllocTracker::Tag AllocTracker::untagged;
+std::atomic<long long> AllocTracker::totalAllocs{0};
+std::atomic<long long> AllocTracker::totalBytes{0};
+thread_local const char *AllocTracker::currTag = nullptr;
+
+int AllocTracker::budget = -1;
+int AllocTracker::warmupLeft = 0;
+Counter *AllocTracker::violations = nullptr;
+
+
+#ifdef TRACK_ALLOCS
+
+// Global allocator replacements counting every allocation of the process
+
+void *operator new (std::size_t size)
+{
+    AllocTracker::record(size);
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[] (std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete (void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[] (void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete (void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[] (void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+
+void AllocTracker::end_frame ()
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    // Take the counts of the frame, so allocations made meanwhile go to the next one
+    long long allocs[TAGS_MAX + 1], bytes[TAGS_MAX + 1];
+    long long frameAllocs = 0, frameBytes = 0;
+    for (int i = 0; i <= TAGS_MAX; ++i)
+    {
+        Tag &tag = i < TAGS_MAX ? tags[i] : untagged;
+        allocs[i] = tag.allocs.exchange(0, std::memory_order_relaxed);
+        bytes[i] = tag.bytes.exchange(0, std::memory_order_relaxed);
+        frameAllocs += allocs[i];
+        frameBytes += bytes[i];
+    }
+
+    if (budget < 0)
+    {
+        return;
+    }
+    if (warmupLeft > 0)
+    {
+        --warmupLeft;
+        return;
+    }
+    if (frameAllocs <= budget)
+    {
+        return;
+    }
+
+    violations->inc();
+    LOG_WARNING(
+        "Frame made {} allocations of {} bytes, over the budget of {}",
+        frameAllocs, frameBytes, budget
+    );
+    for (int i = 0; i <= TAGS_MAX; ++i)
+    {
+        if (allocs[i])
+        {
+            const char *name = i < TAGS_MAX ? tags[i].name.load() : nullptr;
+            LOG_WARNING(
+                "    {}: {} allocations of {} bytes",
+                name != nullptr ? name : "untagged", allocs[i], bytes[i]
+            );
+        }
+    }
+}
+
+void AllocTracker::set_budget (int allocs, int warmupFrames)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    violations = &Metrics::counter(
+        "alloc_budget_violations_total",
+        "Frames allocating more than the allocation budget."
+    );
+    budget = allocs;
+    warmupLeft = warmupFrames;
+}
+
+void AllocTracker::clear_budget ()
+{
+    budget = -1;
+}
+
+AllocTracker::Tag *AllocTracker::get_tag (const char *tag)
+{
+    if (tag == nullptr)
+    {
+        return &untagged;
+    }
+    for (Tag &slot : tags)
+    {
+        const char *name = slot.name.load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            // Claim the free slot; if another thread won it, check its name
+            if (slot.name.compare_exchange_strong(name, tag) || name == tag)
+            {
+                return &slot;
+            }
+        }
+        else if (name == tag)
+        {
+            return &slot;
+        }
+    }
+    return &untagged;
+}
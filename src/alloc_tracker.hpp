@@ -0,0 +1,162 @@
+/**
+ * @file  alloc_tracker.hpp
+ * @brief Include file for AllocTracker and AllocScope classes and the
+ *     `ALLOC_SCOPE` macro.
+ */
+
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+
+
+#include "trace.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+
+class Counter;
+
+/**
+ * @brief A purely static class counting heap allocations per frame and per tag.
+ * @details
+ * With `TRACK_ALLOCS` defined, the global `operator new` is replaced to count every
+ * allocation of the process, attributed to the innermost `ALLOC_SCOPE` of the
+ * allocating thread. Without it, nothing is counted and the scopes compile out.
+ *
+ * While a budget is set, frames allocating more than the budget after the warmup
+ * are reported as warnings with a per tag breakdown and counted in the
+ * `alloc_budget_violations_total` metric.
+ * @example
+ *
+ *     void TetrisLayout::do_logic ()
+ *     {
+ *         ALLOC_SCOPE("tetris");
+ *         // Allocations here are tagged "tetris"
+ *     }
+ */
+class AllocTracker
+{
+public:
+    /// `true` if allocations are counted, i.e. `TRACK_ALLOCS` is defined.
+    static constexpr bool is_enabled ()
+    {
+#ifdef TRACK_ALLOCS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// Count an allocation of `size` bytes. Called by `operator new`.
+    static void record (size_t size)
+    {
+        const char *tag = currTag;
+        Tag *slot = get_tag(tag);
+        slot->allocs.fetch_add(1, std::memory_order_relaxed);
+        slot->bytes.fetch_add(size, std::memory_order_relaxed);
+        totalAllocs.fetch_add(1, std::memory_order_relaxed);
+        totalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    /// Get the amount of allocations made by the process so far.
+    static long long get_total_allocs ()
+    {
+        return totalAllocs.load(std::memory_order_relaxed);
+    }
+
+    /// Get the amount of bytes allocated by the process so far.
+    static long long get_total_bytes ()
+    {
+        return totalBytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check the allocations of the current frame against the budget and
+     *     start a new frame.
+     * @note Should be called once per frame by the main thread.
+     */
+    static void end_frame();
+
+    /**
+     * @brief Start enforcing a per frame allocation budget.
+     * @param allocs Maximum amount of allocations per frame.
+     * @param warmupFrames Amount of frames to skip before enforcing.
+     */
+    static void set_budget(int allocs, int warmupFrames);
+
+    /// Stop enforcing the budget.
+    static void clear_budget();
+
+    /// Get the tag of the calling thread's innermost scope; `nullptr` if none.
+    static const char *get_curr_tag ()
+    {
+        return currTag;
+    }
+
+    /// Set the tag of the calling thread. Used by `AllocScope`.
+    static void set_curr_tag (const char *tag)
+    {
+        currTag = tag;
+    }
+
+private:
+    /// Maximum amount of distinct tags; allocations of further tags are untagged.
+    static constexpr int TAGS_MAX = 32;
+
+    /// Allocation counts of the current frame for a single tag.
+    struct Tag
+    {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<long long> allocs{0};
+        std::atomic<long long> bytes{0};
+    };
+
+    /**
+     * @brief Get the slot of `tag`, claiming a free one on the first use.
+     * @param tag Tag name, compared by address; `nullptr` for untagged.
+     */
+    static Tag *get_tag(const char *tag);
+
+    static Tag tags[TAGS_MAX];
+    static Tag untagged;
+    static std::atomic<long long> totalAllocs, totalBytes;
+    static thread_local const char *currTag;
+
+    static int budget; // Negative if not enforced.
+    static int warmupLeft; // Frames to skip before enforcing the budget.
+    static Counter *violations;
+};
+
+/// Tags allocations of the calling thread from construction to destruction.
+class AllocScope
+{
+public:
+    /// Start tagging with `tag`. Must outlive the tracker, e.g. a string literal.
+    explicit AllocScope(const char *tag)
+        : prevTag(AllocTracker::get_curr_tag())
+    {
+        AllocTracker::set_curr_tag(tag);
+    }
+
+    /// Restore the tag of the enclosing scope.
+    ~AllocScope()
+    {
+        AllocTracker::set_curr_tag(prevTag);
+    }
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+private:
+    const char *prevTag;
+};
+
+/// Tag allocations with `tag` until the end of the enclosing scope.
+#ifdef TRACK_ALLOCS
+#define ALLOC_SCOPE(tag) AllocScope TRACE_CONCAT(allocScope, __LINE__)(tag)
+#else
+#define ALLOC_SCOPE(tag) do {} while (0)
+#endif
+
+
+#endif
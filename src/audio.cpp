@@ -1,5 +1,6 @@
 #include "audio.hpp"
 #include "exceptions.hpp"
+#include "metrics.hpp"
 
 
 std::map<int, const std::string> Audio::musicPath{
@@ -30,8 +31,12 @@ std::map<int, const std::string> Audio::soundPath{
 
 std::vector<Mix_Music *> Audio::music(MUSIC_TOTAL);
 std::vector<Mix_Chunk *> Audio::sounds(SOUNDS_TOTAL);
+std::vector<Counter *> Audio::soundsPlayed(SOUNDS_TOTAL);
+std::vector<Counter *> Audio::soundsDropped(SOUNDS_TOTAL);
+std::thread::id Audio::audioThread;
+SpscQueue<Audio::Sound, AUDIO_SOUND_QUEUE_LEN> Audio::queuedSounds;
 
-bool Audio::muted = false;
+std::atomic<bool> Audio::muted{false};
 int Audio::lastVolSound = VOL_SOUND;
 int Audio::lastVolMusic = VOL_MUSIC;
 Audio::Music Audio::currMusic = Audio::MUSIC_TOTAL;
@@ -39,6 +44,7 @@ Audio::Music Audio::currMusic = Audio::MUSIC_TOTAL;
 
 void Audio::init ()
 {
+    audioThread = std::this_thread::get_id();
     music.resize(MUSIC_TOTAL);
     sounds.resize(SOUNDS_TOTAL);
 
@@ -57,6 +63,19 @@ void Audio::init ()
         {
             throw ExceptionSDL(__FILE__, __LINE__, Mix_GetError());
         }
+
+        // Label by file name without directory and extension
+        const std::string &path = soundPath[i];
+        size_t begin = path.find_last_of('/') + 1;
+        std::string label = "sound=\""
+            + path.substr(begin, path.find_last_of('.') - begin) + "\"";
+        soundsPlayed[i] = &Metrics::counter(
+            "audio_sounds_played_total", "Sound play calls.", label
+        );
+        soundsDropped[i] = &Metrics::counter(
+            "audio_sounds_dropped_total", "Sounds dropped for lack of a free channel.",
+            label
+        );
     }
 
     Mix_MasterVolume(VOL_SOUND);
@@ -142,5 +161,35 @@ void Audio::unpause_music ()
 
 void Audio::play_sound (Sound sound)
 {
-    Mix_PlayChannel(-1, sounds[sound], 0);
+    if (audioThread == std::thread::id())
+    {
+        return;
+    }
+    // Only the audio thread touches the loaded sounds, others hand them over
+    if (std::this_thread::get_id() != audioThread)
+    {
+        if (!queuedSounds.push(sound))
+        {
+            soundsDropped[sound]->inc();
+        }
+        return;
+    }
+    if (sounds[sound] == NULL)
+    {
+        return;
+    }
+    soundsPlayed[sound]->inc();
+    if (Mix_PlayChannel(-1, sounds[sound], 0) == -1)
+    {
+        soundsDropped[sound]->inc();
+    }
+}
+
+void Audio::play_queued_sounds ()
+{
+    Sound sound;
+    while (queuedSounds.pop(sound))
+    {
+        play_sound(sound);
+    }
 }
@@ -2,11 +2,18 @@
 #define AUDIO_HPP
 
 
+#include "spsc_queue.hpp"
+#include "constants.hpp"
+
 #include <SDL2/SDL_mixer.h>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <map>
+#include <thread>
+
 
+class Counter;
 
 /// A purely static class implementing audio interface.
 class Audio
@@ -45,7 +52,7 @@ public:
     static constexpr int VOL_SOUND = MIX_MAX_VOLUME / 32; // Sound volume
     static constexpr int VOL_MUSIC = VOL_SOUND / 2; // Music volume
 
-    /// Load all music and sounds.
+    /// Load all music and sounds. The calling thread becomes the audio thread.
     static void init();
 
     /// Free the loaded music and sounds.
@@ -82,9 +89,19 @@ public:
     /// Unpauses the currently playing music.
     static void unpause_music();
 
-    /// Plays `sound` a single time on the first free channel.
+    /**
+     * @brief Plays `sound` a single time on the first free channel.
+     * @details
+     * Other threads than the one that called `init()` only queue the sound for
+     * `play_queued_sounds()`; if the queue is full, the sound is dropped.
+     * @note The sound is dropped if all channels are playing. Nothing is played
+     *     before `init()`, e.g. in benchmarks.
+     */
     static void play_sound(Sound sound);
 
+    /// Play the sounds queued by other threads. Only called by the audio thread.
+    static void play_queued_sounds();
+
 private:
     /// (Music, path to file with Music) pairs.
     static std::map<int, const std::string> musicPath;
@@ -95,7 +112,15 @@ private:
     static std::vector<Mix_Music *> music; // The loaded music.
     static std::vector<Mix_Chunk *> sounds; // The loaded sounds.
 
-    static bool muted;
+    static std::vector<Counter *> soundsPlayed; // Play calls per sound.
+    static std::vector<Counter *> soundsDropped; // Calls without a free channel.
+
+    /// The thread that called `init()`, set before other threads play sounds.
+    static std::thread::id audioThread;
+    /// Sounds queued by a single other thread, e.g. the simulation thread.
+    static SpscQueue<Sound, AUDIO_SOUND_QUEUE_LEN> queuedSounds;
+
+    static std::atomic<bool> muted;
     static int lastVolSound; // Sound volume before muting.
     static int lastVolMusic; // Music volume before muting.
 
@@ -7,19 +7,43 @@
 #define CONSTANTS_HPP
 
 
-/// If true, flush all log messages.
-#ifdef DEBUG
-constexpr bool FLUSH_ALL = true;
+/// Log file path. Binary logs are decoded with `tools/log_decode`.
+#ifdef LOG_BINARY
+constexpr const char *LOG_PATH = "log.bin";
 #else
-constexpr bool FLUSH_ALL = false;
+constexpr const char *LOG_PATH = "log.txt";
 #endif
 
+/// Amount of log records the logger ring buffer holds. Must be a power of two.
+constexpr int LOG_RING_LEN = 4096;
+
+/// Maximum length of a single log record including the newline.
+constexpr int LOG_RECORD_LEN = 256;
+
+/// Size of the buffer the log writer thread collects records in before writing.
+constexpr int LOG_BATCH_LEN = 1 << 16;
+
+/// Time between log writer thread wakeups.
+constexpr int LOG_WRITE_INTERVAL = 50;
+
 /// Window dimensions on start.
 constexpr int WINDOW_WIDTH = 640, WINDOW_HEIGHT = 480;
 
 /// Maximum font point size.
 constexpr int MAX_PT_SIZE = 300;
 
+/// Maximum texture memory in bytes each font keeps glyph atlases in.
+constexpr int GLYPH_ATLAS_CACHE_BYTES = 16 << 20;
+
+/// Maximum point size text changing its contents is drawn from a glyph atlas with.
+constexpr int GLYPH_ATLAS_MAX_PT_SIZE = 64;
+
+/// Maximum amount of point sizes each font keeps a handle open for.
+constexpr int FONT_HANDLE_CACHE_MAX = 16;
+
+/// Maximum amount of font fitting results each font keeps.
+constexpr int FONT_FIT_CACHE_MAX = 64;
+
 /// Maximum particle size.
 constexpr int MAX_PARTICLE_SIZE = 50;
 
@@ -44,6 +68,15 @@ constexpr int TETRIMINO_DROP_ACC = 16;
 /// Amount of pending tetriminos to show.
 constexpr int TETRIMINO_QUEUE_LEN = 6;
 
+/// Score per cleared line.
+constexpr int TETRIS_SCORE_LINE = 1000;
+
+/// Score per combo accumulated before clearing a line.
+constexpr int TETRIS_SCORE_COMBO = 1500;
+
+/// Additional score for a 4-line clear.
+constexpr int TETRIS_SCORE_TETRIS = 1000;
+
 /// Time to keep showing a tetris message for
 constexpr int TETRIS_MSG_TIME = 2500;
 
@@ -53,11 +86,72 @@ constexpr int CLEAR_LINE_RENDER_TIME = 160;
 /// Maximum amount of particles to render for each clear line.
 constexpr int CLEAR_LINE_PARTICLES_MAX = (TETRIS_FIELD_WIDTH + 1) * 3;
 
-/// Maximum amount of frames a clear line particle lives for.
-constexpr int CLEAR_LINE_PARTICLE_LIFESPAN = CLEAR_LINE_RENDER_TIME / (1000 / 60) / 4;
+/// Time between particle animation frames, independent of the frame rate.
+constexpr int PARTICLE_FRAME_TIME = 1000 / 60;
+
+/// Maximum amount of animation frames a clear line particle lives for.
+constexpr int CLEAR_LINE_PARTICLE_LIFESPAN =
+    CLEAR_LINE_RENDER_TIME / PARTICLE_FRAME_TIME / 4;
 
 /// Maximum clear line particle deviation from spawn point.
 constexpr int CLEAR_LINE_PARTICLE_SHIFT_MAX = 10;
 
+/// Amount of frames to keep timings and counters for.
+constexpr int FRAME_STATS_WINDOW = 256;
+
+/// Time between frame statistics overlay text updates.
+constexpr int FRAME_STATS_REFRESH_TIME = 250;
+
+/// Frame statistics overlay font point size.
+constexpr int FRAME_STATS_PT_SIZE = 14;
+
+/// Longest wait for events on static scenes, so that timers are still checked.
+constexpr int IDLE_EVENT_WAIT_MS = 100;
+
+/// `true` to synchronize presenting with the display refresh on start.
+constexpr bool FRAME_LIMIT_VSYNC = true;
+
+/// Frame rate limit on start if the display refresh rate is unknown.
+constexpr int FRAME_LIMIT_DEFAULT_FPS = 60;
+
+/// Time between simulation thread ticks.
+constexpr int SIMULATION_TICK_MS = 2;
+
+/// Amount of input events queued for the simulation thread. Must be a power of two.
+constexpr int SIMULATION_EVENT_QUEUE_LEN = 256;
+
+/// Amount of sounds other threads queue for the main thread. Must be a power of two.
+constexpr int AUDIO_SOUND_QUEUE_LEN = 64;
+
+/// Amount of trace zones kept for each thread.
+constexpr int TRACE_RING_LEN = 1 << 14;
+
+/// Path to dump trace zones to.
+constexpr const char *TRACE_PATH = "trace.json";
+
+/// Path to dump metrics to in Prometheus text format.
+constexpr const char *METRICS_PATH = "metrics.prom";
+
+/// Maximum amount of allocations per frame in steady state gameplay.
+constexpr int ALLOC_FRAME_BUDGET = 0;
+
+/// Amount of frames after entering gameplay before the allocation budget applies.
+constexpr int ALLOC_BUDGET_WARMUP_FRAMES = 60;
+
+/// Amount of entries kept by the flight recorder per thread, seconds of gameplay.
+constexpr int FLIGHT_RECORDER_LEN = 1 << 13;
+
+/// Amount of threads the flight recorder keeps entries of.
+constexpr int FLIGHT_RECORDER_THREADS_MAX = 4;
+
+/// Path to dump the flight recorder to on crashes.
+constexpr const char *FLIGHT_RECORDER_PATH = "flight_recorder.txt";
+
+/// Default game time advanced by each replay tick, about a 60 FPS frame.
+constexpr int REPLAY_TICK_MS = 16;
+
+/// Maximum width and height of texture atlas pages.
+constexpr int ATLAS_PAGE_SIZE = 8192;
+
 
 #endif
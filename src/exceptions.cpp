@@ -38,6 +38,21 @@ int ExceptionFile::get_exit_code () const
 }
 
 
+ExceptionLogic::ExceptionLogic (const char *file, int line, const char *msg)
+    : msg(make_err_msg(file, line, msg, "Logic exception"))
+{}
+
+const std::string &ExceptionLogic::what () const
+{
+    return msg;
+}
+
+int ExceptionLogic::get_exit_code () const
+{
+    return EXCEPTION_LOGIC;
+}
+
+
 const std::string make_err_msg (
     const char *file,
     int line,
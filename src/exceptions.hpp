@@ -35,6 +35,7 @@ public:
         EXCEPTION_SUCCESS, // No exception.
         EXCEPTION_SDL, // SDL exception.
         EXCEPTION_FILE, // File I/O exception.
+        EXCEPTION_LOGIC, // Invalid use of a class, e.g. an unsupported size.
     };
 };
 
@@ -66,6 +67,20 @@ private:
 };
 
 
+/// Logic exception class, for arguments and states the code does not support.
+class ExceptionLogic: public Exception
+{
+public:
+    ExceptionLogic(const char *file, int line, const char *msg);
+
+    const std::string &what() const;
+    int get_exit_code() const;
+
+private:
+    const std::string msg;
+};
+
+
 /**
  * @brief Make a message in exception format.
  * @note Should only be called by error classes initializers.
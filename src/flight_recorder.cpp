@@ -0,0 +1,210 @@
+/**
+ * @file  flight_recorder.cpp
+ * @brief Implementation of the class FlightRecorder.
+ */
+
+#include "flight_recorder.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+
+FlightRecorder::Ring FlightRecorder::rings[FLIGHT_RECORDER_THREADS_MAX];
+std::atomic<int> FlightRecorder::ringsUsed{0};
+thread_local FlightRecorder::Ring *FlightRecorder::ring = nullptr;
+
+/// Signals after which the process can not continue.
+static const int FATAL_SIGNALS[] = {SIGSEGV, SIGABRT, SIGFPE, SIGILL};
+
+/// Held while naming rings.
+static std::mutex ringsMutex;
+
+
+void FlightRecorder::init ()
+{
+    record_thread("main");
+    for (int signal : FATAL_SIGNALS)
+    {
+        std::signal(signal, handle_fatal_signal);
+    }
+}
+
+void FlightRecorder::record_thread (const char *name)
+{
+    std::lock_guard<std::mutex> lock(ringsMutex);
+
+    int used = ringsUsed.load();
+    for (int i = 0; i < used; ++i)
+    {
+        if (strcmp(rings[i].name, name) == 0)
+        {
+            ring = &rings[i];
+            return;
+        }
+    }
+    if (used == FLIGHT_RECORDER_THREADS_MAX)
+    {
+        ring = nullptr;
+        return;
+    }
+    rings[used].name = name;
+    ring = &rings[used];
+    // Dumps only read rings which are given a name
+    ringsUsed.store(used + 1);
+}
+
+void FlightRecorder::record_input (const SDL_Event &e)
+{
+    if (ring == nullptr)
+    {
+        return;
+    }
+
+    // Keep only what is needed to replay the event
+    Uint32 a = 0, b = 0;
+    switch (e.type)
+    {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+        a = e.key.keysym.sym;
+        b = e.key.repeat;
+        break;
+    case SDL_JOYBUTTONDOWN:
+    case SDL_JOYBUTTONUP:
+        a = e.jbutton.which;
+        b = e.jbutton.button;
+        break;
+    case SDL_JOYDEVICEADDED:
+    case SDL_JOYDEVICEREMOVED:
+        a = e.jdevice.which;
+        break;
+    case SDL_WINDOWEVENT:
+        a = e.window.event;
+        break;
+    }
+    record(INPUT, SDL_GetPerformanceCounter(), Uint64(a) << 32 | b, nullptr, e.type);
+}
+
+bool FlightRecorder::dump (const char *path)
+{
+    FILE *fout = fopen(path, "w");
+    if (fout == nullptr)
+    {
+        return false;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double msPerTick = 1e3 / SDL_GetPerformanceFrequency();
+
+    // Threads may still be recording, so only dump up to the current heads
+    int used = ringsUsed.load();
+    Uint64 next[FLIGHT_RECORDER_THREADS_MAX], end[FLIGHT_RECORDER_THREADS_MAX];
+    Entry front[FLIGHT_RECORDER_THREADS_MAX]; // Copy of the entry at `next`.
+    Uint64 total = 0, skipped = 0;
+    for (int i = 0; i < used; ++i)
+    {
+        end[i] = rings[i].head.load(std::memory_order_acquire);
+        next[i] = end[i] > FLIGHT_RECORDER_LEN ? end[i] - FLIGHT_RECORDER_LEN : 0;
+        total += end[i] - next[i];
+        skipped += load_front(rings[i], next[i], end[i], front[i]);
+    }
+    fprintf(
+        fout, "# %llu entries of %d threads, times in ms before the dump\n",
+        (unsigned long long)total, used
+    );
+
+    while (true)
+    {
+        // Merge the rings, which are sorted by time, taking the earliest front
+        int oldest = -1;
+        for (int i = 0; i < used; ++i)
+        {
+            if (
+                next[i] < end[i]
+                && (oldest == -1 || front[i].time < front[oldest].time)
+            )
+            {
+                oldest = i;
+            }
+        }
+        if (oldest == -1)
+        {
+            break;
+        }
+        const Entry entry = front[oldest];
+        ++next[oldest];
+        skipped += load_front(
+            rings[oldest], next[oldest], end[oldest], front[oldest]
+        );
+        const char *thread = rings[oldest].name;
+
+        double time = -double(now - entry.time) * msPerTick;
+        Uint32 a = entry.value >> 32, b = Uint32(entry.value);
+        switch (entry.kind)
+        {
+        case TICK:
+            fprintf(
+                fout, "%.3f %s tick %llu\n", time, thread,
+                (unsigned long long)entry.value
+            );
+            break;
+        case INPUT:
+            fprintf(
+                fout, "%.3f %s input type=0x%x a=%u b=%u\n", time, thread,
+                entry.arg, a, b
+            );
+            break;
+        case CHECKSUM:
+            fprintf(
+                fout, "%.3f %s checksum player=%u %08x\n", time, thread,
+                entry.arg, b
+            );
+            break;
+        case ZONE:
+            fprintf(
+                fout, "%.3f %s zone %s %.3f\n", time, thread, entry.name,
+                double(entry.time - entry.value) * msPerTick
+            );
+            break;
+        }
+    }
+    if (skipped)
+    {
+        fprintf(
+            fout, "# %llu entries overwritten while dumping were skipped\n",
+            (unsigned long long)skipped
+        );
+    }
+
+    bool written = !ferror(fout);
+    return fclose(fout) == 0 && written;
+}
+
+Uint64 FlightRecorder::load_front (
+    const Ring &ring, Uint64 &next, Uint64 end, Entry &front
+)
+{
+    Uint64 skipped = 0;
+    for (; next < end; ++next, ++skipped)
+    {
+        front = ring.entries[next % FLIGHT_RECORDER_LEN];
+        // The owning thread may have overwritten the entry while it was copied
+        Uint64 unsafe = ring.head.load(std::memory_order_acquire) + 1;
+        if (unsafe <= next + FLIGHT_RECORDER_LEN)
+        {
+            break;
+        }
+    }
+    return skipped;
+}
+
+void FlightRecorder::handle_fatal_signal (int signal)
+{
+    // The process is going down anyway, so a best effort dump is fine even though
+    // stdio is not async signal safe
+    dump(FLIGHT_RECORDER_PATH);
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file  flight_recorder.hpp
+ * @brief Include file for FlightRecorder class.
+ */
+
+#ifndef FLIGHT_RECORDER_HPP
+#define FLIGHT_RECORDER_HPP
+
+
+#include "constants.hpp"
+
+#include <SDL2/SDL.h>
+#include <atomic>
+
+
+/**
+ * @brief A purely static class keeping the last moments of the game threads in
+ *     memory, to be dumped when the game crashes.
+ * @details
+ * Ticks, input events, game state checksums and trace zones of the threads that
+ * called `init()` or `record_thread()` are stored in a ring buffer of
+ * `FLIGHT_RECORDER_LEN` entries per thread; the oldest entries are overwritten and
+ * entries of other threads are ignored. Each thread only writes to its own ring, so
+ * recording an entry is a performance counter read and a few stores. Dumps merge
+ * the rings by time.
+ *
+ * `init()` also installs handlers dumping the entries on fatal signals; crashes
+ * turned into exceptions are dumped by `main`.
+ */
+class FlightRecorder
+{
+public:
+    /// Record entries of the calling thread as `main` and dump them on fatal signals.
+    static void init();
+
+    /**
+     * @brief Record entries of the calling thread, e.g. from the start of its loop.
+     * @details
+     * Threads with the same name share a ring and its tick numbers, so that a thread
+     * restarted under the same name continues the entries of the previous one. At
+     * most one thread of a name may run at a time. Threads with a name beyond the
+     * first `FLIGHT_RECORDER_THREADS_MAX` are not recorded.
+     * @param name Thread name. Must outlive the recorder, e.g. a string literal.
+     */
+    static void record_thread(const char *name);
+
+    /// Start the next tick of the calling thread, numbered from 0.
+    static void record_tick ()
+    {
+        if (ring != nullptr)
+        {
+            record(TICK, SDL_GetPerformanceCounter(), ring->tick++, nullptr, 0);
+        }
+    }
+
+    /// Record an input event.
+    static void record_input(const SDL_Event &e);
+
+    /**
+     * @brief Record a game state checksum.
+     * @param player Player whose state was hashed.
+     * @param checksum The checksum.
+     */
+    static void record_checksum (int player, Uint32 checksum)
+    {
+        if (ring != nullptr)
+        {
+            record(CHECKSUM, SDL_GetPerformanceCounter(), checksum, nullptr, player);
+        }
+    }
+
+    /**
+     * @brief Record a trace zone. Called by `Trace::record`.
+     * @param name Zone name. Must outlive the recorder, e.g. a string literal.
+     * @param start Performance counter value on zone start.
+     * @param end Performance counter value on zone end.
+     */
+    static void record_zone (const char *name, Uint64 start, Uint64 end)
+    {
+        if (ring != nullptr)
+        {
+            // Stamped with the end, like entries recorded at once, so that rings
+            // stay sorted by time for dumps to merge
+            record(ZONE, end, start, name, 0);
+        }
+    }
+
+    /**
+     * @brief Write the stored entries to `path` as text, oldest first.
+     * @details
+     * Lines start with the time and the name of the recording thread. Input lines
+     * hold the SDL event type and two event dependent values, e.g. the key and the
+     * repeat count of keyboard events. Zone lines are at the zone end and hold the
+     * zone duration.
+     * @note Only uses C stdio and does not throw, so it can run in signal handlers
+     *     as a best effort. Entries overwritten while dumping are skipped.
+     * @return `true` if the entries were written.
+     */
+    static bool dump(const char *path);
+
+private:
+    enum EntryKind : Uint8 {
+        TICK, // `value` is the tick number.
+        INPUT, // `arg` is the event type, `value` the packed event details.
+        CHECKSUM, // `arg` is the player, `value` the checksum.
+        ZONE, // `time` is the zone end, `value` its start.
+    };
+
+    struct Entry
+    {
+        Uint64 time; // Performance counter value.
+        Uint64 value;
+        const char *name;
+        Uint32 arg;
+        EntryKind kind;
+    };
+
+    /// Entries of the threads with the same name.
+    struct Ring
+    {
+        Entry entries[FLIGHT_RECORDER_LEN];
+        std::atomic<Uint64> head{0}; // Total amount of recorded entries.
+        Uint64 tick;
+        const char *name;
+    };
+
+    static void record (
+        EntryKind kind, Uint64 time, Uint64 value, const char *name, Uint32 arg
+    )
+    {
+        Uint64 head = ring->head.load(std::memory_order_relaxed);
+        ring->entries[head % FLIGHT_RECORDER_LEN] = {time, value, name, arg, kind};
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy the entry at `next` of `ring` to `front`, skipping the entries
+     *     the owning thread may be overwriting.
+     * @param ring The ring.
+     * @param next Index of the entry, advanced past the skipped ones.
+     * @param end Index to stop at.
+     * @param front Where to copy the entry.
+     * @return Amount of skipped entries.
+     */
+    static Uint64 load_front(
+        const Ring &ring, Uint64 &next, Uint64 end, Entry &front
+    );
+
+    /// Dump the entries and re-raise `signal` with the default handler.
+    static void handle_fatal_signal(int signal);
+
+    static Ring rings[FLIGHT_RECORDER_THREADS_MAX];
+    static std::atomic<int> ringsUsed; // Rings given a name, in order.
+    static thread_local Ring *ring; // Ring of the calling thread, if it records.
+};
+
+
+#endif
@@ -4,30 +4,65 @@
  */
 
 #include "font.hpp"
+#include "trace.hpp"
+#include "frame_stats.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
+#include "constants.hpp"
 
 #include <algorithm>
+#include <fstream>
+#include <iterator>
 
 
 void Font::init (const std::string &path, int ptSize)
 {
-    log("Initializing font", __FILE__, __LINE__);
+    LOG_INFO("Initializing font");
 
-    font = TTF_OpenFont(path.c_str(), ptSize);
-    if (font == NULL)
+    std::ifstream fin(path, std::ios::binary);
+    if (fin.fail())
     {
-        throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
     }
-    this->ptSize = ptSize;
+    data.assign(
+        std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>()
+    );
+    fonts.assign(MAX_PT_SIZE + 1, NULL);
+    fontUses.assign(MAX_PT_SIZE + 1, 0);
+    fontStamp = 0;
+    fontsOpen = 0;
+    fits.clear();
+    fits.reserve(FONT_FIT_CACHE_MAX);
+    nextFit = 0;
+    set_size(ptSize);
 }
 
 void Font::free ()
 {
-    log("Freeing font", __FILE__, __LINE__);
+    LOG_INFO("Freeing font");
 
-    TTF_CloseFont(font);
+    glyphAtlases.clear();
+    glyphAtlasUses.clear();
+    glyphAtlasBytes = 0;
+    for (TTF_Font *handle : fonts)
+    {
+        if (handle != NULL)
+        {
+            TTF_CloseFont(handle);
+        }
+    }
+    fonts.clear();
+    fontUses.clear();
     font = NULL;
+    if (probe != NULL)
+    {
+        TTF_CloseFont(probe);
+        probe = NULL;
+    }
+    data.clear();
+    fits.clear();
 }
 
 SDL_Surface *Font::create_text_surface (const std::string &text, const Color &color)
@@ -39,13 +74,115 @@ SDL_Surface *Font::create_text_surface (const std::string &text, const Color &co
     {
         throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
     }
+    FrameStats::count(FrameStats::RASTERIZATIONS);
+    static Counter &rasterizations = Metrics::counter(
+        "font_rasterizations_total", "Text surfaces rasterized by TTF."
+    );
+    rasterizations.inc();
+
+    return surface;
+}
+
+SDL_Surface *Font::create_glyph_surface (Uint32 ch, const Color &color)
+{
+    SDL_Surface *surface = TTF_RenderGlyph32_Blended(
+        font, ch, {color.r, color.g, color.b, 255}
+    );
+    if (surface == NULL)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+    }
+    FrameStats::count(FrameStats::RASTERIZATIONS);
 
     return surface;
 }
 
+int Font::get_glyph_advance (Uint32 ch)
+{
+    int advance = 0;
+    TTF_GlyphMetrics32(font, ch, NULL, NULL, NULL, NULL, &advance);
+    return advance;
+}
+
+int Font::get_kerning (Uint32 prev, Uint32 ch)
+{
+    return TTF_GetFontKerningSizeGlyphs32(font, prev, ch);
+}
+
+GlyphAtlas &Font::get_glyph_atlas (Renderer &renderer, int ptSize)
+{
+    ++glyphAtlasStamp;
+    for (int i = 0; i < int(glyphAtlases.size()); ++i)
+    {
+        if (glyphAtlases[i]->get_size() == ptSize)
+        {
+            glyphAtlasUses[i] = glyphAtlasStamp;
+            return *glyphAtlases[i];
+        }
+    }
+
+    std::unique_ptr<GlyphAtlas> atlas = std::make_unique<GlyphAtlas>();
+    int currPtSize = this->ptSize;
+    set_size(ptSize);
+    atlas->init(renderer, *this);
+    set_size(currPtSize);
+
+    // Drop the least recently used atlases until the new one fits
+    glyphAtlasBytes += atlas->get_bytes();
+    while (!glyphAtlases.empty() && glyphAtlasBytes > GLYPH_ATLAS_CACHE_BYTES)
+    {
+        int oldest = std::min_element(
+            glyphAtlasUses.begin(), glyphAtlasUses.end()
+        ) - glyphAtlasUses.begin();
+        glyphAtlasBytes -= glyphAtlases[oldest]->get_bytes();
+        glyphAtlases.erase(glyphAtlases.begin() + oldest);
+        glyphAtlasUses.erase(glyphAtlasUses.begin() + oldest);
+    }
+    glyphAtlases.push_back(std::move(atlas));
+    glyphAtlasUses.push_back(glyphAtlasStamp);
+
+    static Counter &builds = Metrics::counter(
+        "glyph_atlas_builds_total", "Glyph atlases rasterized by fonts."
+    );
+    builds.inc();
+
+    return *glyphAtlases.back();
+}
+
 void Font::set_size (int ptSize)
 {
-    TTF_SetFontSize(font, ptSize);
+    ptSize = max(1, min(ptSize, MAX_PT_SIZE));
+    if (fonts[ptSize] == NULL)
+    {
+        if (fontsOpen == FONT_HANDLE_CACHE_MAX)
+        {
+            // Close the least recently used handle other than the current one
+            int oldest = -1;
+            for (int i = 1; i <= MAX_PT_SIZE; ++i)
+            {
+                if (
+                    fonts[i] != NULL && fonts[i] != font
+                    && (oldest == -1 || fontUses[i] < fontUses[oldest])
+                )
+                {
+                    oldest = i;
+                }
+            }
+            TTF_CloseFont(fonts[oldest]);
+            fonts[oldest] = NULL;
+            --fontsOpen;
+        }
+        fonts[ptSize] = TTF_OpenFontRW(
+            SDL_RWFromConstMem(data.data(), data.size()), 1, ptSize
+        );
+        if (fonts[ptSize] == NULL)
+        {
+            throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+        }
+        ++fontsOpen;
+    }
+    fontUses[ptSize] = ++fontStamp;
+    font = fonts[ptSize];
     this->ptSize = ptSize;
 }
 
@@ -82,53 +219,91 @@ int Font::get_text_height (const std::string &text)
 
 bool Font::text_fits (const std::string &text, int w, int h)
 {
-    int actualW, actualH;
-    TTF_SizeUTF8(font, text.c_str(), &actualW, &actualH);
-    actualH *= 1 + std::count(text.begin(), text.end(), '\n');
-    
-    return actualW <= w && actualH <= h;
+    return text_fits(font, text, w, h);
 }
 
 int Font::fit_font (const std::string &text, int w, int h, int minPtSize)
 {
-    if (minPtSize > MAX_PT_SIZE)
+    TRACE_ZONE("Font::fit_font");
+
+    // Return to initial point size if text does not fit with minPtSize
+    int fitPtSize = get_fit(text, w, h);
+    if (fitPtSize < minPtSize)
     {
         return ptSize;
     }
+    set_size(fitPtSize);
+    return ptSize;
+}
 
-    // Return to initial point size if text does not fit with minPtSize
-    int currPtSize = ptSize;
-    set_size(minPtSize);
-    if (!text_fits(text, w, h))
+int Font::get_fit (const std::string &text, int w, int h)
+{
+    for (const Fit &fit : fits)
     {
-        log(
-            "Point size " + std::to_string(minPtSize) + " is to small to fit \""
-            + text + "\" into " + std::to_string(w) + "x" + std::to_string(h)
-            + ". Going back to point size " + std::to_string(currPtSize),
-            __FILE__, __LINE__
-        );
-        
-        set_size(currPtSize);
-        return ptSize;
+        if (fit.w == w && fit.h == h && fit.text == text)
+        {
+            return fit.ptSize;
+        }
     }
 
-    log(
-        "Fitting \"" + text + "\" from point size " + std::to_string(minPtSize)
-            + "...",
-        __FILE__, __LINE__
+    static Counter &iterations = Metrics::counter(
+        "font_fit_iterations_total", "Point sizes tried while fitting fonts."
     );
 
-    currPtSize = minPtSize;
-    do {
-        set_size(++currPtSize);
+    if (probe == NULL)
+    {
+        probe = TTF_OpenFontRW(
+            SDL_RWFromConstMem(data.data(), data.size()), 1, ptSize
+        );
+        if (probe == NULL)
+        {
+            throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+        }
     }
-    while (text_fits(text, w, h) && currPtSize <= MAX_PT_SIZE);
-    set_size(--currPtSize);
 
-    log(
-        "...fitted \"" + text + "\" to point size " + std::to_string(currPtSize),
-        __FILE__, __LINE__
-    );
+    // `low` always fits and `high` never does, `0` and `MAX_PT_SIZE + 1` untried
+    int low = 0, high = MAX_PT_SIZE + 1;
+    while (high - low > 1)
+    {
+        int mid = (low + high) / 2;
+        if (TTF_SetFontSize(probe, mid) != 0)
+        {
+            throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+        }
+        iterations.inc();
+        if (text_fits(probe, text, w, h))
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    LOG_DEBUG("Fitted \"{}\" into {}x{} with point size {}", text, w, h, low);
+
+    if (int(fits.size()) < FONT_FIT_CACHE_MAX)
+    {
+        fits.push_back({text, w, h, low});
+    }
+    else
+    {
+        Fit &fit = fits[nextFit];
+        fit.text = text;
+        fit.w = w;
+        fit.h = h;
+        fit.ptSize = low;
+        nextFit = (nextFit + 1) % FONT_FIT_CACHE_MAX;
+    }
+    return low;
+}
+
+bool Font::text_fits (TTF_Font *handle, const std::string &text, int w, int h)
+{
+    int actualW, actualH;
+    TTF_SizeUTF8(handle, text.c_str(), &actualW, &actualH);
+    actualH *= 1 + std::count(text.begin(), text.end(), '\n');
 
-    return currPtSize;
+    return actualW <= w && actualH <= h;
 }
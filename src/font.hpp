@@ -7,23 +7,35 @@
 #define FONT_HPP
 
 
+#include "glyph_atlas.hpp"
 #include "util.hpp"
 
 #include <SDL2/SDL_ttf.h>
+#include <memory>
 #include <string>
+#include <vector>
 
 
-/// SDL_Font wrapper class.
+/**
+ * @brief SDL_Font wrapper class.
+ * @details
+ * The font file is read once and every point size gets a handle of its own, opened
+ * on first use, so changing the point size only switches handles and keeps the
+ * glyphs cached by each of them. Up to `FONT_HANDLE_CACHE_MAX` handles are kept,
+ * closing the least recently used one to make room. Point sizes tried while fitting
+ * text are measured with a single scratch handle instead.
+ */
 class Font
 {
 public:
     /**
      * @brief Load the font from `path` with point size `ptSize`.
+     * @throws `ExceptionFile` thrown if `path` could not be read.
      * @throws `ExceptionSDL` thrown if font could not be created.
      */
     void init(const std::string &path, int ptSize);
 
-    /// Destroy the font.
+    /// Destroy the handles of all point sizes and the glyph atlases.
     void free();
 
     /**
@@ -35,7 +47,41 @@ public:
      */
     SDL_Surface *create_text_surface(const std::string &text, const Color &color);
 
-    /// Set font point size.
+    /**
+     * @brief Create an SDL surface from the glyph of `ch` with `color`.
+     * @details
+     * The surface is as high as the font and the glyph is placed in it like in text
+     * surfaces, so glyph surfaces put next to each other make up text.
+     * @param ch The character.
+     * @param color Glyph color.
+     * @return A pointer to the created surface.
+     * @throws `ExceptionSDL` thrown if surface could not be created.
+     */
+    SDL_Surface *create_glyph_surface(Uint32 ch, const Color &color);
+
+    /// Get the pixels to move the pen by after the glyph of `ch`.
+    int get_glyph_advance(Uint32 ch);
+
+    /// Get the pixels to move the pen by between the glyphs of `prev` and `ch`.
+    int get_kerning(Uint32 prev, Uint32 ch);
+
+    /**
+     * @brief Get the glyph atlas of point size `ptSize`.
+     * @details
+     * Atlases are rasterized on first use and kept in up to
+     * `GLYPH_ATLAS_CACHE_BYTES` of texture memory, dropping the least recently used
+     * ones to make room. Does not change the point size of the font.
+     * @note The atlas stays valid until the next call.
+     * @param renderer Renderer to create the atlas with.
+     * @param ptSize The point size.
+     * @throws `ExceptionSDL` thrown if the atlas could not be created.
+     */
+    GlyphAtlas &get_glyph_atlas(Renderer &renderer, int ptSize);
+
+    /**
+     * @brief Set font point size, clamped to 1..`MAX_PT_SIZE`.
+     * @throws `ExceptionSDL` thrown if the handle of the size could not be created.
+     */
     void set_size(int ptSize);
 
     /// Get font point size.
@@ -63,24 +109,58 @@ public:
     /**
      * @brief Increase font point size until `text` just fits in a `w`x`h` rectangle.
      * @details
-     * Goes through point sizes from `minPtSize` to `MAX_PT_SIZE`. Resulting size is
-     * the last tried one that fits `text` into the given dimensions with newlines
-     * taken into account. If `text` does not fit with `minPtSize`, goes back to the
-     * point size before the call. If `minPtSize` > `MAX_PT_SIZE`, does nothing.
+     * Sets the largest point size up to `MAX_PT_SIZE` that fits `text` into the
+     * given dimensions with newlines taken into account. If `text` does not fit with
+     * `minPtSize`, keeps the point size before the call.
+     *
+     * The size is found with a binary search, as text grows with the point size,
+     * measuring the text with a scratch handle resized to each tried size. The last
+     * `FONT_FIT_CACHE_MAX` results are kept, so fitting the same text into the same
+     * rectangle again, e.g. by every player or after a resize back, measures
+     * nothing.
      * @note Does not render text.
      * @param text The text.
      * @param w Maximum width.
      * @param h Maximum height.
      * @param minPtSize Point size to start increasing from.
      * @return New point size.
+     * @throws `ExceptionSDL` thrown if a handle of the font could not be created.
      */
     int fit_font(const std::string &text, int w, int h, int minPtSize=1);
 
 private:
-    TTF_Font *font = NULL;
+    /// A memoized `fit_font()` result.
+    struct Fit
+    {
+        std::string text;
+        int w, h;
+        int ptSize; // `0` if `text` does not fit with any point size.
+    };
+
+    /// Get the largest point size that fits `text` into `w`x`h`; `0` if none.
+    int get_fit(const std::string &text, int w, int h);
+
+    /// Determine whether `text` rendered with `handle` fits into `w`x`h`.
+    static bool text_fits(TTF_Font *handle, const std::string &text, int w, int h);
+
+    std::vector<char> data; // The font file, read by all handles.
+    std::vector<TTF_Font *> fonts; // Handle of each point size, `NULL` if not open.
+    std::vector<Uint32> fontUses; // Use stamps of `fonts`.
+    Uint32 fontStamp; // Stamp of the last use of any handle.
+    int fontsOpen; // Amount of handles in `fonts`.
+    TTF_Font *font = NULL; // Handle of the current point size.
+    TTF_Font *probe = NULL; // Handle resized to measure `get_fit()` tries.
 
     /// Keeps track of point size as there is no way to obtain it with SDL.
     int ptSize;
+
+    std::vector<Fit> fits;
+    int nextFit; // Entry of `fits` replaced by the next result once it is full.
+
+    std::vector<std::unique_ptr<GlyphAtlas>> glyphAtlases;
+    std::vector<Uint32> glyphAtlasUses; // Use stamps of `glyphAtlases`.
+    int glyphAtlasBytes = 0; // Texture memory of `glyphAtlases`.
+    Uint32 glyphAtlasStamp = 0; // Stamp of the last use of any atlas.
 };
 
 
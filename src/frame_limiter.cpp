@@ -0,0 +1,90 @@
+/**
+ * @file  frame_limiter.cpp
+ * @brief Implementation of the class FrameLimiter.
+ */
+
+#include "frame_limiter.hpp"
+#include "trace.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+void FrameLimiter::init (int fps)
+{
+    spin = INITIAL_SPIN_MS * SDL_GetPerformanceFrequency() / 1000;
+    set_fps(fps);
+}
+
+void FrameLimiter::set_fps (int fps)
+{
+    LOG_INFO("Setting the frame rate limit to {}", fps);
+
+    this->fps = std::max(0, fps);
+    period = this->fps ? SDL_GetPerformanceFrequency() / this->fps : 0;
+    deadline = SDL_GetPerformanceCounter();
+}
+
+int FrameLimiter::get_fps () const
+{
+    return fps;
+}
+
+void FrameLimiter::cycle_fps ()
+{
+    const int *next = std::upper_bound(
+        std::begin(FPS_PRESETS), std::end(FPS_PRESETS), fps
+    );
+    set_fps(next != std::end(FPS_PRESETS) ? *next : FPS_PRESETS[0]);
+}
+
+void FrameLimiter::set_vsync_rate (int rate)
+{
+    vsyncRate = rate;
+}
+
+void FrameLimiter::wait ()
+{
+    TRACE_ZONE("FrameLimiter::wait");
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (period == 0 || (vsyncRate > 0 && fps >= vsyncRate))
+    {
+        deadline = now;
+        return;
+    }
+
+    deadline += period;
+    if (now >= deadline)
+    {
+        if (now - deadline > period)
+        {
+            deadline = now;
+        }
+        return;
+    }
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    if (deadline - now > spin)
+    {
+        Uint32 sleepMs = (deadline - now - spin) * 1000 / freq;
+        if (sleepMs > 0)
+        {
+            SDL_Delay(sleepMs);
+            Uint64 woken = SDL_GetPerformanceCounter();
+
+            // Grow to the overshoot right away, shrink slowly while it is smaller
+            Uint64 slept = woken - now, requested = Uint64(sleepMs) * freq / 1000;
+            Uint64 overshoot = slept > requested ? slept - requested : 0;
+            Uint64 minSpin = MIN_SPIN_MS * freq / 1000;
+            spin = std::max({overshoot, minSpin, spin - spin / SPIN_DECAY});
+            now = woken;
+        }
+    }
+
+    while (now < deadline)
+    {
+        now = SDL_GetPerformanceCounter();
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file  frame_limiter.hpp
+ * @brief Include file for FrameLimiter class.
+ */
+
+#ifndef FRAME_LIMITER_HPP
+#define FRAME_LIMITER_HPP
+
+
+#include <SDL2/SDL.h>
+
+
+/**
+ * @brief Caps the frame rate by waiting for the start of each frame.
+ * @details
+ * Frames are due every 1 / FPS seconds from the first one. `wait()` sleeps with
+ * `SDL_Delay` until shortly before the frame is due and spins on the performance
+ * counter for the rest, as sleeps may overshoot by a few ms. The spin margin adapts
+ * to the overshoot of past sleeps: it grows to the worst one right away and slowly
+ * shrinks back while sleeps are accurate.
+ *
+ * With vsync, presenting already waits for the display, so the limiter only waits
+ * if the target frame rate is below the refresh rate.
+ */
+class FrameLimiter
+{
+public:
+    /// Target frame rates `cycle_fps()` goes through; `0` is uncapped.
+    static constexpr int FPS_PRESETS[] = {0, 30, 60, 120, 144, 240};
+
+    /**
+     * @brief Set the target frame rate and start timing frames from now.
+     * @param fps Target frame rate; `0` to not limit it.
+     */
+    void init(int fps);
+
+    /// Set the target frame rate; `0` to not limit it.
+    void set_fps(int fps);
+
+    /// Get the target frame rate; `0` if it is not limited.
+    int get_fps() const;
+
+    /// Set the target frame rate to the next of `FPS_PRESETS` above the current one.
+    void cycle_fps();
+
+    /// Set the refresh rate presenting waits for; `0` without vsync.
+    void set_vsync_rate(int rate);
+
+    /**
+     * @brief Wait until the next frame is due.
+     * @details
+     * A frame running late by more than a whole frame time restarts the timing
+     * from now instead of rushing the next frames to catch up.
+     */
+    void wait();
+
+private:
+    /// Initial spin margin in ms.
+    static constexpr double INITIAL_SPIN_MS = 2.0;
+
+    /// Least spin margin in ms.
+    static constexpr double MIN_SPIN_MS = 0.25;
+
+    /// The spin margin shrinks by 1 / `SPIN_DECAY` per accurate sleep.
+    static constexpr int SPIN_DECAY = 16;
+
+    int fps = 0;
+    int vsyncRate = 0;
+    Uint64 period = 0; // Performance counter ticks per frame; `0` if uncapped.
+    Uint64 deadline = 0; // Performance counter value the next frame is due at.
+    Uint64 spin = 0; // Performance counter ticks to spin instead of sleep.
+};
+
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file  frame_stats.cpp
+ * @brief Implementation of FrameStats and FrameStatsOverlay classes.
+ */
+
+#include "frame_stats.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+Uint64 FrameStats::lastLap = 0;
+float FrameStats::currTimes[FrameStats::PHASES_TOTAL];
+int FrameStats::currCounts[FrameStats::COUNTERS_TOTAL];
+float FrameStats::times[FRAME_STATS_WINDOW][FrameStats::PHASES_TOTAL];
+int FrameStats::counts[FRAME_STATS_WINDOW][FrameStats::COUNTERS_TOTAL];
+int FrameStats::frames = 0;
+
+
+void FrameStats::lap (Phase phase)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastLap != 0)
+    {
+        currTimes[phase] += 1000.0f * (now - lastLap) / SDL_GetPerformanceFrequency();
+    }
+    lastLap = now;
+}
+
+void FrameStats::end_frame ()
+{
+    static Histogram &frameTimes = Metrics::histogram(
+        "frame_time_seconds", "Frame times.",
+        {0.002, 0.004, 0.008, 0.0167, 0.0333, 0.05, 0.1, 0.25, 1}
+    );
+
+    int index = frames % FRAME_STATS_WINDOW;
+    float frameTime = 0;
+    for (int phase = 0; phase < PHASES_TOTAL; ++phase)
+    {
+        frameTime += currTimes[phase];
+        times[index][phase] = currTimes[phase];
+        currTimes[phase] = 0;
+    }
+    for (int counter = 0; counter < COUNTERS_TOTAL; ++counter)
+    {
+        counts[index][counter] = currCounts[counter];
+        currCounts[counter] = 0;
+    }
+    frameTimes.observe(frameTime / 1000);
+    ++frames;
+}
+
+int FrameStats::get_frames ()
+{
+    return std::min(frames, FRAME_STATS_WINDOW);
+}
+
+void FrameStats::get_percentiles (Phase phase, float &p50, float &p99, float &max)
+{
+    int total = get_frames();
+    if (total == 0)
+    {
+        p50 = p99 = max = 0;
+        return;
+    }
+
+    float sorted[FRAME_STATS_WINDOW];
+    for (int i = 0; i < total; ++i)
+    {
+        sorted[i] = get_time(phase, i);
+    }
+    std::sort(sorted, sorted + total);
+    p50 = sorted[total / 2];
+    p99 = sorted[std::min(total - 1, total * 99 / 100)];
+    max = sorted[total - 1];
+}
+
+void FrameStats::get_jitter (float &p50, float &p99, float &max)
+{
+    int total = get_frames() - 1;
+    if (total <= 0)
+    {
+        p50 = p99 = max = 0;
+        return;
+    }
+
+    // The oldest frame of a full window is overwritten by the next one
+    int first = frames > FRAME_STATS_WINDOW ? frames % FRAME_STATS_WINDOW : 0;
+    float sorted[FRAME_STATS_WINDOW];
+    float prev = get_time(PHASES_TOTAL, first);
+    for (int i = 0; i < total; ++i)
+    {
+        float time = get_time(PHASES_TOTAL, (first + i + 1) % FRAME_STATS_WINDOW);
+        sorted[i] = std::abs(time - prev);
+        prev = time;
+    }
+    std::sort(sorted, sorted + total);
+    p50 = sorted[total / 2];
+    p99 = sorted[std::min(total - 1, total * 99 / 100)];
+    max = sorted[total - 1];
+}
+
+void FrameStats::get_histogram (Phase phase, int buckets[HISTOGRAM_BUCKETS])
+{
+    std::fill(buckets, buckets + HISTOGRAM_BUCKETS, 0);
+    for (int i = 0; i < get_frames(); ++i)
+    {
+        int bucket = 0;
+        for (
+            float bound = HISTOGRAM_BASE;
+            get_time(phase, i) >= bound && bucket < HISTOGRAM_BUCKETS - 1;
+            bound *= 2
+        )
+        {
+            ++bucket;
+        }
+        ++buckets[bucket];
+    }
+}
+
+void FrameStats::get_counter (Counter counter, float &avg, int &max)
+{
+    int total = get_frames(), sum = 0;
+    max = 0;
+    for (int i = 0; i < total; ++i)
+    {
+        sum += counts[i][counter];
+        max = std::max(max, counts[i][counter]);
+    }
+    avg = total ? float(sum) / total : 0;
+}
+
+const char *FrameStats::get_name (Phase phase)
+{
+    static const char *names[PHASES_TOTAL + 1] = {
+        "events", "logic", "state", "render", "show", "wait", "frame"
+    };
+    return names[phase];
+}
+
+const char *FrameStats::get_name (Counter counter)
+{
+    static const char *names[COUNTERS_TOTAL] = {
+        "draw calls", "tex switches", "quads", "rasterized"
+    };
+    return names[counter];
+}
+
+float FrameStats::get_time (Phase phase, int index)
+{
+    if (phase != PHASES_TOTAL)
+    {
+        return times[index][phase];
+    }
+    float sum = 0;
+    for (int i = 0; i < PHASES_TOTAL; ++i)
+    {
+        sum += times[index][i];
+    }
+    return sum;
+}
+
+
+void FrameStatsOverlay::init (Renderer &renderer, Font &font)
+{
+    this->renderer = &renderer;
+    this->font = &font;
+    lastUpdate = 0;
+    shown = false;
+}
+
+void FrameStatsOverlay::free ()
+{
+    for (Texture &line : lines)
+    {
+        line.free();
+    }
+}
+
+void FrameStatsOverlay::toggle ()
+{
+    shown = !shown;
+    lastUpdate = 0;
+}
+
+bool FrameStatsOverlay::is_shown () const
+{
+    return shown;
+}
+
+void FrameStatsOverlay::render ()
+{
+    if (!shown)
+    {
+        return;
+    }
+    if (lastUpdate == 0 || SDL_GetTicks() - lastUpdate >= FRAME_STATS_REFRESH_TIME)
+    {
+        update();
+        lastUpdate = SDL_GetTicks();
+    }
+
+    constexpr int MARGIN = 4, BAR_W = 4;
+    int lineH = lines[0].get_height();
+    int textW = 0;
+    for (const Texture &line : lines)
+    {
+        textW = std::max(textW, line.get_width());
+    }
+    int histX = MARGIN * 2 + textW;
+
+    SDL_Rect background = {
+        0, 0, histX + FrameStats::HISTOGRAM_BUCKETS * (BAR_W + 1) + MARGIN,
+        LINES_TOTAL * lineH + MARGIN * 2
+    };
+    renderer->render_rectangle(&background, {32, 32, 32});
+
+    for (int i = 0; i < LINES_TOTAL; ++i)
+    {
+        lines[i].render(MARGIN, MARGIN + i * lineH);
+    }
+
+    // Draw the phase histograms next to their lines scaled to the fullest bucket
+    for (int phase = 0; phase < PHASE_LINES; ++phase)
+    {
+        int *buckets = histograms[phase];
+        int fullest = *std::max_element(
+            buckets, buckets + FrameStats::HISTOGRAM_BUCKETS
+        );
+        int y = MARGIN + (phase + 2) * lineH - 1;
+        for (int bucket = 0; bucket < FrameStats::HISTOGRAM_BUCKETS; ++bucket)
+        {
+            if (buckets[bucket])
+            {
+                int h = std::max(1, buckets[bucket] * (lineH - 2) / fullest);
+                SDL_Rect bar = {histX + bucket * (BAR_W + 1), y - h, BAR_W, h};
+                renderer->render_rectangle(&bar, {96, 192, 96});
+            }
+        }
+    }
+}
+
+void FrameStatsOverlay::update ()
+{
+    int prevPtSize = font->get_size();
+    font->set_size(FRAME_STATS_PT_SIZE);
+
+    char buf[128];
+    snprintf(
+        buf, sizeof(buf), "%-12s %7s %7s %7s  (%d frames)",
+        "ms", "p50", "p99", "max", FrameStats::get_frames()
+    );
+    lines[0].load_from_text(*renderer, *font, buf, WHITE);
+
+    for (int phase = 0; phase < PHASE_LINES; ++phase)
+    {
+        float p50, p99, max;
+        FrameStats::get_percentiles(FrameStats::Phase(phase), p50, p99, max);
+        FrameStats::get_histogram(FrameStats::Phase(phase), histograms[phase]);
+        snprintf(
+            buf, sizeof(buf), "%-12s %7.2f %7.2f %7.2f",
+            FrameStats::get_name(FrameStats::Phase(phase)), p50, p99, max
+        );
+        lines[1 + phase].load_from_text(*renderer, *font, buf, WHITE);
+    }
+
+    float jitterP50, jitterP99, jitterMax;
+    FrameStats::get_jitter(jitterP50, jitterP99, jitterMax);
+    snprintf(
+        buf, sizeof(buf), "%-12s %7.2f %7.2f %7.2f", "jitter",
+        jitterP50, jitterP99, jitterMax
+    );
+    lines[1 + PHASE_LINES].load_from_text(*renderer, *font, buf, WHITE);
+
+    for (int counter = 0; counter < FrameStats::COUNTERS_TOTAL; ++counter)
+    {
+        float avg;
+        int max;
+        FrameStats::get_counter(FrameStats::Counter(counter), avg, max);
+        snprintf(
+            buf, sizeof(buf), "%-12s avg %7.1f  max %5d",
+            FrameStats::get_name(FrameStats::Counter(counter)), avg, max
+        );
+        lines[2 + PHASE_LINES + counter].load_from_text(
+            *renderer, *font, buf, WHITE
+        );
+    }
+
+    font->set_size(prevPtSize);
+}
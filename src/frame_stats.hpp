@@ -0,0 +1,164 @@
+/**
+ * @file  frame_stats.hpp
+ * @brief Include file for FrameStats and FrameStatsOverlay classes.
+ */
+
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+
+#include "renderer.hpp"
+#include "font.hpp"
+#include "texture.hpp"
+#include "constants.hpp"
+
+#include <SDL2/SDL.h>
+
+
+/**
+ * @brief A purely static class collecting per frame timings and counters.
+ * @details
+ * The time between two consecutive `lap()` calls is attributed to the phase
+ * passed to the second one. `end_frame()` stores the phase times and the counters
+ * of the frame in a rolling window of `FRAME_STATS_WINDOW` frames.
+ * @note Collecting costs a few performance counter reads per frame and is always
+ *     on; only the overlay rendering is toggled.
+ */
+class FrameStats
+{
+public:
+    /// Frame phases.
+    enum Phase {
+        EVENTS, // `Game::handle_events`.
+        LOGIC, // `Game::do_logic`.
+        CHANGE_STATE, // `Game::change_state`.
+        RENDER, // `Game::render` up to `Renderer::show`.
+        SHOW, // `Renderer::show`.
+        WAIT, // `FrameLimiter::wait`.
+        PHASES_TOTAL,
+    };
+
+    /// Per frame counters.
+    enum Counter {
+        DRAW_CALLS, // Batches drawn by `Renderer::flush`.
+        TEXTURE_SWITCHES,
+        QUADS, // Textures and rectangles queued to `Renderer`.
+        RASTERIZATIONS, // Text and glyph surfaces created by `Font`.
+        COUNTERS_TOTAL,
+    };
+
+    /// Amount of histogram buckets. Bucket `i` > 0 counts times in
+    /// [2^(i - 1), 2^i) * `HISTOGRAM_BASE` ms, the last one counts the rest.
+    static constexpr int HISTOGRAM_BUCKETS = 12;
+
+    /// Upper bound of the first histogram bucket in ms.
+    static constexpr float HISTOGRAM_BASE = 0.125f;
+
+    /// Attribute the time since the last lap to `phase`.
+    static void lap(Phase phase);
+
+    /// Store the current frame in the rolling window and start a new one.
+    static void end_frame();
+
+    /// Add `amount` to `counter` of the current frame.
+    static void count(Counter counter, int amount=1)
+    {
+        currCounts[counter] += amount;
+    }
+
+    /// Get the amount of frames in the rolling window.
+    static int get_frames();
+
+    /**
+     * @brief Get percentiles of `phase` times in the rolling window.
+     * @param phase The phase; `PHASES_TOTAL` for whole frame times.
+     * @param[out] p50 Median in ms.
+     * @param[out] p99 99th percentile in ms.
+     * @param[out] max Maximum in ms.
+     */
+    static void get_percentiles(Phase phase, float &p50, float &p99, float &max);
+
+    /**
+     * @brief Get a histogram of `phase` times in the rolling window.
+     * @param phase The phase; `PHASES_TOTAL` for whole frame times.
+     * @param[out] buckets Frame amounts per bucket (see `HISTOGRAM_BUCKETS`).
+     */
+    static void get_histogram(Phase phase, int buckets[HISTOGRAM_BUCKETS]);
+
+    /**
+     * @brief Get percentiles of the frame jitter in the rolling window, i.e. of the
+     *     differences between consecutive whole frame times.
+     * @param[out] p50 Median in ms.
+     * @param[out] p99 99th percentile in ms.
+     * @param[out] max Maximum in ms.
+     */
+    static void get_jitter(float &p50, float &p99, float &max);
+
+    /// Get the average and the maximum of `counter` in the rolling window.
+    static void get_counter(Counter counter, float &avg, int &max);
+
+    /// Get the name of `phase`; `PHASES_TOTAL` is the whole frame.
+    static const char *get_name(Phase phase);
+
+    /// Get the name of `counter`.
+    static const char *get_name(Counter counter);
+
+private:
+    /// Get the time of `phase` in frame `index` of the window.
+    static float get_time(Phase phase, int index);
+
+    static Uint64 lastLap; // Performance counter value on the last lap.
+    static float currTimes[PHASES_TOTAL]; // Current frame phase times in ms.
+    static int currCounts[COUNTERS_TOTAL]; // Current frame counters.
+
+    static float times[FRAME_STATS_WINDOW][PHASES_TOTAL]; // Phase times in ms.
+    static int counts[FRAME_STATS_WINDOW][COUNTERS_TOTAL];
+    static int frames; // Total amount of stored frames.
+};
+
+/**
+ * @brief Overlay showing the `FrameStats` rolling window.
+ * @details
+ * Shows p50/p99/max and a histogram of each phase and of whole frames, p50/p99/max
+ * of the frame jitter, and the average and maximum of each counter. The text is
+ * rasterized every `FRAME_STATS_REFRESH_TIME` ms so the overlay itself adds to the
+ * counters.
+ */
+class FrameStatsOverlay
+{
+public:
+    /// Store `renderer` and `font`.
+    void init(Renderer &renderer, Font &font);
+
+    /// Free the text textures.
+    void free();
+
+    /// Show the overlay if it is hidden and hide it otherwise.
+    void toggle();
+
+    /// `true` if the overlay is shown.
+    bool is_shown() const;
+
+    /// If shown, update the text if enough time has passed and render the overlay.
+    void render();
+
+private:
+    /// Amount of phase lines; the last one is for whole frames.
+    static constexpr int PHASE_LINES = FrameStats::PHASES_TOTAL + 1;
+
+    /// Amount of text lines: a header, phases, jitter and counters.
+    static constexpr int LINES_TOTAL = 2 + PHASE_LINES + FrameStats::COUNTERS_TOTAL;
+
+    /// Rasterize the text lines from the current statistics.
+    void update();
+
+    Renderer *renderer;
+    Font *font;
+    Texture lines[LINES_TOTAL];
+    int histograms[PHASE_LINES][FrameStats::HISTOGRAM_BUCKETS];
+    Uint32 lastUpdate;
+    bool shown = false;
+};
+
+
+#endif
@@ -5,7 +5,9 @@
 
 #include "game.hpp"
 #include "audio.hpp"
-#include "particles.hpp"
+#include "trace.hpp"
+#include "alloc_tracker.hpp"
+#include "flight_recorder.hpp"
 #include "constants.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
@@ -20,21 +22,34 @@ KeyMap Game::keyMap{
         Game::Commands::SOUND_TOGGLE,
         {SDLK_m, KeyLayout::GP_CODE_SEP + SDL_CONTROLLER_BUTTON_BACK}
     },
+    {Game::Commands::STATS_TOGGLE, {SDLK_F3}},
+    {Game::Commands::TRACE_DUMP, {SDLK_F4}},
+    {Game::Commands::VSYNC_TOGGLE, {SDLK_F5}},
+    {Game::Commands::FPS_CYCLE, {SDLK_F6}},
+};
+
+const std::vector<TextureAtlas::Image> Game::atlasImages{
+    {"textures/bg.png", nullptr},
+    {"textures/blocks.png", &CYAN},
+    {"textures/field_bg.png", nullptr},
+    {"textures/field_frame.png", nullptr},
+    {"textures/field_clear.png", nullptr},
+    {"textures/field_particles.png", &CYAN},
 };
 
 
 void Game::init ()
 {
-    log("Initializing Game", __FILE__, __LINE__);
+    LOG_INFO("Initializing Game");
 
     // Set pre video subsystem initialization hints
     if (SDL_SetHint(SDL_HINT_WINDOWS_DPI_AWARENESS, "permonitorv2") == SDL_FALSE)
     {
-        log("[WARNING] DPI awareness not enabled!", __FILE__, __LINE__, true);
+        LOG_WARNING("DPI awareness not enabled!");
     }
     if (SDL_SetHint(SDL_HINT_WINDOWS_DPI_SCALING, "1") == SDL_FALSE)
     {
-        log("[WARNING] DPI scaling not enabled!", __FILE__, __LINE__, true);
+        LOG_WARNING("DPI scaling not enabled!");
     }
 
     // Initialize SDL libraries
@@ -49,10 +64,7 @@ void Game::init ()
     }
     if (SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == SDL_FALSE)
     {
-        log(
-            "[WARNING] Linear texture filtering not enabled!",
-            __FILE__, __LINE__, true
-        );
+        LOG_WARNING("Linear texture filtering not enabled!");
     }
 
     int imgFlags = IMG_INIT_PNG;
@@ -69,27 +81,36 @@ void Game::init ()
         throw ExceptionSDL(__FILE__, __LINE__, Mix_GetError());
     }
 
-    srand(static_cast<unsigned int>(time(nullptr)));
+    // The seed is logged so that games can be replayed
+    Uint32 seed = static_cast<Uint32>(time(nullptr));
+    LOG_INFO("Random seed: {}", seed);
+    srand(seed);
+    TetriminoConfig::seed(seed);
 
     // Initialize audio
     Audio::init();
 
     // Initialize class members
     window.init(*this);
-    renderer.init(window);
+    renderer.init(window, FRAME_LIMIT_VSYNC);
+    atlas.init(renderer, atlasImages);
     font.init("fonts/font.ttf", 30);
     gamepads.init();
+    statsOverlay.init(renderer, font);
 
-    create_key_loadout(keyLayout, keyMap, KeyLayout::GamepadSelector::GAMEPAD_ANY);
+    // Limit to the refresh rate, which vsync already paces if it is on
+    int refreshRate = window.get_refresh_rate();
+    frameLimiter.init(refreshRate > 0 ? refreshRate : FRAME_LIMIT_DEFAULT_FPS);
+    update_vsync_rate();
 
-    // Initialize particles
-    Particle::init_clips();
+    create_key_loadout(keyLayout, keyMap, KeyLayout::GamepadSelector::GAMEPAD_ANY);
 
     // Initialize tetrimino
     Tetrimino::load_schemes("schemes.txt");
     Tetrimino::init_clips();
 
     paused = false;
+    sceneChanged = true;
 
     // Begin state rotation
     currState = TitleScreenState::get();
@@ -99,15 +120,40 @@ void Game::init ()
 
 void Game::handle_events ()
 {
+    TRACE_ZONE("Game::handle_events");
+    ALLOC_SCOPE("events");
+
+    FlightRecorder::record_tick();
+
+    // Idle scenes only change on events, so wait for one instead of spinning
     SDL_Event e;
-    while (SDL_PollEvent(&e))
+    bool hasEvent = is_idle() && !sceneChanged
+        ? SDL_WaitEventTimeout(&e, IDLE_EVENT_WAIT_MS)
+        : SDL_PollEvent(&e);
+    for (; hasEvent; hasEvent = SDL_PollEvent(&e))
     {
+        FlightRecorder::record_input(e);
+
+        // Nothing follows the mouse, so its motion does not change the scene
+        if (e.type != SDL_MOUSEMOTION)
+        {
+            sceneChanged = true;
+        }
+
         if (e.type == SDL_QUIT)
         {
             set_next_state(GameOverState::get());
         }
 
         window.handle_event(*this, e);
+        renderer.handle_event(e);
+        if (
+            e.type == SDL_WINDOWEVENT
+            && e.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED
+        )
+        {
+            update_vsync_rate();
+        }
 
         keyLayout.handle_event(*this, e);
         if (keyLayout.get_type() == KeyLayout::DOWN && keyLayout.get_repeat() == 0)
@@ -130,16 +176,49 @@ void Game::handle_events ()
                     Audio::play_sound(Audio::UNMUTE);
                 }
                 break;
+            case STATS_TOGGLE:
+                statsOverlay.toggle();
+                break;
+            case TRACE_DUMP:
+                try
+                {
+                    Trace::dump(TRACE_PATH);
+                    LOG_INFO("Dumped trace zones to {}", TRACE_PATH);
+                }
+                catch (const Exception &e)
+                {
+                    LOG_WARNING("{}", e.what());
+                }
+                break;
+            case VSYNC_TOGGLE:
+                renderer.set_vsync(!renderer.has_vsync());
+                update_vsync_rate();
+                break;
+            case FPS_CYCLE:
+                frameLimiter.cycle_fps();
+                break;
             }
         }
 
-        gamepads.handle_event(*this, e);
+        {
+            // Gamepads are read by the simulation
+            std::lock_guard<Simulation> lock(simulation);
+            gamepads.handle_event(*this, e);
+        }
         currState->handle_event(*this, e);
+        simulation.push_event(e);
     }
+
+    FrameStats::lap(FrameStats::EVENTS);
 }
 
 void Game::do_logic ()
 {
+    TRACE_ZONE("Game::do_logic");
+    ALLOC_SCOPE("logic");
+
+    simulation.rethrow_error();
+
     if (!window.has_keyboard_focus() && !paused)
     {
         pause();
@@ -148,10 +227,16 @@ void Game::do_logic ()
     {
         currState->do_logic();
     }
+    Audio::play_queued_sounds();
+
+    FrameStats::lap(FrameStats::LOGIC);
 }
 
 void Game::change_state ()
 {
+    TRACE_ZONE("Game::change_state");
+    ALLOC_SCOPE("state");
+
     // nextState == nullptr means the next state is not set
     if (nextState != nullptr)
     {
@@ -160,23 +245,49 @@ void Game::change_state ()
 
         currState = nextState;
         nextState = nullptr;
+        sceneChanged = true;
     }
+
+    FrameStats::lap(FrameStats::CHANGE_STATE);
 }
 
 void Game::render ()
 {
-    if (!window.is_minimized())
+    TRACE_ZONE("Game::render");
+    ALLOC_SCOPE("render");
+
+    if (!window.is_minimized() && (sceneChanged || !is_idle()))
     {
         renderer.clear();
         currState->render();
+        statsOverlay.render();
+        FrameStats::lap(FrameStats::RENDER);
+
         renderer.show();
+        sceneChanged = false;
     }
+
+    FrameStats::lap(FrameStats::SHOW);
+
+    frameLimiter.wait();
+    FrameStats::lap(FrameStats::WAIT);
+    FrameStats::end_frame();
+    AllocTracker::end_frame();
 }
 
 void Game::free ()
 {
-    log("Freeing Game", __FILE__, __LINE__);
+    LOG_INFO("Freeing Game");
 
+    float p50, p99, max;
+    FrameStats::get_jitter(p50, p99, max);
+    LOG_INFO(
+        "Frame jitter over the last {} frames: p50 {} ms, p99 {} ms, max {} ms",
+        FrameStats::get_frames(), p50, p99, max
+    );
+
+    // Exiting frees what the simulation uses
+    simulation.stop();
     if (nextState != nullptr) // If a crash happed during entering next state
     {
         nextState->exit();
@@ -186,9 +297,11 @@ void Game::free ()
         currState->exit();
     }
     
+    statsOverlay.free();
+    atlas.free();
+    font.free(); // Before the renderer its glyph atlases were created with
     window.free();
     renderer.free();
-    font.free();
     gamepads.free();
 
     Audio::free();
@@ -199,6 +312,16 @@ void Game::free ()
     SDL_Quit();
 }
 
+void Game::start_simulation (Simulation::Task &task)
+{
+    simulation.start(*this, task);
+}
+
+void Game::stop_simulation ()
+{
+    simulation.stop();
+}
+
 bool Game::is_over () const
 {
     return currState == GameOverState::get();
@@ -206,7 +329,7 @@ bool Game::is_over () const
 
 void Game::set_next_state (GameState *state)
 {
-    log("Setting next state", __FILE__, __LINE__);
+    LOG_INFO("Setting next state");
 
     if (nextState != GameOverState::get())
     {
@@ -332,8 +455,11 @@ int Game::get_winner () const
 
 void Game::pause ()
 {
-    currState->pause_timers();
-    paused = true;
+    {
+        std::lock_guard<Simulation> lock(simulation);
+        currState->pause_timers();
+        paused = true;
+    }
 
     Audio::play_sound(Audio::GAME_PAUSE);
     Audio::pause_music();
@@ -341,9 +467,22 @@ void Game::pause ()
 
 void Game::unpause ()
 {
-    currState->unpause_timers();
-    paused = false;
+    {
+        std::lock_guard<Simulation> lock(simulation);
+        currState->unpause_timers();
+        paused = false;
+    }
 
     Audio::play_sound(Audio::GAME_UNPAUSE);
     Audio::unpause_music();
 }
+
+bool Game::is_idle () const
+{
+    return (paused || currState->is_static()) && !statsOverlay.is_shown();
+}
+
+void Game::update_vsync_rate ()
+{
+    frameLimiter.set_vsync_rate(renderer.has_vsync() ? window.get_refresh_rate() : 0);
+}
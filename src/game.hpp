@@ -18,6 +18,9 @@
 #include "textbox.hpp"
 #include "menu.hpp"
 #include "states.hpp"
+#include "frame_stats.hpp"
+#include "frame_limiter.hpp"
+#include "simulation.hpp"
 #include "util.hpp"
 
 #include <SDL2/SDL.h>
@@ -36,8 +39,15 @@ public:
     enum Commands{
         PAUSE,
         SOUND_TOGGLE,
+        STATS_TOGGLE,
+        TRACE_DUMP,
+        VSYNC_TOGGLE,
+        FPS_CYCLE,
     };
 
+    /// Images packed into the texture atlas at startup.
+    static const std::vector<TextureAtlas::Image> atlasImages;
+
     /**
      * @brief Initialize SDL libraries and class members.
      * @throws `ExceptionSDL` thrown if an SDL library could not be initialized.
@@ -47,8 +57,15 @@ public:
     /**
      * @brief Handle SDL events.
      * @details
-     * Calls `handle_events` on class members. Sets `GameOverState` on `SDL_QUIT`;
-     * toggles pause on Escape key press.
+     * Calls `handle_events` on class members and queues the events for the running
+     * simulation, if any. Sets `GameOverState` on `SDL_QUIT`;
+     * toggles pause on Escape key press; toggles the frame statistics overlay on F3
+     * key press; dumps trace zones to `TRACE_PATH` on F4 key press; toggles vsync on
+     * F5 key press; cycles the frame rate limit through
+     * `FrameLimiter::FPS_PRESETS` on F6 key press.
+     *
+     * If the game is idle (see `render()`), waits up to `IDLE_EVENT_WAIT_MS` ms for
+     * an event instead of returning right away.
      */
     void handle_events();
 
@@ -56,14 +73,24 @@ public:
      * @brief Do game logic.
      * @details
      * Pauses the game if `window` lost keyboard focus. If the game is not paused,
-     * calls `do_logic` on `currState`.
+     * calls `do_logic` on `currState`. Plays the sounds queued by the simulation.
+     * @throws Whatever stopped the simulation thread, if it stopped on an exception.
      */
     void do_logic();
 
     /// Exit `currState` and enter `nextState` if `nextState` is set.
     void change_state();
 
-    /// Do rendering if the window is not minimized.
+    /**
+     * @brief Do rendering if the window is not minimized and the scene changed.
+     * @details
+     * The scene is considered changed every frame unless the game is idle, i.e. it
+     * is paused or `currState` is static, and the frame statistics overlay is
+     * hidden. An idle scene is only rendered after events or a state change.
+     *
+     * Then waits for the next frame to be due according to the frame rate limit.
+     * @note Ends the frame for `FrameStats`.
+     */
     void render();
 
     /// Free SDL libraries and class members.
@@ -75,6 +102,18 @@ public:
     /// If `nextState` is not `GameOverState`, set it to `state`.
     void set_next_state(GameState *state);
 
+    /**
+     * @brief Run `task` on the simulation thread until `stop_simulation()`.
+     * @details
+     * The simulation gets all handled events and ticks while the game is not
+     * paused. Pausing and gamepad changes wait for the current tick to end.
+     * @note Stores a pointer to `task`.
+     */
+    void start_simulation(Simulation::Task &task);
+
+    /// Stop the simulation thread, if running. @see start_simulation
+    void stop_simulation();
+
     /**
      * @brief Load `texture` from the image stored in `path`.
      * @param[out] texture `Texture` object to initialize.
@@ -226,16 +265,30 @@ public:
 private:
     static KeyMap keyMap;
     
+    /// Pause the timers of `currState` and the simulation, and the music.
     void pause();
+
+    /// Unpause the timers of `currState` and the simulation, and the music.
     void unpause();
 
+    /// `true` if the scene only changes on events; see `render()`.
+    bool is_idle() const;
+
+    /// Tell `frameLimiter` the refresh rate presenting waits for.
+    void update_vsync_rate();
+
     Window window;
     Font font;
     Renderer renderer;
+    TextureAtlas atlas;
     GamepadManager gamepads;
     KeyLayout keyLayout;
+    FrameStatsOverlay statsOverlay;
+    FrameLimiter frameLimiter;
+    Simulation simulation;
     GameState *currState, *nextState;
     bool paused;
+    bool sceneChanged; // `true` if an idle scene has to be rendered again.
 
     int score, highScore;
     int players, winner;
@@ -12,15 +12,13 @@
 
 void Gamepad::init (int index)
 {
-    log("Initializing Gamepad " + std::to_string(index), __FILE__, __LINE__);
+    LOG_INFO("Initializing Gamepad {}", index);
 
     if (!SDL_IsGameController(index))
     {
-        log(
-            "[WARNING] Gamepad " + std::to_string(index)
-            + " is not game controller interface compatible! SDL Error: "
-            + std::string{SDL_GetError()},
-            __FILE__, __LINE__, true
+        LOG_WARNING(
+            "Gamepad {} is not game controller interface compatible! SDL Error: {}",
+            index, SDL_GetError()
         );
     }
     else
@@ -29,17 +27,13 @@ void Gamepad::init (int index)
         
         SDL_Joystick *joyTemp = SDL_GameControllerGetJoystick(gameController);
         id = SDL_JoystickInstanceID(joyTemp);
-        log(
-            "Gamepad " + std::to_string(index) + " got id " + std::to_string(id),
-            __FILE__, __LINE__
-        );
+        LOG_INFO("Gamepad {} got id {}", index, id);
 
         if (!SDL_GameControllerHasRumble(gameController))
         {
-            log(
-                "[WARNING] Gamepad " + std::to_string(index)
-                + " does not have rumble! SDL Error: " + std::string{SDL_GetError()},
-                __FILE__, __LINE__, true
+            LOG_WARNING(
+                "Gamepad {} does not have rumble! SDL Error: {}",
+                index, SDL_GetError()
             );
         }
     }
@@ -50,27 +44,20 @@ void Gamepad::init (int index)
         joystick = SDL_JoystickOpen(index);
         if (joystick == NULL)
         {
-            log(
-                "[WARNING] Unable to open joystick " + std::to_string(index)
-                + "! SDL Error: " + std::string{SDL_GetError()},
-                __FILE__, __LINE__, true
+            LOG_WARNING(
+                "Unable to open joystick {}! SDL Error: {}", index, SDL_GetError()
             );
         }
         else
         {
             id = SDL_JoystickInstanceID(joystick);
-            log(
-                "Gamepad " + std::to_string(index) + " got id " + std::to_string(id),
-                __FILE__, __LINE__
-            );
+            LOG_INFO("Gamepad {} got id {}", index, id);
 
             if (!SDL_JoystickIsHaptic(joystick))
             {
-                log(
-                    "[WARNING] Gamepad " + std::to_string(index)
-                    + " does not support haptics! SDL Error: "
-                    + std::string{SDL_GetError()},
-                    __FILE__, __LINE__, true
+                LOG_WARNING(
+                    "Gamepad {} does not support haptics! SDL Error: {}",
+                    index, SDL_GetError()
                 );
             }
             else
@@ -78,21 +65,19 @@ void Gamepad::init (int index)
                 joyHaptic = SDL_HapticOpenFromJoystick(joystick);
                 if (joyHaptic == NULL)
                 {
-                    log(
-                        "[WARNING] Unable to get Gamepad " + std::to_string(index)
-                        + " haptics! SDL Error: " + std::string{SDL_GetError()},
-                        __FILE__, __LINE__, true
+                    LOG_WARNING(
+                        "Unable to get Gamepad {} haptics! SDL Error: {}",
+                        index, SDL_GetError()
                     );
                 }
                 else
                 {
                     if (SDL_HapticRumbleInit(joyHaptic) < 0)
                     {
-                        log(
-                            "[WARNING] Unable to initialize Gamepad "
-                            + std::to_string(index) + " haptic rumble! SDL Error: "
-                            + std::string{SDL_GetError()},
-                            __FILE__, __LINE__, true
+                        LOG_WARNING(
+                            "Unable to initialize Gamepad {} haptic rumble! "
+                            "SDL Error: {}",
+                            index, SDL_GetError()
                         );
                     }
                 }
@@ -103,7 +88,7 @@ void Gamepad::init (int index)
 
 void Gamepad::free ()
 {
-    log("Freeing gamepad with id " + std::to_string(id), __FILE__, __LINE__);
+    LOG_INFO("Freeing gamepad with id {}", id);
 
     if (gameController != NULL)
     {
@@ -195,29 +180,20 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
         case SDL_JOYDEVICEADDED:
             index = e.jdevice.which;
 
-            log(
-                "A Gamepad was connected and assigned index " + std::to_string(index),
-                __FILE__, __LINE__
-            );
+            LOG_INFO("A Gamepad was connected and assigned index {}", index);
 
             if (gamepads.size() < SDL_NumJoysticks())
             {
                 if (index == gamepads.size())
                 {
-                    log(
-                        "Appending Gamepad " + std::to_string(index),
-                        __FILE__, __LINE__
-                    );
+                    LOG_INFO("Appending Gamepad {}", index);
 
                     gamepads.resize(gamepads.size() + 1);
                     gamepads[index].init(index);
                 }
                 else if (!gamepads[index].is_attached())
                 {
-                    log(
-                        "[WARNING] Inserting Gamepad " + std::to_string(index),
-                        __FILE__, __LINE__, true
-                    );
+                    LOG_WARNING("Inserting Gamepad {}", index);
 
                     gamepads.resize(gamepads.size() + 1);
                     for (int i = gamepads.size() - 1; i > index; --i)
@@ -229,19 +205,14 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
             }
             else if (!gamepads[index].is_attached())
             {
-                log(
-                    "[WARNING] Reinitializing Gamepad " + std::to_string(index),
-                    __FILE__, __LINE__, true
-                );
+                LOG_WARNING("Reinitializing Gamepad {}", index);
 
                 gamepads[index].init(index);
             }
             else
             {
-                log(
-                    "Gamepad " + std::to_string(index)
-                    + " was initialized before the event handling",
-                    __FILE__, __LINE__
+                LOG_INFO(
+                    "Gamepad {} was initialized before the event handling", index
                 );
             }
             break;
@@ -249,10 +220,7 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
         case SDL_JOYDEVICEREMOVED:
             id = e.jdevice.which;
 
-            log(
-                "The Gamepad with id " + std::to_string(id) + " was removed",
-                __FILE__, __LINE__
-            );
+            LOG_INFO("The Gamepad with id {} was removed", id);
 
             int i;
             for (i = 0; i < gamepads.size(); ++i)
@@ -266,10 +234,7 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
             {
                 if (!gamepads[i].is_attached())
                 {
-                    log(
-                        "Gamepad " + std::to_string(i) + " is not attached, removing",
-                        __FILE__, __LINE__
-                    );
+                    LOG_INFO("Gamepad {} is not attached, removing", i);
 
                     gamepads[i].free();
                     for (int j = i; j < gamepads.size() - 1; ++j)
@@ -280,19 +245,16 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
                 }
                 else
                 {
-                    log(
-                        "Gamepad " + std::to_string(i)
-                        + " was reattached before the event handling",
-                        __FILE__, __LINE__
+                    LOG_INFO(
+                        "Gamepad {} was reattached before the event handling", i
                     );
                 }
             }
             else
             {
-                log(
-                    "Gamepad with id " + std::to_string(id)
-                    + " was not initialized before the event handling",
-                    __FILE__, __LINE__
+                LOG_INFO(
+                    "Gamepad with id {} was not initialized before the event "
+                    "handling", id
                 );
             }
             break;
@@ -302,10 +264,9 @@ void GamepadManager::handle_event (Game &game, const SDL_Event &e)
         && gamepads.size() != SDL_NumJoysticks()
     )
     {
-        log(
-            "[WARNING] Gamepads stored " + std::to_string(gamepads.size())
-            + " != total joysticks " + std::to_string(SDL_NumJoysticks()),
-            __FILE__, __LINE__, true
+        LOG_WARNING(
+            "Gamepads stored {} != total joysticks {}",
+            gamepads.size(), SDL_NumJoysticks()
         );
     }
 }
@@ -0,0 +1,197 @@
+/**
+ * @file  glyph_atlas.cpp
+ * @brief Implementation of the class GlyphAtlas.
+ */
+
+#include "glyph_atlas.hpp"
+#include "font.hpp"
+#include "trace.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+
+void GlyphAtlas::init (Renderer &renderer, Font &font)
+{
+    TRACE_ZONE("GlyphAtlas::init");
+
+    ptSize = font.get_size();
+    lineHeight = font.get_height();
+
+    LOG_DEBUG("Rasterizing glyphs at point size {}", ptSize);
+
+    SDL_Surface *surfaces[GLYPHS_TOTAL] = {};
+    SDL_Surface *page = NULL;
+    try
+    {
+        // Place the glyphs on rows about 16 glyphs wide, 1 pixel apart, narrower
+        // if the renderer does not allow textures that wide
+        int rowMax = 16 * lineHeight;
+        if (renderer.get_max_texture_size() > 0)
+        {
+            rowMax = min(rowMax, renderer.get_max_texture_size());
+        }
+        int x = 0, y = 0, rowH = 0, pageW = 0;
+        for (int i = 0; i < GLYPHS_TOTAL; ++i)
+        {
+            char c = FIRST_GLYPH + i;
+            surfaces[i] = font.create_glyph_surface(c, WHITE);
+            int w = surfaces[i]->w, h = surfaces[i]->h;
+            if (x > 0 && x + w > rowMax)
+            {
+                x = 0;
+                y += rowH + 1;
+                rowH = 0;
+            }
+            glyphs[i].clip = {x, y, w, h};
+            glyphs[i].advance = font.get_glyph_advance(c);
+            x += w + 1;
+            rowH = max(rowH, h);
+            pageW = max(pageW, x);
+        }
+
+        page = SDL_CreateRGBSurfaceWithFormat(
+            0, max(1, pageW), max(1, y + rowH), 32, SDL_PIXELFORMAT_RGBA32
+        );
+        if (page == NULL)
+        {
+            throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
+        }
+        for (int i = 0; i < GLYPHS_TOTAL; ++i)
+        {
+            // Copy the coverage as is instead of blending it onto the page
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(surfaces[i], NULL, page, &glyphs[i].clip);
+        }
+        texture.load_from_surface(renderer, page);
+    }
+    catch (...)
+    {
+        for (SDL_Surface *surface : surfaces)
+        {
+            SDL_FreeSurface(surface);
+        }
+        SDL_FreeSurface(page);
+        ptSize = -1;
+        throw;
+    }
+    for (SDL_Surface *surface : surfaces)
+    {
+        SDL_FreeSurface(surface);
+    }
+    SDL_FreeSurface(page);
+
+    kerning.resize(GLYPHS_TOTAL * GLYPHS_TOTAL);
+    for (int prev = 0; prev < GLYPHS_TOTAL; ++prev)
+    {
+        for (int i = 0; i < GLYPHS_TOTAL; ++i)
+        {
+            kerning[prev * GLYPHS_TOTAL + i] = font.get_kerning(
+                FIRST_GLYPH + prev, FIRST_GLYPH + i
+            );
+        }
+    }
+}
+
+void GlyphAtlas::free ()
+{
+    texture.free();
+    kerning.clear();
+    ptSize = -1;
+}
+
+int GlyphAtlas::get_size () const
+{
+    return ptSize;
+}
+
+int GlyphAtlas::get_bytes () const
+{
+    return texture.get_width() * texture.get_height() * 4;
+}
+
+bool GlyphAtlas::has_glyphs (std::string_view text) const
+{
+    for (char c : text)
+    {
+        if (c != '\n' && (c < FIRST_GLYPH || c > LAST_GLYPH))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int GlyphAtlas::get_text_width (std::string_view text) const
+{
+    int width = 0, pen = 0;
+    char prev = '\n';
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            pen = 0;
+        }
+        else
+        {
+            if (prev != '\n')
+            {
+                pen += get_kerning(prev, c);
+            }
+            const Glyph &glyph = get_glyph(c);
+            width = max(width, pen + glyph.clip.w);
+            pen += glyph.advance;
+            width = max(width, pen);
+        }
+        prev = c;
+    }
+    return width;
+}
+
+int GlyphAtlas::get_text_height (std::string_view text) const
+{
+    int lines = 1;
+    for (char c : text)
+    {
+        lines += c == '\n';
+    }
+    return lines * lineHeight;
+}
+
+void GlyphAtlas::render (int x, int y, std::string_view text, const Color &color)
+{
+    texture.set_color(&color);
+
+    int pen = 0;
+    char prev = '\n';
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            pen = 0;
+            y += lineHeight;
+        }
+        else
+        {
+            if (prev != '\n')
+            {
+                pen += get_kerning(prev, c);
+            }
+            const Glyph &glyph = get_glyph(c);
+            texture.render(
+                {x + pen, y, glyph.clip.w, glyph.clip.h}, &glyph.clip
+            );
+            pen += glyph.advance;
+        }
+        prev = c;
+    }
+}
+
+const GlyphAtlas::Glyph &GlyphAtlas::get_glyph (char c) const
+{
+    return glyphs[c - FIRST_GLYPH];
+}
+
+int GlyphAtlas::get_kerning (char prev, char c) const
+{
+    return kerning[(prev - FIRST_GLYPH) * GLYPHS_TOTAL + c - FIRST_GLYPH];
+}
@@ -0,0 +1,96 @@
+/**
+ * @file  glyph_atlas.hpp
+ * @brief Include file for GlyphAtlas class.
+ */
+
+#ifndef GLYPH_ATLAS_HPP
+#define GLYPH_ATLAS_HPP
+
+
+#include "renderer.hpp"
+#include "texture.hpp"
+#include "util.hpp"
+
+#include <string_view>
+#include <vector>
+
+
+class Font;
+
+/**
+ * @brief The printable ASCII glyphs of a font at one point size, rasterized once
+ *     into a single texture.
+ * @details
+ * Glyphs are rasterized white and tinted per quad, so text of any color is drawn as
+ * batched quads of the same texture from cached metrics. Changing the text only
+ * changes the quads: nothing is rasterized, allocated or uploaded.
+ *
+ * Lines are separated with `'\n'` and left aligned, like text surfaces of `Font`.
+ */
+class GlyphAtlas
+{
+public:
+    /**
+     * @brief Rasterize the glyphs of `font` at its current point size.
+     * @details
+     * Rows of glyphs are wrapped to the maximum texture size of `renderer`, which
+     * fits the glyphs of any point size up to `GLYPH_ATLAS_MAX_PT_SIZE`.
+     * @note Stores a pointer to `renderer`.
+     * @throws `ExceptionSDL` thrown if a glyph could not be rasterized.
+     */
+    void init(Renderer &renderer, Font &font);
+
+    /// Free the texture.
+    void free();
+
+    /// Get the point size the glyphs were rasterized with.
+    int get_size() const;
+
+    /// Get the amount of texture memory the glyphs take.
+    int get_bytes() const;
+
+    /// `true` if the atlas has every glyph of `text`.
+    bool has_glyphs(std::string_view text) const;
+
+    /// Get the width of the widest line of `text`.
+    int get_text_width(std::string_view text) const;
+
+    /// Get the height of all lines of `text`.
+    int get_text_height(std::string_view text) const;
+
+    /**
+     * @brief Queue the quads of `text` with upper left corner at (`x`, `y`).
+     * @note `text` has to consist of the atlas glyphs, see `has_glyphs()`.
+     * @param x Upper left corner x coordinate.
+     * @param y Upper left corner y coordinate.
+     * @param text The text.
+     * @param color Text color.
+     */
+    void render(int x, int y, std::string_view text, const Color &color);
+
+private:
+    static constexpr char FIRST_GLYPH = ' ';
+    static constexpr char LAST_GLYPH = '~';
+    static constexpr int GLYPHS_TOTAL = LAST_GLYPH - FIRST_GLYPH + 1;
+
+    struct Glyph
+    {
+        SDL_Rect clip; // Glyph quad in `texture`.
+        int advance; // Pixels to move the pen by after the glyph.
+    };
+
+    /// Get the glyph of the printable ASCII character `c`.
+    const Glyph &get_glyph(char c) const;
+
+    /// Get the kerning between the printable ASCII characters `prev` and `c`.
+    int get_kerning(char prev, char c) const;
+
+    Texture texture;
+    Glyph glyphs[GLYPHS_TOTAL];
+    std::vector<int> kerning; // `GLYPHS_TOTAL` x `GLYPHS_TOTAL` by glyph indices.
+    int ptSize = -1; // `-1` if not rasterized.
+    int lineHeight;
+};
+
+
+#endif
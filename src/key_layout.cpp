@@ -7,10 +7,33 @@
 #include "game.hpp"
 #include "logger.hpp"
 
+#include <algorithm>
+
+
+const Uint8 *KeyLayout::keyboardState = nullptr;
+
 
 void KeyLayout::init (KeyMap &mapping, GamepadManager *gamepads, int gamepadInd)
 {
-    this->mapping = mapping;
+    bindings.clear();
+    for (const auto &mapKeys : mapping)
+    {
+        for (int code : mapKeys.second)
+        {
+            bindings.push_back({code, mapKeys.first, SDL_SCANCODE_UNKNOWN});
+        }
+    }
+
+    // A code mapped to several commands triggers the first one, as stable sorting
+    // keeps the command order
+    codeIndex = bindings;
+    std::stable_sort(
+        codeIndex.begin(), codeIndex.end(),
+        [](const Binding &a, const Binding &b) { return a.code < b.code; }
+    );
+    update_scancodes();
+
+    pressedKeyMaps.reserve(mapping.size());
     this->gamepads = gamepads;
     this->gamepadInd = gamepadInd;
 }
@@ -34,6 +57,9 @@ void KeyLayout::handle_event (Game &game, const SDL_Event &e)
         code = e.key.keysym.sym;
         repeat = e.key.repeat;
         break;
+    case SDL_KEYMAPCHANGED:
+        update_scancodes();
+        break;
     }
 
     switch (eventType)
@@ -50,17 +76,19 @@ void KeyLayout::handle_event (Game &game, const SDL_Event &e)
         // Falls through
     case SDL_KEYDOWN:
     case SDL_KEYUP:
+    {
         // Get the triggered command
-        for (const auto &mapKeys : mapping)
+        auto binding = std::lower_bound(
+            codeIndex.begin(), codeIndex.end(), code,
+            [](const Binding &binding, int code) { return binding.code < code; }
+        );
+        if (binding != codeIndex.end() && binding->code == code)
         {
-            if (mapKeys.second.find(code) != mapKeys.second.end())
-            {
-                command = mapKeys.first;
-                break;
-            }
+            command = binding->command;
         }
         break;
     }
+    }
 }
 
 KeyLayout::EventType KeyLayout::get_type () const
@@ -89,35 +117,43 @@ Uint8 KeyLayout::get_repeat () const
 
 void KeyLayout::store_pressed ()
 {
-    const Uint8 *keys = SDL_GetKeyboardState(NULL);
+    const Uint8 *keys = keyboardState ? keyboardState : SDL_GetKeyboardState(NULL);
     pressedKeyMaps.clear();
-    for (const auto &mapKeys : mapping)
+    for (const Binding &binding : bindings)
     {
-        for (const auto &key : mapKeys.second)
+        // Bindings of a command are adjacent, so it is enough to skip the rest
+        if (!pressedKeyMaps.empty() && pressedKeyMaps.back() == binding.command)
+        {
+            continue;
+        }
+        bool keyPressed = binding.code < GP_CODE_SEP
+            ? keys[binding.scancode] != 0
+            : gamepads->button_pressed(gamepadInd, binding.code - GP_CODE_SEP);
+        if (keyPressed)
         {
-            // Check the keyboard codes
-            if (key < GP_CODE_SEP)
-            {
-                if (keys[SDL_GetScancodeFromKey(key)])
-                {
-                    pressedKeyMaps.insert(mapKeys.first);
-                    break;
-                }
-            }
-            // Check the gamepad codes
-            else
-            {
-                if (gamepads->button_pressed(gamepadInd, key - GP_CODE_SEP))
-                {
-                    pressedKeyMaps.insert(mapKeys.first);
-                    break;
-                }
-            }
+            pressedKeyMaps.push_back(binding.command);
         }
     }
 }
 
 bool KeyLayout::pressed (int command) const
 {
-    return pressedKeyMaps.find(command) != pressedKeyMaps.end();
+    return std::find(pressedKeyMaps.begin(), pressedKeyMaps.end(), command)
+        != pressedKeyMaps.end();
+}
+
+void KeyLayout::update_scancodes ()
+{
+    for (Binding &binding : bindings)
+    {
+        if (binding.code < GP_CODE_SEP)
+        {
+            binding.scancode = SDL_GetScancodeFromKey(binding.code);
+        }
+    }
+}
+
+void KeyLayout::set_keyboard_state (const Uint8 *keys)
+{
+    keyboardState = keys;
 }
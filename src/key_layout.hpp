@@ -12,6 +12,7 @@
 #include <SDL2/SDL.h>
 #include <map>
 #include <set>
+#include <vector>
 
 
 /**
@@ -94,6 +95,9 @@ public:
 
     /**
      * @brief Initialize class members.
+     * @details
+     * Flattens `mapping` into bindings sorted by key code, so that handling an event
+     * takes a binary search, and looks up the scancodes of the mapped keys once.
      * @param mapping The mappings for commands.
      * @param gamepads A `GamepadManager` object to use for functionality support.
      * @param gamepadInd Gamepad to get input from; set to
@@ -104,7 +108,11 @@ public:
         KeyMap &mapping, GamepadManager *gamepads, int gamepadInd=GAMEPAD_NONE
     );
 
-    /// On supported input event, store the event type and the mapped command.
+    /**
+     * @brief On supported input event, store the event type and the mapped command.
+     * @details
+     * On `SDL_KEYMAPCHANGED` looks the scancodes of the mapped keys up again.
+     */
     void handle_event(Game &game, const SDL_Event &e);
 
     /// Get the last handled event type.
@@ -125,15 +133,36 @@ public:
     /// `true` if `command` had its key pressed at the last `store_pressed()` call.
     bool pressed(int command) const;
 
+    /**
+     * @brief Make `store_pressed()` read keyboard key states from `keys`, e.g. when
+     *     replaying input.
+     * @param keys Key states indexed by `SDL_Scancode`; `nullptr` to read SDL's.
+     */
+    static void set_keyboard_state(const Uint8 *keys);
+
 private:
-    KeyMap mapping; // The mapping of commands to key codes.
+    /// A key code or a gamepad button mapped to a command.
+    struct Binding
+    {
+        int code; // Key code, or `GP_CODE_SEP` + `SDL_GameControllerButton`.
+        int command;
+        SDL_Scancode scancode; // Scancode of the key code, if `code` is one.
+    };
+
+    /// Look the scancodes of the key codes in `bindings` up.
+    void update_scancodes();
+
+    static const Uint8 *keyboardState; // `nullptr` if SDL's is read.
+
+    std::vector<Binding> bindings; // Sorted by command, as mapped.
+    std::vector<Binding> codeIndex; // `bindings` sorted by code, without scancodes.
     GamepadManager *gamepads;
     int gamepadInd; // The index of the gamepad to get input from.
     Uint32 eventType;
     int code; // The last key code.
     int command; // The last triggered command.
     Uint8 repeat;
-    std::set<int> pressedKeyMaps;
+    std::vector<int> pressedKeyMaps; // Reserved for all commands in `init()`.
 };
 
 
@@ -1,15 +1,203 @@
 /**
  * @file  logger.cpp
- * @brief Implementation of the class Logger and its helper functions.
+ * @brief Implementation of Logger and LogRecordWriter classes.
  */
 #include "logger.hpp"
 #include "exceptions.hpp"
 
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+
+static_assert(
+    (LOG_RING_LEN & (LOG_RING_LEN - 1)) == 0, "LOG_RING_LEN must be a power of two"
+);
+
+
+LogRecordWriter::LogRecordWriter (char *buffer)
+    : begin(buffer)
+    , out(buffer)
+#ifdef LOG_BINARY
+    , end(buffer + LOG_RECORD_LEN)
+#else
+    , end(buffer + LOG_RECORD_LEN - 1) // Keep room for the newline
+#endif
+    , truncated(false)
+{}
+
+void LogRecordWriter::begin_message (const LogSite &site)
+{
+#ifdef LOG_BINARY
+    out += sizeof(uint16_t); // Record length, set by `finish`
+    uint8_t kind = LOG_RECORD_MESSAGE;
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    put_bytes(&kind, sizeof(kind));
+    put_bytes(&id, sizeof(id));
+#else
+    put_bytes(site.file, strlen(site.file));
+    put_bytes("\t", 1);
+    put_int(site.line);
+    put_bytes(": \t[", 4);
+    const char *levelName = get_log_level_name(site.level);
+    put_bytes(levelName, strlen(levelName));
+    put_bytes("] ", 2);
+#endif
+}
+
+void LogRecordWriter::put_literal ([[maybe_unused]] const char *&format)
+{
+#ifndef LOG_BINARY
+    const char *placeholder = strstr(format, "{}");
+    if (placeholder == nullptr)
+    {
+        size_t len = strlen(format);
+        put_bytes(format, len);
+        format += len;
+        return;
+    }
+    put_bytes(format, placeholder - format);
+    format = placeholder + 2;
+#endif
+}
+
+int LogRecordWriter::finish ([[maybe_unused]] const char *format)
+{
+#ifdef LOG_BINARY
+    uint16_t len = out - begin;
+    memcpy(begin, &len, sizeof(len));
+#else
+    put_bytes(format, strlen(format));
+    *out++ = '\n';
+#endif
+    return out - begin;
+}
+
+#ifdef LOG_BINARY
+void LogRecordWriter::put_definition (const LogSite &site, int id)
+{
+    out += sizeof(uint16_t);
+    uint8_t kind = LOG_RECORD_DEFINITION, level = site.level;
+    uint32_t siteId = id;
+    int32_t line = site.line;
+    put_bytes(&kind, sizeof(kind));
+    put_bytes(&siteId, sizeof(siteId));
+    put_bytes(&level, sizeof(level));
+    put_bytes(&line, sizeof(line));
+    for (const char *str : {site.file, site.format})
+    {
+        uint16_t len = std::min<size_t>(
+            strlen(str), std::max<long>(0, end - out - sizeof(len))
+        );
+        put_bytes(&len, sizeof(len));
+        put_bytes(str, len);
+    }
+}
+
+void LogRecordWriter::put_dropped (int count)
+{
+    out += sizeof(uint16_t);
+    uint8_t kind = LOG_RECORD_DROPPED;
+    uint32_t amount = count;
+    put_bytes(&kind, sizeof(kind));
+    put_bytes(&amount, sizeof(amount));
+}
+#endif
+
+void LogRecordWriter::put_int (long long value)
+{
+#ifdef LOG_BINARY
+    uint8_t tag = LOG_ARG_INT;
+    int64_t raw = value;
+    put_bytes(&tag, sizeof(tag)) && put_bytes(&raw, sizeof(raw));
+#else
+    char buf[24];
+    put_bytes(buf, snprintf(buf, sizeof(buf), "%lld", value));
+#endif
+}
+
+void LogRecordWriter::put_uint (unsigned long long value)
+{
+#ifdef LOG_BINARY
+    uint8_t tag = LOG_ARG_UINT;
+    uint64_t raw = value;
+    put_bytes(&tag, sizeof(tag)) && put_bytes(&raw, sizeof(raw));
+#else
+    char buf[24];
+    put_bytes(buf, snprintf(buf, sizeof(buf), "%llu", value));
+#endif
+}
+
+void LogRecordWriter::put_double (double value)
+{
+#ifdef LOG_BINARY
+    uint8_t tag = LOG_ARG_DOUBLE;
+    put_bytes(&tag, sizeof(tag)) && put_bytes(&value, sizeof(value));
+#else
+    char buf[32];
+    put_bytes(buf, snprintf(buf, sizeof(buf), "%g", value));
+#endif
+}
+
+void LogRecordWriter::put_string (std::string_view value)
+{
+#ifdef LOG_BINARY
+    // Long strings are cut to the space left, so that the record stays decodable
+    uint8_t tag = LOG_ARG_STRING;
+    uint16_t len = std::min<size_t>(
+        value.size(), std::max<long>(0, end - out - sizeof(tag) - sizeof(len))
+    );
+    put_bytes(&tag, sizeof(tag)) && put_bytes(&len, sizeof(len))
+        && put_bytes(value.data(), len);
+#else
+    put_bytes(value.data(), value.size());
+#endif
+}
+
+bool LogRecordWriter::put_bytes (const void *data, size_t len)
+{
+    if (truncated)
+    {
+        return false;
+    }
+    if (len > size_t(end - out))
+    {
+        // Text is cut at the end of the record, while binary values are either
+        // whole or missing
+        truncated = true;
+#ifndef LOG_BINARY
+        len = end - out;
+        memcpy(out, data, len);
+        out += len;
+#endif
+        return false;
+    }
+    memcpy(out, data, len);
+    out += len;
+    return true;
+}
+
 
 Logger Logger::logger;
 
 
-Logger::Logger () {}
+Logger::Logger ()
+    : enqueuePos(0)
+    , dequeuePos(0)
+    , dropped(0)
+    , failed(false)
+    , nextSiteId(0)
+    , running(false)
+    , wakeRequested(false)
+    , drainedPos(0)
+{}
+
+Logger::~Logger ()
+{
+    stop();
+}
 
 Logger *Logger::get ()
 {
@@ -18,52 +206,250 @@ Logger *Logger::get ()
 
 void Logger::init (const std::string &path)
 {
+#ifdef LOG_BINARY
+    fout.open(path, std::ios::binary);
+#else
     fout.open(path);
+#endif
     if (fout.fail())
     {
         std::string msg = "Could not open \"" + path + "\"";
         throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
     }
-    
-    currLen = 0;
-}
 
-void Logger::write_to_buffer (const std::string &msg, bool flush)
-{
-    buffer << msg;
-
-    if (flush || (currLen += msg.size() > MAX_BUFFER_LEN))
+    if (!records)
+    {
+        records.reset(new Record[LOG_RING_LEN]);
+    }
+    batch.reserve(LOG_BATCH_LEN);
+    for (size_t pos = 0; pos < LOG_RING_LEN; ++pos)
     {
-        this->flush();
+        records[pos].sequence.store(pos, std::memory_order_relaxed);
     }
+    enqueuePos.store(0);
+    dequeuePos = 0;
+    drainedPos.store(0);
+    dropped.store(0);
+    failed.store(false);
+
+    running.store(true);
+    writer = std::thread(&Logger::run, this);
 }
 
 void Logger::flush ()
 {
-    fout << buffer.str() << std::flush;
-    if (fout.fail())
+    if (running.load())
+    {
+        size_t target = enqueuePos.load();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeRequested.store(true);
+        wake.notify_one();
+        drained.wait(
+            lock, [this, target]{ return drainedPos.load() >= target || !running; }
+        );
+    }
+    else if (records)
+    {
+        drain();
+    }
+
+    if (failed.load())
     {
         throw ExceptionFile(__FILE__, __LINE__, "Could not write to log");
     }
+}
 
-    buffer.str("");
-    currLen = 0;
+void Logger::crash_flush ()
+{
+    stop();
+    if (records)
+    {
+        drain();
+    }
 }
 
 void Logger::free ()
 {
+    stop();
+    if (records)
+    {
+        drain();
+    }
     fout.close();
 }
 
+Logger::Record *Logger::claim (size_t &pos)
+{
+    if (!records)
+    {
+        return nullptr;
+    }
 
-const std::string make_log_msg (const char *file, int line, const std::string &msg)
+    // Bounded multi-producer queue: a record at `pos` is free for writing when its
+    // sequence equals `pos`; producers race for it by advancing `enqueuePos`
+    pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Record *record = &records[pos & (LOG_RING_LEN - 1)];
+        size_t sequence = record->sequence.load(std::memory_order_acquire);
+        long long diff = (long long)sequence - (long long)pos;
+        if (diff == 0)
+        {
+            if (
+                enqueuePos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed
+                )
+            )
+            {
+                return record;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The writer thread has not drained this record yet
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+Logger::Record *Logger::claim ([[maybe_unused]] LogSite &site, size_t &pos)
 {
-    std::stringstream _msg;
-    _msg << file << "\t" << line << ": \t" << msg << "\n";
-    return _msg.str();
+#ifdef LOG_BINARY
+    if (site.id.load(std::memory_order_acquire) < 0)
+    {
+        // The definition goes before the id is published, so that every message
+        // using the id comes after it. If the ring is full, the next call retries
+        size_t definitionPos;
+        Record *record = claim(definitionPos);
+        if (record == nullptr)
+        {
+            return nullptr;
+        }
+        int id = nextSiteId.fetch_add(1, std::memory_order_relaxed);
+        LogRecordWriter definitionWriter(record->text);
+        definitionWriter.put_definition(site, id);
+        record->len = definitionWriter.finish("");
+        publish(record, definitionPos, false);
+
+        // Losing the race only leaves an unused definition
+        int expected = -1;
+        site.id.compare_exchange_strong(expected, id);
+    }
+#endif
+    return claim(pos);
 }
 
-void log (const std::string &msg, const char *file, int line, bool flush)
+void Logger::publish (Record *record, size_t pos, bool flush)
 {
-    Logger::get()->write_to_buffer(make_log_msg(file, line, msg), flush);
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    // Notifying without the mutex can miss a writer that is about to wait, which
+    // only delays the write until its next wakeup
+    if (flush && !wakeRequested.exchange(true))
+    {
+        wake.notify_one();
+    }
 }
+
+bool Logger::drain ()
+{
+    batch.clear();
+
+    while (true)
+    {
+        Record *record = &records[dequeuePos & (LOG_RING_LEN - 1)];
+        if (record->sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+        {
+            break;
+        }
+        if (batch.size() + record->len > LOG_BATCH_LEN)
+        {
+            write_batch();
+        }
+        batch.append(record->text, record->len);
+        record->sequence.store(dequeuePos + LOG_RING_LEN, std::memory_order_release);
+        ++dequeuePos;
+    }
+
+    int droppedNow = dropped.exchange(0);
+    if (droppedNow)
+    {
+        char record[LOG_RECORD_LEN];
+#ifdef LOG_BINARY
+        LogRecordWriter droppedWriter(record);
+        droppedWriter.put_dropped(droppedNow);
+        int len = droppedWriter.finish("");
+#else
+        int len = snprintf(
+            record, sizeof(record),
+            "[WARNING] %d log messages dropped: the log buffer was full\n",
+            droppedNow
+        );
+#endif
+        if (batch.size() + len > LOG_BATCH_LEN)
+        {
+            write_batch();
+        }
+        batch.append(record, len);
+    }
+
+    write_batch();
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        drainedPos.store(dequeuePos);
+    }
+    drained.notify_all();
+
+    return !failed.load();
+}
+
+void Logger::write_batch ()
+{
+    if (!batch.empty())
+    {
+        fout.write(batch.data(), batch.size());
+        fout.flush();
+        if (fout.fail())
+        {
+            failed.store(true);
+        }
+        batch.clear();
+    }
+}
+
+void Logger::run ()
+{
+    while (running.load())
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(
+                lock, std::chrono::milliseconds(LOG_WRITE_INTERVAL),
+                [this]{ return wakeRequested.load() || !running.load(); }
+            );
+            wakeRequested.store(false);
+        }
+        drain();
+    }
+}
+
+void Logger::stop ()
+{
+    if (writer.joinable() && writer.get_id() != std::this_thread::get_id())
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            running.store(false);
+        }
+        wake.notify_one();
+        writer.join();
+    }
+    running.store(false);
+}
+
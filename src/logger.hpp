@@ -10,17 +10,184 @@
 #include "constants.hpp"
 
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <fstream>
-#include <sstream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/// Log message severities in increasing order.
+enum LogLevel
+{
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+    LOG_LEVELS_TOTAL
+};
+
+/// Messages below this level are compiled out. Override with `-DLOG_MIN_LEVEL=n`.
+#ifndef LOG_MIN_LEVEL
+#ifdef DEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+/// Get the name of `level`.
+inline const char *get_log_level_name (int level)
+{
+    static const char *names[LOG_LEVELS_TOTAL] = {
+        "DEBUG", "INFO", "WARNING", "ERROR"
+    };
+    return level >= 0 && level < LOG_LEVELS_TOTAL ? names[level] : "?";
+}
+
+/**
+ * @brief Binary log record kinds.
+ * @details
+ * With `LOG_BINARY` defined, records are written in native byte order as:
+ * - `uint16` record length including itself, `uint8` kind, then
+ * - `LOG_RECORD_DEFINITION`: `uint32` site id, `uint8` level, `int32` line, file
+ *   and format as strings,
+ * - `LOG_RECORD_MESSAGE`: `uint32` site id, then every argument as `uint8` tag and
+ *   value; arguments which did not fit the record are missing,
+ * - `LOG_RECORD_DROPPED`: `uint32` amount of dropped messages.
+ *
+ * Strings are stored as `uint16` length and bytes.
+ */
+enum LogRecordKind
+{
+    LOG_RECORD_DEFINITION,
+    LOG_RECORD_MESSAGE,
+    LOG_RECORD_DROPPED
+};
+
+/// Binary log argument tags and their value types.
+enum LogArgTag
+{
+    LOG_ARG_INT = 'i', // int64
+    LOG_ARG_UINT = 'u', // uint64
+    LOG_ARG_DOUBLE = 'd', // double
+    LOG_ARG_STRING = 's' // string
+};
+
+/// A logging call site. Every `LOG_*` macro stores one statically.
+struct LogSite
+{
+    constexpr LogSite (LogLevel level, const char *format, const char *file, int line)
+        : level(level)
+        , format(format)
+        , file(file)
+        , line(line)
+        , id(-1)
+    {}
+
+    LogLevel level;
+    const char *format; // Message with `{}` placeholders for the arguments.
+    const char *file;
+    int line;
+    std::atomic<int> id; // Binary log site id, assigned on first use.
+};
+
+/**
+ * @brief Serializes a single message into a log record.
+ * @details
+ * In text mode the `{}` placeholders of the format are replaced by the formatted
+ * arguments. With `LOG_BINARY` defined, only the site id and the raw arguments are
+ * stored and formatting is left to `tools/log_decode`.
+ */
+class LogRecordWriter
+{
+public:
+    /// Start writing into `buffer` of `LOG_RECORD_LEN` bytes.
+    explicit LogRecordWriter(char *buffer);
+
+    /// Write the message prefix (text) or header (binary) of `site`.
+    void begin_message(const LogSite &site);
+
+    /**
+     * @brief Copy `format` up to the next placeholder (text only).
+     * @param[in,out] format Advanced past the placeholder.
+     */
+    void put_literal(const char *&format);
+
+    /// Write a single argument.
+    template <typename T>
+    void put_arg (const T &value)
+    {
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            put_int(value);
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            put_uint(value);
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            put_int((long long)value);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            put_double(value);
+        }
+        else
+        {
+            put_string(std::string_view(value));
+        }
+    }
+
+    /**
+     * @brief Finish the record.
+     * @param format Rest of the format after the last argument.
+     * @return Length of the record.
+     */
+    int finish(const char *format);
+
+#ifdef LOG_BINARY
+    /// Write the definition record of `site`.
+    void put_definition(const LogSite &site, int id);
+
+    /// Write the dropped messages record.
+    void put_dropped(int count);
+#endif
+
+private:
+    void put_int(long long value);
+    void put_uint(unsigned long long value);
+    void put_double(double value);
+    void put_string(std::string_view value);
+
+    /// Append `len` bytes if they fit, otherwise mark the record truncated.
+    bool put_bytes(const void *data, size_t len);
+
+    char *begin, *out, *end;
+    bool truncated;
+};
 
 
 /**
  * @brief Logging singleton class.
+ * @details
+ * Messages are formatted straight into fixed size records of a lock-free bounded
+ * multi-producer ring buffer. A background thread drains the ring every
+ * `LOG_WRITE_INTERVAL` ms, or sooner when asked to, and writes the records in
+ * batches. Logging never blocks: if the ring is full, the message is dropped and
+ * counted, and the amount of dropped messages is written to the log later.
+ *
+ * Messages are logged with the `LOG_*` macros, which compile out below
+ * `LOG_MIN_LEVEL` without evaluating their arguments.
  * @example
- * 
- *     Logger::get()->init("log.txt");
- *     log("Log message", __FILE__, __LINE__);
- *     log("Another log message", __FILE__, __LINE__);
+ *
+ *     Logger::get()->init(LOG_PATH);
+ *     LOG_INFO("Log message");
+ *     LOG_DEBUG("Loaded {} of {} blocks", loaded, total);
  *     Logger::get()->flush(); // Flush before closing
  *     Logger::get()->free();
  */
@@ -30,57 +197,158 @@ public:
     /// Get the singleton instance.
     static Logger *get();
 
-    /// Max characters stored in the buffer before flushing.
-    static constexpr int MAX_BUFFER_LEN = 1024;
+    /// Stop the writer thread if it is running.
+    ~Logger();
 
     /**
-     * @brief Open `path` for logging.
+     * @brief Open `path` for logging and start the writer thread.
      * @param path Output file path.
      * @throws `ExceptionFile` thrown if `path` does not exist or is not readable.
      */
     void init(const std::string &path);
 
     /**
-     * @brief Write `msg` to the buffer.
-     * @param msg The message.
-     * @param flush If true, flush after writing.
+     * @brief Store a message of `site` in the ring buffer.
+     * @details
+     * Warnings and errors wake the writer thread to write them right away.
+     * @note Should only be called by the `LOG_*` macros. Messages longer than
+     *     `LOG_RECORD_LEN` are truncated.
+     * @param site The logging call site.
+     * @param format Same as the format of `site`.
+     * @param args Arguments replacing the placeholders of the format.
      */
-    void write_to_buffer(const std::string &msg, bool flush=FLUSH_ALL);
+    template <typename... Args>
+    void write (LogSite &site, const char *format, const Args &...args)
+    {
+        size_t pos;
+        Record *record = claim(site, pos);
+        if (record == nullptr)
+        {
+            return;
+        }
+
+        LogRecordWriter recordWriter(record->text);
+        recordWriter.begin_message(site);
+        ((recordWriter.put_literal(format), recordWriter.put_arg(args)), ...);
+        record->len = recordWriter.finish(format);
+        publish(record, pos, site.level >= LOG_LEVEL_WARNING);
+    }
 
     /**
-     * @brief Flush the buffer.
-     * @throws `ExceptionFile` thrown if buffer contents could not be written to path.
+     * @brief Wait until the writer thread wrote all stored messages and flush the
+     *     output file.
+     * @throws `ExceptionFile` thrown if the messages could not be written to path.
      */
     void flush();
 
-    /// Close the output file.
+    /**
+     * @brief Write all stored messages from the calling thread and flush the output
+     *     file.
+     * @details
+     * Stops the writer thread first so that it can be used when the game is in an
+     * unknown state, e.g. from exception handlers in `main`. Logging keeps working
+     * afterwards, but messages are only written on `flush()` and `free()`.
+     * @note Does not throw.
+     */
+    void crash_flush();
+
+    /// Stop the writer thread, write all stored messages and close the output file.
     void free();
 
 private:
+    /// A single preformatted message.
+    struct Record
+    {
+        /// Ring position this record is ready for. Equals position + 1 once written.
+        std::atomic<size_t> sequence;
+        int len;
+        char text[LOG_RECORD_LEN];
+    };
+
     static Logger logger;
     Logger();
 
+    /**
+     * @brief Claim a free record.
+     * @param[out] pos Ring position of the claimed record.
+     * @return The record or `nullptr` if the ring is full or not allocated.
+     */
+    Record *claim(size_t &pos);
+
+    /**
+     * @brief Claim a free record for a message of `site`.
+     * @details
+     * In binary mode, the definition of `site` is stored first on its first use.
+     */
+    Record *claim(LogSite &site, size_t &pos);
+
+    /// Make the record at `pos` available to the writer thread.
+    void publish(Record *record, size_t pos, bool flush);
+
+    /**
+     * @brief Write all published records to `fout`.
+     * @note Must only be called by one thread at a time.
+     * @return `false` if writing failed.
+     */
+    bool drain();
+
+    /// Write and clear `batch`. Only called by the draining thread.
+    void write_batch();
+
+    /// Writer thread loop.
+    void run();
+
+    /// Stop and join the writer thread if it is running.
+    void stop();
+
     std::ofstream fout;
-    std::stringstream buffer;
-    int currLen;
+    std::unique_ptr<Record[]> records;
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos; // Only accessed by the draining thread.
+    /// Drained records, reserved to `LOG_BATCH_LEN` so that draining does not
+    /// allocate. Only accessed by the draining thread.
+    std::string batch;
+    std::atomic<int> dropped; // Messages dropped since the last drain.
+    std::atomic<bool> failed; // Writing to the output file failed.
+    std::atomic<int> nextSiteId; // Binary log id of the next used call site.
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake; // Wakes the writer thread.
+    std::condition_variable drained; // Signals written out records.
+    std::atomic<bool> running;
+    std::atomic<bool> wakeRequested;
+    std::atomic<size_t> drainedPos; // Ring position written out by the writer.
 };
 
 
-/**
- * @brief Make a message in logger format.
- * @note Should only be called by `log`.
- * @see log
- */
-const std::string make_log_msg(const char *file, int line, const std::string &msg);
+#define LOG_FIRST_IMPL(first, ...) first
+#define LOG_FIRST(...) LOG_FIRST_IMPL(__VA_ARGS__, 0)
 
 /**
- * @brief Write `msg` to `Logger` buffer.
- * @param msg Log message.
- * @param file `__FILE__` initialized at the calling line.
- * @param line `__LINE__` initialized at the calling line.
- * @param flush If true, flush after writing.
+ * @brief Log a message of `level` formatted from a string literal and arguments.
+ * @details
+ * Every `{}` in the format is replaced by the next argument: integers, floating
+ * point numbers and strings are supported. Nothing, not even the arguments, is
+ * evaluated when `level` is below `LOG_MIN_LEVEL`.
  */
-void log(const std::string &msg, const char *file, int line, bool flush=FLUSH_ALL);
+#define LOG_AT(level, ...) \
+    do \
+    { \
+        if constexpr ((level) >= LOG_MIN_LEVEL) \
+        { \
+            static LogSite logSite( \
+                level, "" LOG_FIRST(__VA_ARGS__), __FILE__, __LINE__ \
+            ); \
+            Logger::get()->write(logSite, __VA_ARGS__); \
+        } \
+    } \
+    while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
 
 
 #endif
@@ -4,12 +4,29 @@
  */
 
 #include "game.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "flight_recorder.hpp"
+#include "constants.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
 
 #include <cstdio>
 
 
+/// Dump the flight recorder after a crash, logging the outcome.
+static void dump_flight_recorder ()
+{
+    if (FlightRecorder::dump(FLIGHT_RECORDER_PATH))
+    {
+        LOG_INFO("Dumped the flight recorder to {}", FLIGHT_RECORDER_PATH);
+    }
+    else
+    {
+        LOG_ERROR("Could not dump the flight recorder to {}", FLIGHT_RECORDER_PATH);
+    }
+}
+
 int main (int argc, char *argv[])
 {
     Game game;
@@ -17,7 +34,9 @@ int main (int argc, char *argv[])
 
     try
     {
-        Logger::get()->init("log.txt");
+        Logger::get()->init(LOG_PATH);
+        Metrics::init();
+        FlightRecorder::init();
         game.init();
 
         // Game loop
@@ -27,20 +46,46 @@ int main (int argc, char *argv[])
             game.do_logic();
             game.change_state();
             game.render();
+            Metrics::dump_if_requested(METRICS_PATH);
         }
     }
     catch (const Exception &e)
     {
+        LOG_ERROR("{}", e.what());
+        dump_flight_recorder();
+        Logger::get()->crash_flush();
         printf("%s\n", e.what().c_str());
         exitCode = e.get_exit_code();
     }
     catch (std::exception &e)
     {
+        LOG_ERROR("Standard exception: {}", e.what());
+        dump_flight_recorder();
+        Logger::get()->crash_flush();
         printf("Standard exception: %s\n", e.what());
         exitCode = -1;
     }
 
     game.free();
+
+    try
+    {
+        Trace::dump(TRACE_PATH);
+    }
+    catch (const Exception &e)
+    {
+        printf("%s\n", e.what().c_str());
+    }
+
+    try
+    {
+        Metrics::dump(METRICS_PATH);
+    }
+    catch (const Exception &e)
+    {
+        printf("%s\n", e.what().c_str());
+    }
+
     Logger::get()->flush();
     Logger::get()->free();
     
@@ -0,0 +1,227 @@
+/**
+ * @file  metrics.cpp
+ * @brief Implementation of the Metrics registry and its metric classes.
+ */
+
+#include "metrics.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+
+/// Signal requesting a metrics dump: `kill -USR1` on POSIX, Ctrl+Break on Windows.
+#if defined(SIGUSR1)
+#define METRICS_SIGNAL SIGUSR1
+#elif defined(SIGBREAK)
+#define METRICS_SIGNAL SIGBREAK
+#endif
+
+
+/// Join `labels` and `extra` into a Prometheus label set, empty if both are.
+static std::string label_set (const std::string &labels, const std::string &extra="")
+{
+    if (labels.empty() && extra.empty())
+    {
+        return "";
+    }
+    return "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+}
+
+
+void Counter::write (
+    std::ostream &out, const std::string &name, const std::string &labels
+) const
+{
+    out << name << label_set(labels) << " " << get() << "\n";
+}
+
+void Gauge::write (
+    std::ostream &out, const std::string &name, const std::string &labels
+) const
+{
+    out << name << label_set(labels) << " " << get() << "\n";
+}
+
+Histogram::Histogram (const std::vector<double> &bounds)
+    : bounds(bounds)
+    , counts(new std::atomic<long long>[bounds.size() + 1])
+{
+    for (size_t i = 0; i <= bounds.size(); ++i)
+    {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe (double value)
+{
+    size_t bucket = 0;
+    while (bucket < bounds.size() && value > bounds[bucket])
+    {
+        ++bucket;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    double prevSum = sum.load(std::memory_order_relaxed);
+    while (
+        !sum.compare_exchange_weak(
+            prevSum, prevSum + value, std::memory_order_relaxed
+        )
+    );
+}
+
+void Histogram::write (
+    std::ostream &out, const std::string &name, const std::string &labels
+) const
+{
+    long long cumulative = 0;
+    char le[32];
+    for (size_t i = 0; i <= bounds.size(); ++i)
+    {
+        cumulative += counts[i].load(std::memory_order_relaxed);
+        if (i < bounds.size())
+        {
+            snprintf(le, sizeof(le), "%g", bounds[i]);
+        }
+        else
+        {
+            snprintf(le, sizeof(le), "+Inf");
+        }
+        out << name << "_bucket"
+            << label_set(labels, "le=\"" + std::string(le) + "\"") << " "
+            << cumulative << "\n";
+    }
+    out << name << "_sum" << label_set(labels) << " "
+        << sum.load(std::memory_order_relaxed) << "\n";
+    out << name << "_count" << label_set(labels) << " "
+        << count.load(std::memory_order_relaxed) << "\n";
+}
+
+
+volatile std::sig_atomic_t Metrics::dumpRequested = 0;
+
+
+Counter &Metrics::counter (
+    const std::string &name, const std::string &help, const std::string &labels
+)
+{
+    return get<Counter>("counter", name, help, labels);
+}
+
+Gauge &Metrics::gauge (
+    const std::string &name, const std::string &help, const std::string &labels
+)
+{
+    return get<Gauge>("gauge", name, help, labels);
+}
+
+Histogram &Metrics::histogram (
+    const std::string &name, const std::string &help,
+    const std::vector<double> &bounds, const std::string &labels
+)
+{
+    return get<Histogram>("histogram", name, help, labels, bounds);
+}
+
+void Metrics::init ()
+{
+#ifdef METRICS_SIGNAL
+    std::signal(METRICS_SIGNAL, request_dump);
+#endif
+}
+
+void Metrics::dump (const std::string &path)
+{
+    std::ofstream fout(path);
+    if (fout.fail())
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    {
+        Registry &registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto &family : registry.families)
+        {
+            fout << "# HELP " << family.first << " " << family.second.help << "\n";
+            fout << "# TYPE " << family.first << " " << family.second.type << "\n";
+            for (const auto &metric : family.second.metrics)
+            {
+                metric.second->write(fout, family.first, metric.first);
+            }
+        }
+    }
+
+    if (fout.fail())
+    {
+        std::string msg = "Could not write to \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+}
+
+void Metrics::dump_if_requested (const std::string &path)
+{
+    if (!dumpRequested)
+    {
+        return;
+    }
+    dumpRequested = 0;
+
+    try
+    {
+        dump(path);
+        LOG_INFO("Dumped metrics to {}", path);
+    }
+    catch (const Exception &e)
+    {
+        LOG_WARNING("{}", e.what());
+    }
+}
+
+template <typename T, typename... Args>
+T &Metrics::get (
+    const char *type, const std::string &name, const std::string &help,
+    const std::string &labels, const Args &...args
+)
+{
+    Registry &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    Family &family = registry.families[name];
+    if (family.type == nullptr)
+    {
+        family.type = type;
+        family.help = help;
+    }
+    else if (family.type != type)
+    {
+        throw std::logic_error(
+            "Metric \"" + name + "\" is already registered as a " + family.type
+        );
+    }
+
+    std::unique_ptr<Metric> &metric = family.metrics[labels];
+    if (!metric)
+    {
+        metric.reset(new T(args...));
+    }
+    return static_cast<T &>(*metric);
+}
+
+Metrics::Registry &Metrics::get_registry ()
+{
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+void Metrics::request_dump (int signal)
+{
+    dumpRequested = 1;
+#ifdef METRICS_SIGNAL
+    // Some platforms reset the handler after delivery
+    std::signal(signal, request_dump);
+#endif
+}
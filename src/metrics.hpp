@@ -0,0 +1,205 @@
+/**
+ * @file  metrics.hpp
+ * @brief Include file for the Metrics registry and its metric classes.
+ */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+
+#include <atomic>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+/// Base class of metrics stored in `Metrics`.
+class Metric
+{
+public:
+    /// Write the samples of the metric in Prometheus text format.
+    virtual void write(
+        std::ostream &out, const std::string &name, const std::string &labels
+    ) const = 0;
+
+    virtual ~Metric(){};
+};
+
+/// A monotonically increasing count.
+class Counter : public Metric
+{
+public:
+    /// Increase the count by `amount`.
+    void inc (long long amount=1)
+    {
+        value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    long long get () const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void write(
+        std::ostream &out, const std::string &name, const std::string &labels
+    ) const override;
+
+private:
+    std::atomic<long long> value{0};
+};
+
+/// A value that can go up and down.
+class Gauge : public Metric
+{
+public:
+    void set (long long value)
+    {
+        this->value.store(value, std::memory_order_relaxed);
+    }
+
+    /// Add `amount`, which may be negative, to the value.
+    void add (long long amount)
+    {
+        value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    long long get () const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void write(
+        std::ostream &out, const std::string &name, const std::string &labels
+    ) const override;
+
+private:
+    std::atomic<long long> value{0};
+};
+
+/// Counts of observed values in fixed buckets.
+class Histogram : public Metric
+{
+public:
+    /// @param bounds Ascending bucket upper bounds. A `+Inf` bucket is added.
+    explicit Histogram(const std::vector<double> &bounds);
+
+    /// Count `value` in its bucket.
+    void observe(double value);
+
+    void write(
+        std::ostream &out, const std::string &name, const std::string &labels
+    ) const override;
+
+private:
+    std::vector<double> bounds;
+    std::unique_ptr<std::atomic<long long>[]> counts; // Not cumulative.
+    std::atomic<long long> count{0};
+    std::atomic<double> sum{0};
+};
+
+
+/**
+ * @brief A purely static process-wide registry of named metrics.
+ * @details
+ * Metrics are registered on first lookup and are never destroyed, so call sites
+ * can keep references to them, e.g. in function-local statics:
+ *
+ *     static Counter &spawned = Metrics::counter(
+ *         "tetris_pieces_spawned_total", "Spawned tetriminos."
+ *     );
+ *     spawned.inc();
+ *
+ * Updating a metric is a single relaxed atomic operation. The registry is
+ * written in Prometheus text format by `dump()`.
+ */
+class Metrics
+{
+public:
+    /**
+     * @brief Get the counter `name` with `labels`, registering it if needed.
+     * @param name Metric name.
+     * @param help Metric description. Only the first registration's is kept.
+     * @param labels Labels in Prometheus syntax without braces, e.g.
+     *     `sound="menu_scroll"`.
+     * @throws `std::logic_error` thrown if `name` is registered as another type.
+     */
+    static Counter &counter(
+        const std::string &name, const std::string &help,
+        const std::string &labels=""
+    );
+
+    /// Get the gauge `name` with `labels`, registering it if needed. @see counter
+    static Gauge &gauge(
+        const std::string &name, const std::string &help,
+        const std::string &labels=""
+    );
+
+    /**
+     * @brief Get the histogram `name` with `labels`, registering it if needed.
+     * @param bounds Bucket upper bounds, only used on registration.
+     * @see counter
+     */
+    static Histogram &histogram(
+        const std::string &name, const std::string &help,
+        const std::vector<double> &bounds, const std::string &labels=""
+    );
+
+    /**
+     * @brief Request dumps on `METRICS_SIGNAL`, if the platform has it.
+     * @details
+     * The signal handler only sets a flag; the dump is written by the next
+     * `dump_if_requested()` call.
+     */
+    static void init();
+
+    /**
+     * @brief Write all metrics to `path` in Prometheus text format.
+     * @throws `ExceptionFile` thrown if `path` could not be written.
+     */
+    static void dump(const std::string &path);
+
+    /// Dump to `path` if a signal requested it, logging failures as warnings.
+    static void dump_if_requested(const std::string &path);
+
+private:
+    /// Metrics sharing a name and type.
+    struct Family
+    {
+        const char *type = nullptr;
+        std::string help;
+        std::map<std::string, std::unique_ptr<Metric>> metrics; // By labels.
+    };
+
+    /// Find or register the metric, constructing it from `args`.
+    template <typename T, typename... Args>
+    static T &get(
+        const char *type, const std::string &name, const std::string &help,
+        const std::string &labels, const Args &...args
+    );
+
+    /// All registered metrics.
+    struct Registry
+    {
+        std::mutex mutex; // Guards `families`.
+        std::map<std::string, Family> families; // By name.
+    };
+
+    /**
+     * @brief Get the registry, creating it on the first call.
+     * @note It is never freed, so metrics can be used from static initializers
+     *     and destructors.
+     */
+    static Registry &get_registry();
+
+    /// Signal handler requesting a dump.
+    static void request_dump(int signal);
+
+    static volatile std::sig_atomic_t dumpRequested;
+};
+
+
+#endif
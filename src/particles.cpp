@@ -1,6 +1,6 @@
 /**
  * @file  particles.cpp
- * @brief Implementation of particle classes.
+ * @brief Implementation of the class ParticlePool.
  */
 
 #include "particles.hpp"
@@ -8,86 +8,176 @@
 #include "constants.hpp"
 #include "logger.hpp"
 
+#include <atomic>
 #include <cmath>
 
 
-std::vector<SDL_Rect> Particle::clips;
+void ParticlePool::init (
+    int linesMax, int particlesMax, int lifespan, int maxShift,
+    Texture *particleTextureSheet
+)
+{
+    this->linesMax = linesMax;
+    this->particlesMax = particlesMax;
+    this->lifespan = lifespan;
+    this->maxShift = maxShift;
+    this->particleTextureSheet = particleTextureSheet;
 
+    int total = linesMax * particlesMax;
+    xShift.assign(total, 0);
+    yShift.assign(total, 0);
+    frame.assign(total, 0);
+    type.assign(total, PARTICLE_RED);
+    baseX.assign(particlesMax, 0);
+    baseY.assign(particlesMax, 0);
+    lines = 0;
 
-void Particle::init_clips ()
-{
-    for (int type = 0; type < PARTICLE_TOTAL; ++type)
+    animationFrame = -1;
+
+    // Every pool gets its own sequence, so that boards do not emit the same
+    // particles. The golden ratio multiple spreads consecutive pools apart
+    static std::atomic<Uint32> poolsInitialized{0};
+    rngState = (poolsInitialized.fetch_add(1) + 1) * 0x9E3779B9;
+    if (rngState == 0)
     {
-        clips.push_back(
-            {type * MAX_PARTICLE_SIZE, 0, MAX_PARTICLE_SIZE, MAX_PARTICLE_SIZE}
-        );
+        rngState = 0x9E3779B9;
     }
+    layoutW = layoutH = -1;
+    particlesUsed = 0;
 }
 
-Particle::Particle (int maxShift, int lifespan, Texture *particleTextureSheet)
-    : xShift(rand() % (2 * maxShift) - maxShift)
-    , yShift(rand() % (2 * maxShift) - maxShift)
-    , frame(rand() % lifespan)
-    , lifespan(lifespan)
-    , particleTextureSheet(particleTextureSheet)
-    , clip(&clips[1 + rand() % (PARTICLE_TOTAL - 1)])
-{}
+void ParticlePool::free ()
+{
+    xShift.clear();
+    yShift.clear();
+    frame.clear();
+    type.clear();
+    baseX.clear();
+    baseY.clear();
+    lines = 0;
+}
 
-void Particle::render (int x, int y, int size)
+void ParticlePool::emit ()
 {
-    particleTextureSheet->render({x + xShift, y + yShift, size, size}, clip);
-    if (frame % 2)
+    if (lines == linesMax)
+    {
+        return;
+    }
+    int begin = lines * particlesMax;
+    for (int i = begin; i < begin + particlesMax; ++i)
     {
-        particleTextureSheet->render(
-            {x + xShift, y + yShift, size, size}, &clips[PARTICLE_SHIMMER]
-        );
+        spawn(i);
     }
-    ++frame;
+    ++lines;
 }
 
-bool Particle::is_dead () const
+void ParticlePool::clear ()
 {
-    return frame >= lifespan;
+    lines = 0;
+    animationFrame = -1;
 }
 
+int ParticlePool::get_lines () const
+{
+    return lines;
+}
 
-ParticleEmmiter::ParticleEmmiter (
-    int particlesMax, int lifespan, int maxShift, Texture *particleTextureSheet
-)
-    : particlesTotal(particlesMax)
-    , particles(std::vector<Particle *>(particlesTotal))
-    , lifespan(lifespan)
-    , maxShift(maxShift)
-    , particleTextureSheet(particleTextureSheet)
+void ParticlePool::update (Uint32 time)
 {
-    for (Particle *&particle : particles)
+    int currFrame = time / PARTICLE_FRAME_TIME;
+    int frames = animationFrame == -1 ? 0 : max(0, currFrame - animationFrame);
+    animationFrame = currFrame;
+    if (frames == 0)
+    {
+        return;
+    }
+
+    int total = lines * particlesMax;
+    int *frame = this->frame.data();
+    for (int i = 0; i < total; ++i)
+    {
+        frame[i] += frames;
+    }
+    // Create new particles in place of the dead ones
+    for (int i = 0; i < total; ++i)
     {
-        particle = new Particle(maxShift, lifespan, particleTextureSheet);
+        if (frame[i] >= lifespan)
+        {
+            spawn(i);
+        }
     }
 }
 
-ParticleEmmiter::~ParticleEmmiter ()
+void ParticlePool::render (
+    int x, int y, int w, int h, const std::vector<int> &rows, int size
+)
 {
-    for (Particle *&particle : particles)
+    if (lines == 0)
     {
-        delete particle;
+        return;
+    }
+    if (w != layoutW || h != layoutH)
+    {
+        layout(w, h);
+    }
+
+    for (int line = 0; line < lines; ++line)
+    {
+        int lineY = y + rows[line] * h;
+        for (int i = 0; i < particlesUsed; ++i)
+        {
+            int j = line * particlesMax + i;
+            SDL_Rect quad = {
+                x + baseX[i] + xShift[j], lineY + baseY[i] + yShift[j], size, size
+            };
+            SDL_Rect clip = {
+                type[j] * MAX_PARTICLE_SIZE, 0, MAX_PARTICLE_SIZE, MAX_PARTICLE_SIZE
+            };
+            particleTextureSheet->render(quad, &clip);
+            if (frame[j] % 2)
+            {
+                clip.x = PARTICLE_SHIMMER * MAX_PARTICLE_SIZE;
+                particleTextureSheet->render(quad, &clip);
+            }
+        }
     }
 }
 
-void ParticleEmmiter::render (int x, int y, int w, int h, int size)
+void ParticlePool::spawn (int i)
 {
+    xShift[i] = int(random() % (2 * maxShift)) - maxShift;
+    yShift[i] = int(random() % (2 * maxShift)) - maxShift;
+    frame[i] = random() % lifespan;
+    type[i] = 1 + random() % (PARTICLE_TOTAL - 1);
+}
+
+Uint32 ParticlePool::random ()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+void ParticlePool::layout (int w, int h)
+{
+    layoutW = w;
+    layoutH = h;
+
     // Determine the amount of particle per row/col proportionally to w/h
     double numenator = (
-        std::sqrt(w * w + h * h + w * h * (4 * particlesTotal - 2)) - w - h
+        std::sqrt(w * w + h * h + w * h * (4 * particlesMax - 2)) - w - h
     ) / 2;
     int particlesHor = max(1, 1 + numenator / h);
     int particlesVer = max(1, 1 + numenator / w);
+    particlesUsed = min(particlesHor * particlesVer, particlesMax);
 
+    int x = 0, y = 0;
     int spaceHor, spaceVer;
     if (particlesHor == 1)
     {
         // If there is only one column, center it horisontally
-        x += w / 2;
+        x = w / 2;
         spaceHor = 0;
     }
     else
@@ -97,7 +187,7 @@ void ParticleEmmiter::render (int x, int y, int w, int h, int size)
     if (particlesVer == 1)
     {
         // If there is only one row, center it vertically
-        y += h / 2;
+        y = h / 2;
         spaceVer = 0;
     }
     else
@@ -105,22 +195,9 @@ void ParticleEmmiter::render (int x, int y, int w, int h, int size)
         spaceVer = h / (particlesVer - 1);
     }
 
-    for (int row = 0; row < particlesVer; ++row)
+    for (int i = 0; i < particlesUsed; ++i)
     {
-        for (int col = 0; col < particlesHor; ++col)
-        {
-            // Create new particles in place of the dead ones
-            if (particles[row * particlesHor + col]->is_dead())
-            {
-                delete particles[row * particlesHor + col];
-                particles[row * particlesHor + col] = new Particle(
-                    maxShift, lifespan, particleTextureSheet
-                );
-            }
-            
-            particles[row * particlesHor + col]->render(
-                x + col * spaceHor, y + row * spaceVer, size
-            );
-        }
+        baseX[i] = x + i % particlesHor * spaceHor;
+        baseY[i] = y + i / particlesHor * spaceVer;
     }
 }
@@ -1,6 +1,6 @@
 /**
  * @file  particles.hpp
- * @brief Include file for particle classes.
+ * @brief Include file for ParticlePool class.
  */
 
 #ifndef PARTICLES_HPP
@@ -9,51 +9,94 @@
 
 #include "texture.hpp"
 
+#include <vector>
+
 
 /**
- * @brief A particle class.
- * @example
- * 
- *     Particle *particle = new Particle(60, 5, &particleTextureSheet);
- *     while (!particle.is_dead())
- *     {
- *         particle->render(10, 10, 5);
- *     }
- *     delete particle;
+ * @brief Particles spread along lines of equal size, e.g. the cleared rows of a
+ *     board.
+ * @details
+ * Particles of all lines are preallocated at `init()` and kept as arrays of their
+ * properties, so that advancing them is a few loops over contiguous memory. Dead
+ * particles are respawned in place with a generator of the pool, which does not
+ * touch the global `rand()` state games are replayed with.
+ *
+ * Usage:
+ * @code
+ * pool.init(4, 30, 15, 10, &particleTextureSheet);
+ * pool.emit();
+ * while (animating)
+ * {
+ *     pool.update(elapsed);
+ *     pool.render(x, y, w, h, rows, size);
+ * }
+ * pool.clear();
+ * @endcode
  */
-class Particle
+class ParticlePool
 {
 public:
-    /// Create clips to use for selecting a particle texture from the sheet.
-    static void init_clips();
-
     /**
-     * @brief Create the particle.
-     * @note
-     * The particle will continue to render after its lifesycle elapses. The
-     * livelihood should be checked manually via `is_dead()` call.
-     * @param lifespan Maximum amount of frames to render the particle for. Actual
-     *     lifespan can be lower, down to 0.
-     * @param maxShift Maximum amount of pixels to shift the particle by in each
-     *     direction from the rendering coordinate.
+     * @brief Preallocate the particles.
+     * @param linesMax Maximum amount of lines emitted at once.
+     * @param particlesMax Maximum amount of particles to render along each line.
+     * @param lifespan Maximum amount of animation frames each particle lives for.
+     *     Actual lifespan is set randomly for each particle and can be 0.
+     * @param maxShift Maximum amount of pixels to shift each particle by in each
+     *     direction from its rendering coordinate.
      * @param particleTextureSheet The texture sheet: first entry is the shimmer
      *     texture and all other are for different base textures.
      */
-    Particle(int lifespan, int maxShift, Texture *particleTextureSheet);
+    void init(
+        int linesMax, int particlesMax, int lifespan, int maxShift,
+        Texture *particleTextureSheet
+    );
+
+    /// Free the particles.
+    void free();
+
+    /**
+     * @brief Spawn the particles of a new line.
+     * @note Does nothing once `linesMax` lines are emitted.
+     */
+    void emit();
+
+    /// Remove all lines.
+    void clear();
+
+    /// Get the amount of emitted lines.
+    int get_lines() const;
+
+    /**
+     * @brief Advance the particles an animation frame every `PARTICLE_FRAME_TIME`
+     *     ms of `time` and replace the dead ones with new ones.
+     * @param time Animation time in ms. Going back in time, e.g. after a restart of
+     *     the animation, does not advance the particles.
+     */
+    void update(Uint32 time);
 
     /**
-     * @brief Draw the particle near the given location with given `size`.
+     * @brief Uniformly render the particles with given `size` along each line.
      * @details
-     * Advances the lifecycle. Every other frame the shimmer texture is rendered above
-     * the base texture.
+     * Line `i` is the `w`x`h` rectangle at (`x`, `y` + `rows[i]` * `h`).
+     * Amount of particles per row and column is chosen proportionally to `w`/`h`.
+     * The particles are then rendered near uniformly distributed points starting from
+     * the upper left corner down to the bottom right corner. If there is only one
+     * particle in a row/column, the line of particles is centered along the
+     * corresponding dimension. Every other animation frame the shimmer texture is
+     * rendered above the base texture.
+     *
+     * The layout is only recomputed when `w` or `h` change, and all quads use the
+     * same texture, so they are drawn as a single batch.
      * @param x Upper left corner x coordinate.
-     * @param y Upper left corner y coordinate.
-     * @param size The size.
+     * @param y Upper left corner y coordinate of row 0.
+     * @param w Line width.
+     * @param h Line height.
+     * @param rows Row of each emitted line, which may change between renders, so at
+     *     least `get_lines()` rows.
+     * @param size Particle size.
      */
-    void render(int x, int y, int size);
-
-    /// `true` if the lifesycle is elapsed.
-    bool is_dead() const;
+    void render(int x, int y, int w, int h, const std::vector<int> &rows, int size);
 
 private:
     /// Particle type values used for clip indexing.
@@ -69,61 +112,33 @@ private:
         PARTICLE_TOTAL,
     };
 
-    static std::vector<SDL_Rect> clips; /// The texture sheet clips.
+    /// Give the particle at `i` a random shift, base texture and animation frame.
+    void spawn(int i);
 
-    int xShift, yShift;
-    int frame; /// Current animation frame.
+    /// Get the next random number.
+    Uint32 random();
 
-    /// Amount of times the particle is rendered before being considered dead.
+    /// Place the particles of a line with given width and height.
+    void layout(int w, int h);
+
+    int linesMax, particlesMax;
     int lifespan;
-    
+    int maxShift;
     Texture *particleTextureSheet;
-    SDL_Rect *clip; /// This particle's texture sheet clip.
-};
 
-/// A particle emmiter class.
-class ParticleEmmiter
-{
-public:
-    /**
-     * @brief Create the particles and initialize class members.
-     * @param particlesMax Maximum amount of particles to render each time.
-     * @param lifespan Maximum amount of frames to render each particle for. Actual
-     *     lifespan is set randomly for each particle and can be 0.
-     * @param maxShift Maximum amount of pixels to shift each particle by in each
-     *     direction from its rendering coordinate.
-     * @param particleTextureSheet The texture sheet.
-     */
-    ParticleEmmiter(
-        int particlesMax, int lifespan, int maxShift, Texture *particleTextureSheet
-    );
+    // Particle `i` of line `l` is at `l * particlesMax + i`
+    std::vector<int> xShift, yShift;
+    std::vector<int> frame; // Current animation frame.
+    std::vector<Uint8> type; // Base texture.
 
-    /// Delete all particles.
-    ~ParticleEmmiter();
+    int lines; // Amount of emitted lines.
+    int animationFrame; // Animation frame of the last update, `-1` after a clear.
+    Uint32 rngState; // Xorshift generator state, never `0`.
 
-    /**
-     * @brief Uniformly render the particles with given `size` along a rectangle
-     *     with given parameters.
-     * @details
-     * Amount of particles per row and column is chosen proportionally to `w`/`h`.
-     * The particles are then rendered near uniformly distributed points starting from
-     * the upper left corner down to the bottom right corner. If there is only one
-     * particle in a row/column, the line of particles is centered along the
-     * corresponding dimension. Dead particles are replaced with new ones.
-     * @param x Rectangle upper left corner x coordinate.
-     * @param y Rectangle upper left corner y coordinate.
-     * @param w Rectangle width.
-     * @param h Rectangle height.
-     * @param size Particle size.
-     */
-    void render(int x, int y, int w, int h, int size);
-
-private:
-    int particlesTotal;
-    std::vector<Particle *> particles;
-    int lifespan;
-    int maxShift;
-    Texture *particleTextureSheet;
+    // Position of each particle within a line, for `layoutW`x`layoutH` lines
+    std::vector<int> baseX, baseY;
+    int layoutW, layoutH;
+    int particlesUsed; // Amount of particles rendered per line.
 };
 
 
@@ -0,0 +1,113 @@
+/**
+ * @file  render_cache.cpp
+ * @brief Implementation of the class RenderCache.
+ */
+
+#include "render_cache.hpp"
+#include "trace.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+
+
+RenderCache::~RenderCache ()
+{
+    free();
+}
+
+void RenderCache::free ()
+{
+    if (texture != NULL)
+    {
+        LOG_DEBUG("Freeing RenderCache");
+
+        renderer->destroy_texture(texture);
+        texture = NULL;
+    }
+    renderer = nullptr;
+    valid = false;
+    direct = false;
+}
+
+void RenderCache::invalidate ()
+{
+    valid = false;
+}
+
+bool RenderCache::begin (Renderer &renderer, const SDL_Rect &rect)
+{
+    bool resized = rect.w != this->rect.w || rect.h != this->rect.h;
+    this->rect = rect;
+    if (rect.w <= 0 || rect.h <= 0)
+    {
+        return false;
+    }
+    if (
+        valid && !resized && this->renderer == &renderer
+        && targetResets == renderer.get_target_resets()
+    )
+    {
+        return false;
+    }
+    TRACE_ZONE("RenderCache::begin");
+
+    if (this->renderer != &renderer)
+    {
+        free();
+    }
+    if (!direct && (texture == NULL || rect.w > textureW || rect.h > textureH))
+    {
+        int w = texture != NULL ? std::max(rect.w, textureW) : rect.w;
+        int h = texture != NULL ? std::max(rect.h, textureH) : rect.h;
+        if (texture != NULL)
+        {
+            renderer.destroy_texture(texture);
+        }
+        texture = renderer.create_target_texture(w, h);
+        textureW = w;
+        textureH = h;
+        direct = texture == NULL;
+        if (!direct)
+        {
+            SDL_GetTextureBlendMode(texture, &blendMode);
+        }
+    }
+    this->renderer = &renderer;
+
+    if (direct)
+    {
+        renderer.set_view_port(rect.x, rect.y, rect.w, rect.h);
+    }
+    else
+    {
+        renderer.set_target(texture);
+        targetResets = renderer.get_target_resets();
+        valid = true;
+    }
+    return true;
+}
+
+void RenderCache::end ()
+{
+    if (direct)
+    {
+        renderer->reset_view_port();
+    }
+    else
+    {
+        renderer->set_target(NULL);
+    }
+}
+
+void RenderCache::render ()
+{
+    if (texture == NULL || rect.w <= 0 || rect.h <= 0)
+    {
+        return;
+    }
+
+    SDL_Rect clip = {0, 0, rect.w, rect.h};
+    renderer->render_texture(
+        texture, textureW, textureH, &clip, &rect, {255, 255, 255, 255}, blendMode
+    );
+}
@@ -0,0 +1,75 @@
+/**
+ * @file  render_cache.hpp
+ * @brief Include file for RenderCache class.
+ */
+
+#ifndef RENDER_CACHE_HPP
+#define RENDER_CACHE_HPP
+
+
+#include "renderer.hpp"
+
+#include <SDL2/SDL.h>
+
+
+/**
+ * @brief A render target keeping content which rarely changes between frames.
+ * @details
+ * The content is only drawn, between `begin()` and `end()`, when it is outdated;
+ * every frame `render()` composites it in a single quad. If the renderer does not
+ * support render targets, the content is drawn straight to the scene every frame.
+ *
+ * Usage:
+ * @code
+ * if (cache.begin(renderer, rect))
+ * {
+ *     // Draw the content with (0, 0) at the upper left corner of rect
+ *     cache.end();
+ * }
+ * cache.render();
+ * @endcode
+ */
+class RenderCache
+{
+public:
+    ~RenderCache();
+
+    /// Destroy the render target if it was not destroyed.
+    void free();
+
+    /// Mark the content outdated, so that the next `begin()` redraws it.
+    void invalidate();
+
+    /**
+     * @brief Start drawing the content at `rect` if it is outdated.
+     * @details
+     * The content is outdated if it was invalidated, `rect` changed size or the
+     * contents of render targets were lost. While drawing, the upper left corner of
+     * `rect` is at (0, 0) and drawing outside `rect` is clipped.
+     * @note Stores a pointer to `renderer`.
+     * @param renderer Renderer to draw with.
+     * @param rect Portion of the scene the content is rendered to.
+     * @return `true` if the content has to be drawn and `end()` called.
+     * @throws `ExceptionSDL` thrown if the render target could not be created.
+     */
+    bool begin(Renderer &renderer, const SDL_Rect &rect);
+
+    /// Finish drawing the content and draw to the scene again.
+    void end();
+
+    /// Render the content to the `rect` of the last `begin()`.
+    void render();
+
+private:
+    Renderer *renderer = nullptr;
+    SDL_Texture *texture = NULL;
+    int textureW, textureH; // Only grows, so resizing back and forth reuses it.
+    SDL_BlendMode blendMode;
+    SDL_Rect rect = {0, 0, 0, 0}; // Portion of the scene of the last `begin()`.
+    int targetResets; // `Renderer::get_target_resets()` when drawn.
+    bool valid = false; // `true` if the content drawn to `texture` is up to date.
+    bool direct = false; // `true` if drawn to the scene as targets are unsupported.
+};
+
+
+#endif
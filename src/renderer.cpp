@@ -4,25 +4,51 @@
  */
 
 #include "renderer.hpp"
+#include "frame_stats.hpp"
+#include "trace.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
 
 #include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cmath>
 
 
-void Renderer::init (Window &window)
+void Renderer::init (Window &window, bool vsync)
 {
-    log("Initializing Renderer", __FILE__, __LINE__);
+    LOG_INFO("Initializing Renderer");
 
-    renderer = window.create_renderer();
+    renderer = window.create_renderer(vsync);
+    targetsSupported = SDL_RenderTargetSupported(renderer);
+
+    // The renderer may be created without the requested vsync
+    SDL_RendererInfo info;
+    this->vsync = SDL_GetRendererInfo(renderer, &info) == 0
+        && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+    if (vsync && !this->vsync)
+    {
+        LOG_WARNING("Vsync not enabled!");
+    }
+
+    // Every batch starts at the first vertex, so the same indices fit all
+    indices.resize(QUEUE_QUADS_MAX * 6);
+    for (int quad = 0; quad < QUEUE_QUADS_MAX; ++quad)
+    {
+        const int corners[6] = {0, 1, 2, 2, 1, 3};
+        for (int i = 0; i < 6; ++i)
+        {
+            indices[quad * 6 + i] = quad * 4 + corners[i];
+        }
+    }
 }
 
 void Renderer::free ()
 {
-    log("Freeing renderer", __FILE__, __LINE__);
+    LOG_INFO("Freeing renderer");
 
     if (renderer != NULL)
     {
+        flush();
         SDL_DestroyRenderer(renderer);
         renderer = NULL;
     }
@@ -30,13 +56,81 @@ void Renderer::free ()
 
 void Renderer::show ()
 {
+    flush();
     SDL_RenderPresent(renderer);
 }
 
 void Renderer::clear ()
 {
+    flush();
     SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
     SDL_RenderClear(renderer);
+    lastTexture = NULL;
+}
+
+void Renderer::flush ()
+{
+    if (quadBatches.empty())
+    {
+        for (SDL_Texture *texture : releasedTextures)
+        {
+            SDL_DestroyTexture(texture);
+        }
+        releasedTextures.clear();
+        return;
+    }
+    TRACE_ZONE("Renderer::flush");
+
+    // Lay the quads of each batch out contiguously, keeping their order
+    int first = 0;
+    for (Batch &batch : batches)
+    {
+        batch.first = first;
+        first += batch.quads;
+        batch.quads = 0;
+    }
+    sortedVertices.resize(vertices.size());
+    for (size_t quad = 0; quad < quadBatches.size(); ++quad)
+    {
+        Batch &batch = batches[quadBatches[quad]];
+        std::copy_n(
+            &vertices[quad * 4], 4, &sortedVertices[(batch.first + batch.quads) * 4]
+        );
+        ++batch.quads;
+    }
+
+    for (const Batch &batch : batches)
+    {
+        if (batch.texture != NULL)
+        {
+            SDL_SetTextureBlendMode(batch.texture, batch.blendMode);
+        }
+        else
+        {
+            SDL_SetRenderDrawBlendMode(renderer, batch.blendMode);
+        }
+        SDL_RenderGeometry(
+            renderer, batch.texture, &sortedVertices[batch.first * 4],
+            batch.quads * 4, indices.data(), batch.quads * 6
+        );
+
+        FrameStats::count(FrameStats::DRAW_CALLS);
+        if (batch.texture != lastTexture)
+        {
+            FrameStats::count(FrameStats::TEXTURE_SWITCHES);
+            lastTexture = batch.texture;
+        }
+    }
+    FrameStats::count(FrameStats::QUADS, quadBatches.size());
+
+    vertices.clear();
+    quadBatches.clear();
+    batches.clear();
+    for (SDL_Texture *texture : releasedTextures)
+    {
+        SDL_DestroyTexture(texture);
+    }
+    releasedTextures.clear();
 }
 
 SDL_Texture *Renderer::create_texture_from_file (const std::string &path)
@@ -61,28 +155,177 @@ SDL_Texture *Renderer::create_texture_from_surface (SDL_Surface *surface)
     return texture;
 }
 
+SDL_Texture *Renderer::create_target_texture (int w, int h)
+{
+    if (!targetsSupported)
+    {
+        return NULL;
+    }
+
+    SDL_Texture *texture = SDL_CreateTexture(
+        renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h
+    );
+    if (texture == NULL)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
+    }
+
+    // Blending into a transparent target premultiplies the colors by alpha
+    SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        SDL_BLENDOPERATION_ADD
+    );
+    if (SDL_SetTextureBlendMode(texture, premultiplied) < 0)
+    {
+        LOG_INFO("Premultiplied alpha not supported, not using render targets");
+
+        SDL_DestroyTexture(texture);
+        targetsSupported = false;
+        return NULL;
+    }
+
+    return texture;
+}
+
+void Renderer::destroy_texture (SDL_Texture *texture)
+{
+    if (quadBatches.empty())
+    {
+        SDL_DestroyTexture(texture);
+    }
+    else
+    {
+        releasedTextures.push_back(texture);
+    }
+}
+
+void Renderer::set_target (SDL_Texture *target)
+{
+    flush();
+    SDL_SetRenderTarget(renderer, target);
+    if (target != NULL)
+    {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+    }
+}
+
+void Renderer::handle_event (const SDL_Event &e)
+{
+    if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+    {
+        LOG_INFO("Render target contents lost");
+
+        ++targetResets;
+    }
+}
+
+int Renderer::get_target_resets () const
+{
+    return targetResets;
+}
+
+void Renderer::set_atlas (const TextureAtlas *atlas)
+{
+    this->atlas = atlas;
+}
+
+const TextureAtlas *Renderer::get_atlas () const
+{
+    return atlas;
+}
+
 void Renderer::render_texture (
-    SDL_Texture *texture, const SDL_Rect *clip, const SDL_Rect *renderQuad,
+    SDL_Texture *texture, int w, int h, const SDL_Rect *clip,
+    const SDL_Rect *renderQuad, const SDL_Color &colorMod, SDL_BlendMode blendMode,
     double angle, const SDL_Point *center, SDL_RendererFlip flip
 )
 {
-    SDL_RenderCopyEx(renderer, texture, clip, renderQuad, angle, center, flip);
+    SDL_Rect dst;
+    if (renderQuad != NULL)
+    {
+        dst = *renderQuad;
+    }
+    else
+    {
+        SDL_RenderGetViewport(renderer, &dst);
+        dst.x = dst.y = 0;
+    }
+    SDL_Rect src = clip != NULL ? *clip : SDL_Rect{0, 0, w, h};
+
+    float u0 = float(src.x) / w, u1 = float(src.x + src.w) / w;
+    float v0 = float(src.y) / h, v1 = float(src.y + src.h) / h;
+    if (flip & SDL_FLIP_HORIZONTAL)
+    {
+        std::swap(u0, u1);
+    }
+    if (flip & SDL_FLIP_VERTICAL)
+    {
+        std::swap(v0, v1);
+    }
+    SDL_Vertex quad[4] = {
+        {{float(dst.x), float(dst.y)}, colorMod, {u0, v0}},
+        {{float(dst.x + dst.w), float(dst.y)}, colorMod, {u1, v0}},
+        {{float(dst.x), float(dst.y + dst.h)}, colorMod, {u0, v1}},
+        {{float(dst.x + dst.w), float(dst.y + dst.h)}, colorMod, {u1, v1}},
+    };
+
+    SDL_Rect bounds = dst;
+    if (angle != 0.0)
+    {
+        // Rotate clockwise around the center like SDL_RenderCopyEx
+        float cx = dst.x + (center != NULL ? center->x : dst.w / 2.0f);
+        float cy = dst.y + (center != NULL ? center->y : dst.h / 2.0f);
+        double radians = angle * 3.14159265358979323846 / 180;
+        float cosA = std::cos(radians), sinA = std::sin(radians);
+        float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+        for (SDL_Vertex &vertex : quad)
+        {
+            float dx = vertex.position.x - cx, dy = vertex.position.y - cy;
+            vertex.position.x = cx + dx * cosA - dy * sinA;
+            vertex.position.y = cy + dx * sinA + dy * cosA;
+            minX = std::min(minX, vertex.position.x);
+            minY = std::min(minY, vertex.position.y);
+            maxX = std::max(maxX, vertex.position.x);
+            maxY = std::max(maxY, vertex.position.y);
+        }
+        bounds = {
+            int(std::floor(minX)), int(std::floor(minY)),
+            int(std::ceil(maxX) - std::floor(minX)),
+            int(std::ceil(maxY) - std::floor(minY))
+        };
+    }
+
+    queue_quad(texture, blendMode, bounds, quad);
 }
 
 void Renderer::render_rectangle(const SDL_Rect *rectangle, const Color &color)
 {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-    SDL_RenderFillRect(renderer, rectangle);
+    const SDL_Rect &rect = *rectangle;
+    SDL_Color vertexColor = {color.r, color.g, color.b, 255};
+    SDL_Vertex quad[4] = {
+        {{float(rect.x), float(rect.y)}, vertexColor, {0, 0}},
+        {{float(rect.x + rect.w), float(rect.y)}, vertexColor, {0, 0}},
+        {{float(rect.x), float(rect.y + rect.h)}, vertexColor, {0, 0}},
+        {{float(rect.x + rect.w), float(rect.y + rect.h)}, vertexColor, {0, 0}},
+    };
+
+    // Like SDL_RenderFillRect with the default draw blend mode
+    queue_quad(NULL, SDL_BLENDMODE_NONE, rect, quad);
 }
 
 void Renderer::set_view_port (int x, int y, int w, int h)
 {
+    flush();
     SDL_Rect viewPort = {x, y, w, h};
     SDL_RenderSetViewport(renderer, &viewPort);
 }
 
 void Renderer::reset_view_port ()
 {
+    flush();
     SDL_RenderSetViewport(renderer, NULL);
 }
 
@@ -99,3 +342,75 @@ int Renderer::get_height () const
     SDL_GetRendererOutputSize(renderer, &w, &h);
     return h;
 }
+
+int Renderer::get_max_texture_size () const
+{
+    SDL_RendererInfo info;
+    if (
+        SDL_GetRendererInfo(renderer, &info) < 0
+        || info.max_texture_width == 0 || info.max_texture_height == 0
+    )
+    {
+        return 0;
+    }
+    return std::min(info.max_texture_width, info.max_texture_height);
+}
+
+bool Renderer::set_vsync (bool vsync)
+{
+    if (SDL_RenderSetVSync(renderer, vsync) < 0)
+    {
+        LOG_WARNING(
+            "Could not turn vsync {}: {}", vsync ? "on" : "off", SDL_GetError()
+        );
+        return false;
+    }
+    this->vsync = vsync;
+    return true;
+}
+
+bool Renderer::has_vsync () const
+{
+    return vsync;
+}
+
+void Renderer::queue_quad (
+    SDL_Texture *texture, SDL_BlendMode blendMode, const SDL_Rect &bounds,
+    const SDL_Vertex quad[4]
+)
+{
+    if (quadBatches.size() == QUEUE_QUADS_MAX)
+    {
+        flush();
+    }
+
+    // Join the latest batch of the texture unless a later batch is drawn below
+    int joined = -1;
+    int last = int(batches.size()) - 1;
+    for (int i = last; i >= 0 && i > last - BATCH_LOOKBACK; --i)
+    {
+        const Batch &batch = batches[i];
+        if (batch.texture == texture && batch.blendMode == blendMode)
+        {
+            joined = i;
+            break;
+        }
+        if (SDL_HasIntersection(&batch.bounds, &bounds))
+        {
+            break;
+        }
+    }
+    if (joined < 0)
+    {
+        batches.push_back({texture, blendMode, bounds, 0, 0});
+        joined = last + 1;
+    }
+    else
+    {
+        SDL_UnionRect(&batches[joined].bounds, &bounds, &batches[joined].bounds);
+    }
+
+    ++batches[joined].quads;
+    quadBatches.push_back(joined);
+    vertices.insert(vertices.end(), quad, quad + 4);
+}
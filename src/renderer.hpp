@@ -12,24 +12,44 @@
 
 #include <SDL2/SDL.h>
 #include <string>
+#include <vector>
 
 
-/// SDL_Renderer wrapper class.
+class TextureAtlas;
+
+/**
+ * @brief SDL_Renderer wrapper class.
+ * @details
+ * Textures and rectangles are not drawn right away but queued as quads and drawn by
+ * `flush()` with a `SDL_RenderGeometry` call per batch. A quad joins the latest
+ * batch of its texture and blend mode unless it overlaps a batch queued after
+ * that one, so the scene looks as if every quad was drawn in order.
+ */
 class Renderer
 {
 public:
-    /// Create a renderer attached to `window`.
-    void init(Window &window);
+    /**
+     * @brief Create a renderer attached to `window`.
+     * @param vsync `true` to synchronize presenting with the display refresh.
+     */
+    void init(Window &window, bool vsync=false);
 
     /// Destroy renderer if it was not destroyed.
     void free();
 
-    /// Display the current scene.
+    /// Draw the queued quads and display the current scene.
     void show();
 
     /// Clear the scene creating a white background.
     void clear();
 
+    /**
+     * @brief Draw the queued quads.
+     * @note Called by `show()`, before changing the view port and when the queue
+     *     is full.
+     */
+    void flush();
+
     /**
      * @brief Create an SDL texture from the image in `path`.
      * @param path Image path.
@@ -47,31 +67,70 @@ public:
     SDL_Texture *create_texture_from_surface(SDL_Surface *surface);
 
     /**
-     * @brief Render a `texture` `clip` at `renderQuad`.
+     * @brief Create an SDL texture to render to, which is drawn with premultiplied
+     *     alpha.
+     * @param w The texture width.
+     * @param h The texture height.
+     * @return A pointer to the created texture; `NULL` if the renderer does not
+     *     support render targets or premultiplied alpha.
+     * @throws `ExceptionSDL` thrown if the texture could not be created.
+     */
+    SDL_Texture *create_target_texture(int w, int h);
+
+    /// Destroy `texture` once the queued quads, which may use it, are drawn.
+    void destroy_texture(SDL_Texture *texture);
+
+    /**
+     * @brief Draw the queued quads and render to `target` from now on.
+     * @param target A texture created by `create_target_texture()`, which is
+     *     cleared to transparent; `NULL` to render to the window again.
+     */
+    void set_target(SDL_Texture *target);
+
+    /// Count lost render target contents on `SDL_RENDER_TARGETS_RESET` events.
+    void handle_event(const SDL_Event &e);
+
+    /// Get the amount of times the contents of render targets were lost.
+    int get_target_resets() const;
+
+    /// Set the atlas textures are looked up in; `nullptr` for none.
+    void set_atlas(const TextureAtlas *atlas);
+
+    /// Get the atlas textures are looked up in; `nullptr` if none.
+    const TextureAtlas *get_atlas() const;
+
+    /**
+     * @brief Queue a `texture` `clip` at `renderQuad`.
      * @param texture The texture.
+     * @param w The texture width.
+     * @param h The texture height.
      * @param clip Portion of the texture to render; `NULL` to render the entire
      *     texture.
      * @param renderQuad Portion of the current scene to render to;
      *     `NULL` to render to the entire scene.
+     * @param colorMod Color and alpha the texture colors are multiplied by.
+     * @param blendMode Blend mode to draw the texture with.
      * @param angle Angle in degrees to rotate the texture.
      * @param center Point to rotate around;
      *     `NULL` to rotate around the texture center.
      * @param flip SDL_RendererFlip value setting flipping actions.
      */
     void render_texture(
-        SDL_Texture *texture, const SDL_Rect *clip=NULL,
+        SDL_Texture *texture, int w, int h, const SDL_Rect *clip=NULL,
         const SDL_Rect *renderQuad=NULL,
+        const SDL_Color &colorMod={255, 255, 255, 255},
+        SDL_BlendMode blendMode=SDL_BLENDMODE_BLEND,
         double angle=0.0, const SDL_Point *center=NULL,
         SDL_RendererFlip flip=SDL_FLIP_NONE
     );
 
-    /// Render rectangle at `rectangle` filled with `color`.
+    /// Queue a rectangle at `rectangle` filled with `color`.
     void render_rectangle(const SDL_Rect *rectangle, const Color &color);
 
-    /// Set view port.
+    /// Draw the queued quads and set view port.
     void set_view_port(int x, int y, int w, int h);
 
-    /// Reset view port to the whole window.
+    /// Draw the queued quads and reset view port to the whole window.
     void reset_view_port();
 
     /// Get output width.
@@ -80,8 +139,57 @@ public:
     /// Get output height.
     int get_height() const;
 
+    /// Get the maximum texture width and height; `0` if unlimited.
+    int get_max_texture_size() const;
+
+    /**
+     * @brief Turn synchronizing presenting with the display refresh on or off.
+     * @return `true` if the renderer supports the change.
+     */
+    bool set_vsync(bool vsync);
+
+    /// `true` if presenting is synchronized with the display refresh.
+    bool has_vsync() const;
+
 private:
+    /// Maximum amount of queued quads; a full queue is flushed.
+    static constexpr int QUEUE_QUADS_MAX = 1 << 13;
+
+    /// Maximum amount of batches looked through for one to join.
+    static constexpr int BATCH_LOOKBACK = 32;
+
+    /// Quads drawn by a single `SDL_RenderGeometry` call.
+    struct Batch
+    {
+        SDL_Texture *texture; // `NULL` for filled rectangles.
+        SDL_BlendMode blendMode;
+        SDL_Rect bounds; // Bounding box of the quads.
+        int quads;
+        int first; // First quad in `sortedVertices`, set by `flush()`.
+    };
+
+    /**
+     * @brief Queue a `quad` bounded by `bounds`.
+     * @param quad Upper left, upper right, lower left and lower right corners.
+     */
+    void queue_quad(
+        SDL_Texture *texture, SDL_BlendMode blendMode, const SDL_Rect &bounds,
+        const SDL_Vertex quad[4]
+    );
+
     SDL_Renderer *renderer = NULL;
+    SDL_Texture *lastTexture = NULL; // Last rendered texture to count switches.
+    const TextureAtlas *atlas = nullptr;
+    bool targetsSupported; // `false` if `create_target_texture()` is unsupported.
+    bool vsync;
+    int targetResets = 0;
+
+    std::vector<SDL_Vertex> vertices; // Queued quads in order, 4 vertices each.
+    std::vector<int> quadBatches; // Batch of each queued quad.
+    std::vector<Batch> batches;
+    std::vector<SDL_Vertex> sortedVertices; // Queued quads ordered by batch.
+    std::vector<int> indices; // Triangles of `QUEUE_QUADS_MAX` quads.
+    std::vector<SDL_Texture *> releasedTextures; // Destroyed after the flush.
 };
 
 
@@ -0,0 +1,127 @@
+/**
+ * @file  replay.cpp
+ * @brief Implementation of the struct Replay.
+ */
+
+#include "replay.hpp"
+#include "exceptions.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+
+void Replay::load (const std::string &path)
+{
+    std::ifstream fin(path);
+    if (fin.fail())
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    seed = 0;
+    tickMs = REPLAY_TICK_MS;
+    ticks = 0;
+    events.clear();
+
+    std::string line;
+    int lineNum = 0, version = 0;
+    while (std::getline(fin, line))
+    {
+        ++lineNum;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream sin(line);
+        std::string word;
+        sin >> word;
+        bool valid = true;
+        if (word == "tetris_replay")
+        {
+            valid = bool(sin >> version) && version >= 1 && version <= VERSION;
+        }
+        else if (word == "seed")
+        {
+            valid = bool(sin >> seed);
+        }
+        else if (word == "tick_ms")
+        {
+            valid = bool(sin >> tickMs) && tickMs > 0;
+        }
+        else if (word == "ticks")
+        {
+            valid = bool(sin >> ticks) && ticks >= 0;
+        }
+        else
+        {
+            // An event: the key name is the rest of the line and may hold spaces
+            ReplayEvent event;
+            std::string type, name;
+            sin.clear();
+            sin.seekg(0);
+            valid = bool(sin >> event.tick >> type);
+            if (valid && type[0] == '-')
+            {
+                std::istringstream ageIn(type.substr(1));
+                valid = ageIn >> event.age && ageIn.eof() && event.age > 0
+                    && sin >> type;
+            }
+            valid = valid && (type == "down" || type == "up");
+            std::getline(sin >> std::ws, name);
+            event.down = type == "down";
+            event.key = SDL_GetKeyFromName(name.c_str());
+            valid = valid && event.tick >= 0 && event.key != SDLK_UNKNOWN;
+            events.push_back(event);
+        }
+
+        if (!valid || !version)
+        {
+            std::string msg = "Malformed replay \"" + path + "\" at line "
+                + std::to_string(lineNum);
+            throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+        }
+    }
+    if (fin.bad() || !version)
+    {
+        std::string msg = "Could not read from \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    std::stable_sort(
+        events.begin(), events.end(),
+        [](const ReplayEvent &a, const ReplayEvent &b){ return a.tick < b.tick; }
+    );
+}
+
+void Replay::save (const std::string &path) const
+{
+    std::ofstream fout(path);
+    if (fout.fail())
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    fout << "tetris_replay " << VERSION << "\n";
+    fout << "seed " << seed << "\n";
+    fout << "tick_ms " << tickMs << "\n";
+    fout << "ticks " << ticks << "\n";
+    for (const ReplayEvent &event : events)
+    {
+        fout << event.tick;
+        if (event.age)
+        {
+            fout << " -" << event.age;
+        }
+        fout << (event.down ? " down " : " up ") << SDL_GetKeyName(event.key) << "\n";
+    }
+
+    if (fout.fail())
+    {
+        std::string msg = "Could not write to \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file  replay.hpp
+ * @brief Include file for Replay and ReplayEvent structs.
+ */
+
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+
+#include "constants.hpp"
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+
+/// A key press or release of a replay.
+struct ReplayEvent
+{
+    int tick; // Tick the event is handled on.
+    bool down; // `true` for a press, `false` for a release.
+    SDL_Keycode key;
+    int age = 0; // Ms the event happened before `tick`; `0` if not timestamped.
+};
+
+/**
+ * @brief A single player game recorded as a random seed and timed key events.
+ * @details
+ * Replays are stored as text, so that they can be read, edited and diffed:
+ *
+ *     tetris_replay 2
+ *     seed 1234
+ *     tick_ms 16
+ *     ticks 300
+ *     12 down Left
+ *     20 up Left
+ *     31 -24 down Space
+ *
+ * Event lines hold the tick, optionally the negated age of the event in ms, `down`
+ * or `up` and the SDL key name. Events with an age are timestamped that long
+ * before their tick, like SDL timestamps events pumped after they happened. Lines
+ * starting with `#` are ignored. Version 1 replays, which have no ages, are read as
+ * well. Replays are run by `ReplayRunner`.
+ */
+struct Replay
+{
+    /// Replay format version written by `save()`.
+    static constexpr int VERSION = 2;
+
+    /**
+     * @brief Read the replay from `path`.
+     * @throws `ExceptionFile` thrown if `path` could not be read or is malformed.
+     */
+    void load(const std::string &path);
+
+    /**
+     * @brief Write the replay to `path`.
+     * @throws `ExceptionFile` thrown if `path` could not be written.
+     */
+    void save(const std::string &path) const;
+
+    Uint32 seed = 0; // Seed of `TetriminoConfig` and `rand()`.
+    int tickMs = REPLAY_TICK_MS; // Game time advanced by each tick.
+    int ticks = 0; // Amount of ticks to run.
+    std::vector<ReplayEvent> events; // Sorted by tick.
+};
+
+
+#endif
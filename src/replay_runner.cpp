@@ -0,0 +1,216 @@
+/**
+ * @file  replay_runner.cpp
+ * @brief Implementation of the class ReplayRunner.
+ */
+
+#include "replay_runner.hpp"
+#include "tetrimino.hpp"
+#include "util.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+
+
+Game ReplayRunner::game;
+Window ReplayRunner::window;
+Renderer ReplayRunner::renderer;
+TextureAtlas ReplayRunner::atlas;
+Font ReplayRunner::font;
+KeyLayout ReplayRunner::tetrisKeyLayout, ReplayRunner::tetriminoKeyLayout;
+Texture ReplayRunner::bgTexture, ReplayRunner::blockTextureSheet;
+Texture ReplayRunner::fieldBgTexture, ReplayRunner::fieldFrameTexture;
+Texture ReplayRunner::fieldClearTexture, ReplayRunner::fieldClearParticleTextureSheet;
+Text ReplayRunner::linesClearedText, ReplayRunner::linesClearedPromptText;
+Text ReplayRunner::scoreText, ReplayRunner::scorePromptText;
+Text ReplayRunner::highScoreText, ReplayRunner::highScorePromptText;
+Text ReplayRunner::msgText, ReplayRunner::comboText;
+Timer ReplayRunner::tetriminoTimer, ReplayRunner::clearLineTimer;
+Timer ReplayRunner::msgTextTimer, ReplayRunner::gameOverTimer;
+TetrisLayout ReplayRunner::layout;
+Uint8 ReplayRunner::keys[SDL_NUM_SCANCODES];
+
+
+void ReplayRunner::init ()
+{
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, IMG_GetError());
+    }
+    if (TTF_Init() == -1)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, TTF_GetError());
+    }
+
+    window.init(game);
+    renderer.init(window);
+    atlas.init(renderer, Game::atlasImages);
+    font.init("fonts/font.ttf", 30);
+
+    Tetrimino::load_schemes("schemes.txt");
+    Tetrimino::init_clips();
+
+    game.create_key_loadout(tetrisKeyLayout, TetrisState::tetrisKeyMap);
+    game.create_key_loadout(tetriminoKeyLayout, TetrisState::tetriminoKeyMap);
+
+    bgTexture.load_from_file(renderer, "textures/bg.png");
+    blockTextureSheet.load_from_file(renderer, "textures/blocks.png", &CYAN);
+    fieldBgTexture.load_from_file(renderer, "textures/field_bg.png");
+    fieldFrameTexture.load_from_file(renderer, "textures/field_frame.png");
+    fieldClearTexture.load_from_file(renderer, "textures/field_clear.png");
+    fieldClearParticleTextureSheet.load_from_file(
+        renderer, "textures/field_particles.png", &CYAN
+    );
+
+    linesClearedText.init(renderer, font, "0000", WHITE, "999999999");
+    linesClearedPromptText.init(renderer, font, "Lines cleared:", WHITE);
+    scoreText.init(renderer, font, "000000000", WHITE, "999999999");
+    scorePromptText.init(renderer, font, "Score:", WHITE, "High score:");
+    highScoreText.init(renderer, font, "000000000", WHITE, "999999999");
+    highScorePromptText.init(renderer, font, "High score:", WHITE);
+    msgText.init(renderer, font, "", WHITE, std::string(24, 'W'));
+    comboText.init(renderer, font, "Combo: 0", WHITE, "Combo: 99");
+}
+
+void ReplayRunner::free ()
+{
+    layout.free();
+    for (
+        Text *text :
+        {&linesClearedText, &linesClearedPromptText, &scoreText, &scorePromptText,
+            &highScoreText, &highScorePromptText, &msgText, &comboText}
+    )
+    {
+        text->free();
+    }
+    for (
+        Texture *texture :
+        {&bgTexture, &blockTextureSheet, &fieldBgTexture, &fieldFrameTexture,
+            &fieldClearTexture, &fieldClearParticleTextureSheet}
+    )
+    {
+        texture->free();
+    }
+    font.free();
+    atlas.free();
+    renderer.free();
+    window.free();
+
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+}
+
+void ReplayRunner::run (const Replay &replay, ReplayStats &stats, bool render)
+{
+    srand(replay.seed);
+    TetriminoConfig::seed(replay.seed);
+    Timer::use_manual_clock();
+    std::fill(std::begin(keys), std::end(keys), 0);
+    KeyLayout::set_keyboard_state(keys);
+
+    reset_layout();
+
+    stats.tickNs.clear();
+    stats.frameNs.clear();
+    stats.tickNs.reserve(replay.ticks);
+    stats.frameNs.reserve(replay.ticks);
+    double nsPerCount = 1e9 / SDL_GetPerformanceFrequency();
+
+    size_t next = 0;
+    int tick = 0;
+    while (tick < replay.ticks && !layout.game_over())
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        while (next < replay.events.size() && replay.events[next].tick <= tick)
+        {
+            handle_event(replay.events[next++]);
+        }
+        layout.do_logic();
+        Uint64 logicEnd = SDL_GetPerformanceCounter();
+
+        // Without rendering, nothing reads the snapshots
+        if (render)
+        {
+            layout.publish();
+            renderer.clear();
+            layout.render(0, 0, renderer.get_width(), renderer.get_height());
+            renderer.show();
+        }
+        Uint64 renderEnd = SDL_GetPerformanceCounter();
+
+        stats.tickNs.push_back((logicEnd - start) * nsPerCount);
+        stats.frameNs.push_back((renderEnd - start) * nsPerCount);
+        Timer::advance_manual_clock(replay.tickMs);
+        ++tick;
+    }
+
+    stats.checksum = layout.get_checksum();
+    stats.ticksRun = tick;
+    stats.gameOver = layout.game_over();
+
+    KeyLayout::set_keyboard_state(nullptr);
+    Timer::use_sdl_clock();
+}
+
+void ReplayRunner::reset_layout ()
+{
+    layout.free();
+    layout.init(
+        TETRIS_FIELD_WIDTH, TETRIS_FIELD_HEIGHT,
+        &tetrisKeyLayout, &tetriminoKeyLayout,
+        &tetriminoTimer, &clearLineTimer, &gameOverTimer,
+        &msgTextTimer,
+        &bgTexture, &blockTextureSheet,
+        &fieldBgTexture, &fieldFrameTexture, &fieldClearTexture,
+        &fieldClearParticleTextureSheet,
+        &linesClearedText, &linesClearedPromptText,
+        &scoreText, &scorePromptText,
+        &highScoreText, &highScorePromptText,
+        &msgText, &comboText
+    );
+    for (
+        Timer *timer :
+        {&tetriminoTimer, &clearLineTimer, &msgTextTimer, &gameOverTimer}
+    )
+    {
+        timer->start();
+    }
+
+    // The game renders a frame after entering before doing any logic
+    renderer.clear();
+    layout.render(0, 0, renderer.get_width(), renderer.get_height());
+    renderer.show();
+}
+
+void ReplayRunner::handle_event (const ReplayEvent &event)
+{
+    // Like SDL, only report changes; edited replays may press held keys again
+    SDL_Scancode scancode = SDL_GetScancodeFromKey(event.key);
+    if (keys[scancode] == event.down)
+    {
+        return;
+    }
+    keys[scancode] = event.down;
+
+    SDL_Event e{};
+    e.type = event.down ? SDL_KEYDOWN : SDL_KEYUP;
+    if (event.age)
+    {
+        // A timestamp of 0 means none, and the manual clock starts at 1
+        Uint32 now = Timer::get_ticks();
+        e.common.timestamp = now > Uint32(event.age) ? now - event.age : 1;
+    }
+    e.key.keysym.sym = event.key;
+    e.key.keysym.scancode = scancode;
+    layout.handle_event(game, e);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file  replay_runner.hpp
+ * @brief Include file for ReplayRunner class and ReplayStats struct.
+ */
+
+#ifndef REPLAY_RUNNER_HPP
+#define REPLAY_RUNNER_HPP
+
+
+#include "replay.hpp"
+#include "game.hpp"
+#include "window.hpp"
+#include "renderer.hpp"
+#include "font.hpp"
+#include "texture.hpp"
+#include "text.hpp"
+#include "timer.hpp"
+#include "key_layout.hpp"
+#include "tetris_layout.hpp"
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+
+/// Costs and outcome of a replay run.
+struct ReplayStats
+{
+    std::vector<double> tickNs; // Event handling and logic time of each tick.
+    std::vector<double> frameNs; // Tick and render time of each tick.
+    Uint32 checksum; // `TetrisLayout::get_checksum()` after the last tick.
+    int ticksRun; // Less than the replay ticks if the game ended early.
+    bool gameOver;
+};
+
+/**
+ * @brief A purely static class running replays on a full single player layout
+ *     without a player.
+ * @details
+ * Runs are deterministic: timers follow the manual clock, random generators are
+ * seeded from the replay and key states come from the replay instead of the
+ * keyboard. Each tick handles the events of the tick, does the logic and renders,
+ * like a frame of `TetrisState`.
+ *
+ * Unless the `SDL_VIDEODRIVER` environment variable is set, the dummy video driver
+ * is used, so no window is shown and rendering goes through the software renderer.
+ * Has to be run from the game directory as it loads the game assets.
+ */
+class ReplayRunner
+{
+public:
+    /**
+     * @brief Initialize SDL and load the layout assets.
+     * @throws `ExceptionSDL` and `ExceptionFile` thrown if loading failed.
+     */
+    static void init();
+
+    /// Free the layout and quit SDL.
+    static void free();
+
+    /**
+     * @brief Run `replay` from a new game until its last tick or the game over.
+     * @param replay The replay.
+     * @param[out] stats Costs and outcome of the run.
+     * @param render If `false`, only the first frame is rendered.
+     */
+    static void run(const Replay &replay, ReplayStats &stats, bool render=true);
+
+private:
+    /// Start a new game like `TetrisState::enter` does.
+    static void reset_layout();
+
+    /// Pass `event` to the layout if it changes the key state.
+    static void handle_event(const ReplayEvent &event);
+
+    static Game game;
+    static Window window;
+    static Renderer renderer;
+    static TextureAtlas atlas;
+    static Font font;
+    static KeyLayout tetrisKeyLayout, tetriminoKeyLayout;
+    static Texture bgTexture, blockTextureSheet;
+    static Texture fieldBgTexture, fieldFrameTexture, fieldClearTexture;
+    static Texture fieldClearParticleTextureSheet;
+    static Text linesClearedText, linesClearedPromptText;
+    static Text scoreText, scorePromptText, highScoreText, highScorePromptText;
+    static Text msgText, comboText;
+    static Timer tetriminoTimer, clearLineTimer, msgTextTimer, gameOverTimer;
+    static TetrisLayout layout;
+
+    static Uint8 keys[SDL_NUM_SCANCODES]; // Key states of the replay.
+};
+
+
+#endif
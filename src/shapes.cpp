@@ -31,7 +31,7 @@ void Frame::init (
     Renderer &renderer, int x, int y, int w, int h, int thickness, const Color &color
 )
 {
-    log("Initializing Frame", __FILE__, __LINE__);
+    LOG_DEBUG("Initializing Frame");
 
     up.init(renderer, x, y, w, thickness, color);
     down.init(renderer, x, y + h - thickness, w, thickness, color);
@@ -61,7 +61,7 @@ void Frame::set_color (const Color &color)
 
 void Box::init (Renderer &renderer, const Color &fillColor, const Color &frameColor)
 {
-    log("Initializing Box", __FILE__, __LINE__);
+    LOG_DEBUG("Initializing Box");
 
     this->renderer = &renderer;
     this->fillColor = fillColor;
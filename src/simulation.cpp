@@ -0,0 +1,117 @@
+/**
+ * @file  simulation.cpp
+ * @brief Implementation of the class Simulation.
+ */
+
+#include "simulation.hpp"
+#include "game.hpp"
+#include "trace.hpp"
+#include "logger.hpp"
+#include "flight_recorder.hpp"
+
+
+Simulation::~Simulation ()
+{
+    stop();
+}
+
+void Simulation::start (Game &game, Task &task)
+{
+    stop();
+
+    LOG_INFO("Starting the simulation thread");
+
+    this->game = &game;
+    this->task = &task;
+    error = nullptr;
+    running.store(true);
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop ()
+{
+    if (!thread.joinable())
+    {
+        return;
+    }
+    LOG_INFO("Stopping the simulation thread");
+
+    running.store(false);
+    thread.join();
+
+    // The thread no longer consumes events, so this one can
+    SDL_Event e;
+    while (events.pop(e)) {}
+}
+
+void Simulation::push_event (const SDL_Event &e)
+{
+    while (running.load() && !events.push(e))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Simulation::lock ()
+{
+    mutex.lock();
+}
+
+void Simulation::unlock ()
+{
+    mutex.unlock();
+}
+
+void Simulation::rethrow_error ()
+{
+    if (running.load() || !thread.joinable())
+    {
+        return;
+    }
+    stop();
+    if (error)
+    {
+        std::exception_ptr stored = error;
+        error = nullptr;
+        std::rethrow_exception(stored);
+    }
+}
+
+void Simulation::run ()
+{
+    FlightRecorder::record_thread("simulation");
+
+    while (running.load())
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tick();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            running.store(false);
+            return;
+        }
+        SDL_Delay(SIMULATION_TICK_MS);
+    }
+}
+
+void Simulation::tick ()
+{
+    TRACE_ZONE("Simulation::tick");
+
+    FlightRecorder::record_tick();
+
+    SDL_Event e;
+    while (events.pop(e))
+    {
+        FlightRecorder::record_input(e);
+        task->simulate_event(*game, e);
+    }
+    if (!game->is_paused())
+    {
+        task->simulate_tick();
+    }
+}
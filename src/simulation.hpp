@@ -0,0 +1,101 @@
+/**
+ * @file  simulation.hpp
+ * @brief Include file for Simulation class.
+ */
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+
+#include "spsc_queue.hpp"
+#include "constants.hpp"
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+
+class Game;
+
+/**
+ * @brief Runs gameplay input handling and logic on a dedicated thread.
+ * @details
+ * Every `SIMULATION_TICK_MS` ms the thread hands the queued input events to the
+ * task and, unless the game is paused, does a tick of its logic. The task hands what
+ * rendering needs to the main thread itself, e.g. with a `TripleBuffer`, so that
+ * slow frames never delay the logic.
+ *
+ * Ticks hold the simulation lock, which the main thread takes to change what the
+ * logic reads, e.g. when pausing:
+ * @code
+ * std::lock_guard<Simulation> lock(simulation);
+ * @endcode
+ */
+class Simulation
+{
+public:
+    /// Logic run on the simulation thread.
+    class Task
+    {
+    public:
+        /// Handle an input event.
+        virtual void simulate_event(Game &game, const SDL_Event &e) = 0;
+
+        /// Do a tick of logic. Not called while the game is paused.
+        virtual void simulate_tick() = 0;
+
+        virtual ~Task(){};
+    };
+
+    /// Stop the thread if it is running.
+    ~Simulation();
+
+    /**
+     * @brief Start running `task` on the simulation thread.
+     * @note Stores pointers to `game` and `task`. Stops the running task first.
+     */
+    void start(Game &game, Task &task);
+
+    /// Stop and join the thread if it is running. Drops the queued events.
+    void stop();
+
+    /**
+     * @brief Queue `e` for the running task, if any.
+     * @details
+     * If the queue is full, waits for the thread to make room, so that no input is
+     * lost.
+     */
+    void push_event(const SDL_Event &e);
+
+    /// Wait for the current tick to end and keep the thread from starting another.
+    void lock();
+
+    /// Let the thread tick again.
+    void unlock();
+
+    /**
+     * @brief Rethrow the exception which stopped the thread, if any.
+     * @throws Whatever the task threw on the simulation thread.
+     */
+    void rethrow_error();
+
+private:
+    /// Thread loop.
+    void run();
+
+    /// Handle the queued events and do a tick of logic.
+    void tick();
+
+    Game *game;
+    Task *task;
+    SpscQueue<SDL_Event, SIMULATION_EVENT_QUEUE_LEN> events;
+    std::thread thread;
+    std::mutex mutex; // Held during ticks.
+    std::atomic<bool> running{false};
+    std::exception_ptr error; // Set by the thread before it stops on an exception.
+};
+
+
+#endif
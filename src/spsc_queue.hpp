@@ -0,0 +1,71 @@
+/**
+ * @file  spsc_queue.hpp
+ * @brief Include file for SpscQueue class template.
+ */
+
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * @brief A lock-free bounded queue for a single producer and a single consumer
+ *     thread.
+ * @details
+ * Elements are copied into a fixed ring, so neither pushing nor popping allocates
+ * or blocks. The producer only writes `tail` and the consumer only writes `head`.
+ * @tparam T Element type. Has to be default constructible and copyable.
+ * @tparam N Capacity. Must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(
+        N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two"
+    );
+
+public:
+    /**
+     * @brief Append `value`. Only called by the producer.
+     * @return `false` if the queue is full and `value` was not appended.
+     */
+    bool push (const T &value)
+    {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == N)
+        {
+            return false;
+        }
+        ring[tail & (N - 1)] = value;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element. Only called by the consumer.
+     * @param[out] value The removed element.
+     * @return `false` if the queue is empty.
+     */
+    bool pop (T &value)
+    {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = ring[head & (N - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T ring[N];
+    std::atomic<size_t> head{0}; // Position of the oldest element.
+    std::atomic<size_t> tail{0}; // Position the next element is pushed to.
+};
+
+
+#endif
@@ -4,6 +4,9 @@
  */
 
 #include "states.hpp"
+#include "trace.hpp"
+#include "alloc_tracker.hpp"
+#include "flight_recorder.hpp"
 #include "audio.hpp"
 #include "util.hpp"
 #include "constants.hpp"
@@ -285,7 +288,9 @@ TitleScreenState *TitleScreenState::get ()
 
 void TitleScreenState::enter (Game *game)
 {
-    log("Entering TitleScreen", __FILE__, __LINE__);
+    TRACE_ZONE("TitleScreenState::enter");
+
+    LOG_INFO("Entering TitleScreen");
 
     this->game = game;
     
@@ -302,7 +307,9 @@ void TitleScreenState::enter (Game *game)
 
 void TitleScreenState::exit ()
 {
-    log("Exiting TitleScreen", __FILE__, __LINE__);
+    TRACE_ZONE("TitleScreenState::exit");
+
+    LOG_INFO("Exiting TitleScreen");
 
     bgTexture.free();
     titleText.free();
@@ -311,6 +318,8 @@ void TitleScreenState::exit ()
 
 void TitleScreenState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("TitleScreenState::handle_event");
+
     keyLayout.handle_event(game, e);
     if (keyLayout.get_type() == KeyLayout::DOWN && !game.is_paused())
     {
@@ -328,6 +337,8 @@ void TitleScreenState::do_logic () {}
 
 void TitleScreenState::render ()
 {
+    TRACE_ZONE("TitleScreenState::render");
+
     bgTexture.render(
         (game->get_renderer_width() - bgTexture.get_width()) / 2,
         (game->get_renderer_height() - bgTexture.get_height()) / 2
@@ -344,6 +355,11 @@ void TitleScreenState::render ()
     );
 }
 
+bool TitleScreenState::is_static () const
+{
+    return true;
+}
+
 void TitleScreenState::pause_timers () {}
 void TitleScreenState::unpause_timers () {}
 
@@ -357,7 +373,9 @@ MenuState *MenuState::get ()
 
 void MenuState::enter (Game *game)
 {
-    log("Entering Menu", __FILE__, __LINE__);
+    TRACE_ZONE("MenuState::enter");
+
+    LOG_INFO("Entering Menu");
 
     this->game = game;
 
@@ -370,13 +388,17 @@ void MenuState::enter (Game *game)
 
 void MenuState::exit ()
 {
-    log("Exiting Menu", __FILE__, __LINE__);
+    TRACE_ZONE("MenuState::exit");
+
+    LOG_INFO("Exiting Menu");
 
     menu.free();
 }
 
 void MenuState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("MenuState::handle_event");
+
     if (!game.is_paused())
     {
         menu.handle_event(game, e);
@@ -385,6 +407,8 @@ void MenuState::handle_event (Game &game, const SDL_Event &e)
 
 void MenuState::do_logic ()
 {
+    TRACE_ZONE("MenuState::do_logic");
+
     if (menu.choosen_option() != -1)
     {
         switch (menu.choosen_option())
@@ -404,9 +428,16 @@ void MenuState::do_logic ()
 
 void MenuState::render ()
 {
+    TRACE_ZONE("MenuState::render");
+
     menu.render(0, 0, game->get_renderer_width(), game->get_renderer_height());
 }
 
+bool MenuState::is_static () const
+{
+    return true;
+}
+
 void MenuState::pause_timers () {}
 void MenuState::unpause_timers () {}
 
@@ -420,7 +451,9 @@ PlayersSelectState *PlayersSelectState::get()
 
 void PlayersSelectState::enter (Game *game)
 {
-    log("Entering PlayersSelect", __FILE__, __LINE__);
+    TRACE_ZONE("PlayersSelectState::enter");
+
+    LOG_INFO("Entering PlayersSelect");
 
     this->game = game;
 
@@ -433,13 +466,17 @@ void PlayersSelectState::enter (Game *game)
 
 void PlayersSelectState::exit ()
 {
-    log("Exiting PlayersSelect", __FILE__, __LINE__);
+    TRACE_ZONE("PlayersSelectState::exit");
+
+    LOG_INFO("Exiting PlayersSelect");
 
     menu.free();
 }
 
 void PlayersSelectState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("PlayersSelectState::handle_event");
+
     if (!game.is_paused())
     {
         menu.handle_event(game, e);
@@ -448,6 +485,8 @@ void PlayersSelectState::handle_event (Game &game, const SDL_Event &e)
 
 void PlayersSelectState::do_logic ()
 {
+    TRACE_ZONE("PlayersSelectState::do_logic");
+
     if (menu.choosen_option() != -1)
     {
         switch (menu.choosen_option())
@@ -467,9 +506,16 @@ void PlayersSelectState::do_logic ()
 
 void PlayersSelectState::render ()
 {
+    TRACE_ZONE("PlayersSelectState::render");
+
     menu.render(0, 0, game->get_renderer_width(), game->get_renderer_height());
 }
 
+bool PlayersSelectState::is_static () const
+{
+    return true;
+}
+
 void PlayersSelectState::pause_timers () {}
 void PlayersSelectState::unpause_timers () {}
 
@@ -483,7 +529,9 @@ TetrisState *TetrisState::get ()
 
 void TetrisState::enter (Game *game)
 {
-    log("Entering Tetris", __FILE__, __LINE__);
+    TRACE_ZONE("TetrisState::enter");
+
+    LOG_INFO("Entering Tetris");
 
     this->game = game;
 
@@ -491,7 +539,7 @@ void TetrisState::enter (Game *game)
     namespace fs = std::filesystem;
     if (!fs::exists("high_score.hs"))
     {
-        log("high_score.hs does not exist, creating it", __FILE__, __LINE__);
+        LOG_INFO("high_score.hs does not exist, creating it");
         std::ofstream createFile(
             "high_score.hs", std::ofstream::out | std::ofstream::binary
         );
@@ -571,11 +619,21 @@ void TetrisState::enter (Game *game)
     tetriminoTimer.start();
 
     Audio::set_music(Audio::TETRIS);
+
+    // Gameplay should not allocate once the first frames have loaded everything
+    AllocTracker::set_budget(ALLOC_FRAME_BUDGET, ALLOC_BUDGET_WARMUP_FRAMES);
+
+    game->start_simulation(*this);
 }
 
 void TetrisState::exit ()
 {
-    log("Exiting Tetris", __FILE__, __LINE__);
+    TRACE_ZONE("TetrisState::exit");
+
+    game->stop_simulation();
+    AllocTracker::clear_budget();
+
+    LOG_INFO("Exiting Tetris");
 
     int score = tetris.get_score();
     game->set_scores(score, highScore);
@@ -623,6 +681,8 @@ void TetrisState::exit ()
 
 void TetrisState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("TetrisState::handle_event");
+
     // Force transition to ResultsScreenState
     keyLayout.handle_event(game, e);
     if (keyLayout.get_type() == KeyLayout::DOWN && !game.is_paused())
@@ -634,32 +694,56 @@ void TetrisState::handle_event (Game &game, const SDL_Event &e)
             break;
         }
     }
-
-    tetris.handle_event(game, e);
 }
 
 void TetrisState::do_logic ()
 {
-    if (tetris.game_over())
+    TRACE_ZONE("TetrisState::do_logic");
+
+    tetris.update_snapshot();
+    const TetrisLayout::Snapshot &snapshot = tetris.get_snapshot();
+    if (snapshot.gameOver)
     {
-        if (gameOverTimer.get_elapsed() >= 1500)
+        if (snapshot.gameOverElapsed >= 1500)
         {
             game->set_next_state(ResultsScreenState::get());
         }
         
         Audio::stop_music(Audio::TETRIS);
     }
-    else
+}
+
+void TetrisState::simulate_event (Game &game, const SDL_Event &e)
+{
+    tetris.handle_event(game, e);
+}
+
+void TetrisState::simulate_tick ()
+{
+    bool gameOver = tetris.game_over();
+    if (!gameOver)
     {
         tetris.do_logic();
     }
+    Uint32 checksum = tetris.publish();
+    if (!gameOver)
+    {
+        FlightRecorder::record_checksum(0, checksum);
+    }
 }
 
 void TetrisState::render ()
 {
+    TRACE_ZONE("TetrisState::render");
+
     tetris.render(0, 0, game->get_renderer_width(), game->get_renderer_height());
 }
 
+bool TetrisState::is_static () const
+{
+    return false;
+}
+
 void TetrisState::pause_timers ()
 {
     tetriminoTimer.pause();
@@ -686,7 +770,9 @@ TetrisPVPState *TetrisPVPState::get ()
 
 void TetrisPVPState::enter (Game *game)
 {
-    log("Entering TetrisPVP", __FILE__, __LINE__);
+    TRACE_ZONE("TetrisPVPState::enter");
+
+    LOG_INFO("Entering TetrisPVP");
 
     this->game = game;
     
@@ -756,7 +842,7 @@ void TetrisPVPState::enter (Game *game)
             &scoreTexts[i], &scorePromptText,
             nullptr, nullptr,
             &msgTexts[i], &comboTexts[i],
-            layout
+            layout, i
         );
     }
     for (int i = 0; i < players; ++i)
@@ -765,11 +851,20 @@ void TetrisPVPState::enter (Game *game)
     }
 
     Audio::set_music(Audio::TETRIS);
+
+    AllocTracker::set_budget(ALLOC_FRAME_BUDGET, ALLOC_BUDGET_WARMUP_FRAMES);
+
+    game->start_simulation(*this);
 }
 
 void TetrisPVPState::exit ()
 {
-    log("Exiting TetrisPVP", __FILE__, __LINE__);
+    TRACE_ZONE("TetrisPVPState::exit");
+
+    game->stop_simulation();
+    AllocTracker::clear_budget();
+
+    LOG_INFO("Exiting TetrisPVP");
 
     // Pass the best score player index and their score to game
     int score, highScore = -1, winner;
@@ -810,6 +905,8 @@ void TetrisPVPState::exit ()
 
 void TetrisPVPState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("TetrisPVPState::handle_event");
+
     // Force transition to ResultsScreenState
     keyLayout.handle_event(game, e);
     if (keyLayout.get_type() == KeyLayout::DOWN && !game.is_paused())
@@ -821,57 +918,69 @@ void TetrisPVPState::handle_event (Game &game, const SDL_Event &e)
             break;
         }
     }
-
-    for (int i = 0; i < players; ++i)
-    {
-        tetris[i].handle_event(game, e);
-    }
 }
 
 void TetrisPVPState::do_logic ()
 {
-    int players_checked;
-    for (players_checked = 0; players_checked < players; ++players_checked)
+    TRACE_ZONE("TetrisPVPState::do_logic");
+
+    bool allOver = true, allWaited = true;
+    for (int i = 0; i < players; ++i)
     {
-        if (!tetris[players_checked].game_over())
+        tetris[i].update_snapshot();
+        const TetrisLayout::Snapshot &snapshot = tetris[i].get_snapshot();
+        if (!snapshot.gameOver)
         {
-            break;
+            allOver = false;
+        }
+        else if (snapshot.gameOverElapsed < 1500)
+        {
+            allWaited = false;
         }
     }
     // If all players got a game over, end the game
-    if (players_checked == players)
+    if (allOver)
     {
-        int timers_checked;
-        for (timers_checked = 0; timers_checked < players; ++timers_checked)
-        {
-            if (gameOverTimers[timers_checked].get_elapsed() < 1500)
-            {
-                break;
-            }
-        }
         // If all game over pauses have elapsed, transit to ResultsScreenState
-        if (timers_checked == players)
+        if (allWaited)
         {
             game->set_next_state(ResultsScreenState::get());
         }
 
         Audio::stop_music(Audio::TETRIS);
     }
-    else
+}
+
+void TetrisPVPState::simulate_event (Game &game, const SDL_Event &e)
+{
+    for (int i = 0; i < players; ++i)
     {
-        // If at least one player hasn't reached game over, keep doing logic for them
-        for (int i = 0; i < players; ++i)
+        tetris[i].handle_event(game, e);
+    }
+}
+
+void TetrisPVPState::simulate_tick ()
+{
+    // If at least one player hasn't reached game over, keep doing logic for them
+    for (int i = 0; i < players; ++i)
+    {
+        bool gameOver = tetris[i].game_over();
+        if (!gameOver)
         {
-            if (!tetris[i].game_over())
-            {
-                tetris[i].do_logic();
-            }
+            tetris[i].do_logic();
+        }
+        Uint32 checksum = tetris[i].publish();
+        if (!gameOver)
+        {
+            FlightRecorder::record_checksum(i, checksum);
         }
     }
 }
 
 void TetrisPVPState::render ()
 {
+    TRACE_ZONE("TetrisPVPState::render");
+
     switch (players)
     {
     case 2:
@@ -931,6 +1040,11 @@ void TetrisPVPState::render ()
     }
 }
 
+bool TetrisPVPState::is_static () const
+{
+    return false;
+}
+
 void TetrisPVPState::pause_timers ()
 {
     for (int i = 0; i < players; ++i)
@@ -963,7 +1077,9 @@ ResultsScreenState *ResultsScreenState::get ()
 
 void ResultsScreenState::enter (Game *game)
 {
-    log("Entering ResultsScreen", __FILE__, __LINE__);
+    TRACE_ZONE("ResultsScreenState::enter");
+
+    LOG_INFO("Entering ResultsScreen");
 
     this->game = game;
 
@@ -1000,7 +1116,9 @@ void ResultsScreenState::enter (Game *game)
 
 void ResultsScreenState::exit()
 {
-    log("Entering ResultsScreen", __FILE__, __LINE__);
+    TRACE_ZONE("ResultsScreenState::exit");
+
+    LOG_INFO("Entering ResultsScreen");
 
     bgTexture.free();
     titleText.free();
@@ -1009,6 +1127,8 @@ void ResultsScreenState::exit()
 
 void ResultsScreenState::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("ResultsScreenState::handle_event");
+
     // Force transition to MenuState
     keyLayout.handle_event(game, e);
     if (keyLayout.get_type() == KeyLayout::DOWN && !game.is_paused())
@@ -1031,6 +1151,8 @@ void ResultsScreenState::handle_event (Game &game, const SDL_Event &e)
 
 void ResultsScreenState::do_logic ()
 {
+    TRACE_ZONE("ResultsScreenState::do_logic");
+
     // Wait before transitioning back to MenuState
     if (resultsTimer.get_elapsed() >= 5000)
     {
@@ -1047,6 +1169,8 @@ void ResultsScreenState::do_logic ()
 
 void ResultsScreenState::render ()
 {
+    TRACE_ZONE("ResultsScreenState::render");
+
     bgTexture.render(
         (game->get_renderer_width() - bgTexture.get_width()) / 2,
         (game->get_renderer_height() - bgTexture.get_height()) / 2
@@ -1063,6 +1187,11 @@ void ResultsScreenState::render ()
     );
 }
 
+bool ResultsScreenState::is_static () const
+{
+    return true;
+}
+
 void ResultsScreenState::pause_timers ()
 {
     resultsTimer.pause();
@@ -1082,18 +1211,27 @@ GameOverState *GameOverState::get ()
 
 void GameOverState::enter (Game *game)
 {
-    log("Entering GameOver", __FILE__, __LINE__);
+    TRACE_ZONE("GameOverState::enter");
+
+    LOG_INFO("Entering GameOver");
     
     Audio::stop_music();
 }
 
 void GameOverState::exit ()
 {
-    log("Exiting GameOver", __FILE__, __LINE__);
+    TRACE_ZONE("GameOverState::exit");
+
+    LOG_INFO("Exiting GameOver");
 }
 
 void GameOverState::handle_event (Game &game, const SDL_Event &e) {}
 void GameOverState::do_logic () {}
 void GameOverState::render () {}
+bool GameOverState::is_static () const
+{
+    return true;
+}
+
 void GameOverState::pause_timers () {}
 void GameOverState::unpause_timers () {}
@@ -14,6 +14,7 @@
 #include "menu.hpp"
 #include "key_layout.hpp"
 #include "tetris_layout.hpp"
+#include "simulation.hpp"
 
 #include <SDL2/SDL.h>
 #include <vector>
@@ -40,6 +41,12 @@ public:
     /// Render the scene without clearing the previous one.
     virtual void render() = 0;
 
+    /**
+     * @brief `true` if the scene only changes on events, so that it is not rendered
+     *     again until an event arrives.
+     */
+    virtual bool is_static() const = 0;
+
     /// Pause all timers.
     virtual void pause_timers() = 0;
 
@@ -68,6 +75,7 @@ public:
 
     void do_logic();
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -96,6 +104,7 @@ public:
     void handle_event(Game &game, const SDL_Event &e);
     void do_logic();
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -121,6 +130,7 @@ public:
     void handle_event(Game &game, const SDL_Event &e);
     void do_logic();
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -134,9 +144,16 @@ private:
     Menu menu;
 };
 
-/// The main state with the Tetris itself.
-class TetrisState: public GameState
+/**
+ * @brief The main state with the Tetris itself.
+ * @details
+ * The layout's input handling and logic run on the simulation thread, while
+ * rendering and state transitions use its published snapshots.
+ */
+class TetrisState: public GameState, public Simulation::Task
 {
+    friend class ReplayRunner; // Replays use the gameplay key maps
+
 public:
     static TetrisState *get();
 
@@ -146,13 +163,14 @@ public:
     };
 
     /**
-     * @brief Read the high score.
+     * @brief Read the high score and start the simulation.
      * @throws `ExceptionFile` thrown if `path` does not exist or is not readable.
      */
     void enter(Game *game);
 
     /**
-     * @brief Pass the scores to `Game`. If the high score has changed, write it.
+     * @brief Stop the simulation. Pass the scores to `Game`. If the high score has
+     *     changed, write it.
      * @throws `ExceptionFile` thrown if `path` does not exist or is not writeable.
      */
     void exit();
@@ -163,7 +181,14 @@ public:
     /// If the game is over, wait before transitioning to `ResultsScreenState`.
     void do_logic();
 
+    /// Handle the layout events on the simulation thread.
+    void simulate_event(Game &game, const SDL_Event &e);
+
+    /// Do the layout logic on the simulation thread and publish a snapshot.
+    void simulate_tick();
+
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -188,8 +213,8 @@ private:
     int highScore;
 };
 
-/// Multiple players tetris state.
-class TetrisPVPState: public GameState
+/// Multiple players tetris state. Runs like `TetrisState`.
+class TetrisPVPState: public GameState, public Simulation::Task
 {
 public:
     static TetrisPVPState *get();
@@ -199,18 +224,26 @@ public:
         END, // Force transition to `ResultsScreenState`
     };
 
+    /// Start the simulation.
     void enter(Game *game);
 
-    /// Pass the scores to `Game`. If the high score has changed, write it.
+    /// Stop the simulation. Pass the scores to `Game`.
     void exit();
     
     /// Force transition to `ResultsScreenState` on `END` key press.
     void handle_event(Game &game, const SDL_Event &e);
 
-    /// If the game is over, wait before transitioning to `ResultsScreenState`.
+    /// If all games are over, wait before transitioning to `ResultsScreenState`.
     void do_logic();
 
+    /// Handle the layouts events on the simulation thread.
+    void simulate_event(Game &game, const SDL_Event &e);
+
+    /// Do the logic of layouts that are not over and publish their snapshots.
+    void simulate_tick();
+
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -261,6 +294,7 @@ public:
     void do_logic();
 
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -291,6 +325,7 @@ public:
     void handle_event(Game &game, const SDL_Event &e);
     void do_logic();
     void render();
+    bool is_static() const;
 
     void pause_timers();
     void unpause_timers();
@@ -82,6 +82,32 @@ void Tetrimino::render_config (
     }
 }
 
+void Tetrimino::render_view (const TetriminoView &view, int x, int y, int size)
+{
+    SDL_Point shift = {int(view.progress.x * size), int(view.progress.y * size)};
+    Block block(view.blockTextureSheet, view.clip);
+    for (int i = 0; i < view.totalBlocks; ++i)
+    {
+        block.render(
+            x + view.cells[i].x * size + shift.x,
+            y + view.cells[i].y * size + shift.y,
+            size
+        );
+    }
+    if (view.totalBlocks && view.ghostShift)
+    {
+        Block ghost(view.blockTextureSheet, &blockClips[TETRIMINO_TOTAL]);
+        for (int i = 0; i < view.totalBlocks; ++i)
+        {
+            ghost.render(
+                x + view.cells[i].x * size + shift.x,
+                y + (view.cells[i].y + view.ghostShift) * size,
+                size
+            );
+        }
+    }
+}
+
 void Tetrimino::init (
     TetrisField *field, Texture *blockTextureSheet, KeyLayout *keyLayout
 )
@@ -90,38 +116,39 @@ void Tetrimino::init (
     this->blockTextureSheet = blockTextureSheet;
     this->keyLayout = keyLayout;
     totalBlocks = 0;
+    blocks.reserve(MAX_SCHEME_LEN * MAX_SCHEME_LEN);
 }
 
 void Tetrimino::free (bool logMsg)
 {
     if (logMsg)
     {
-        log("Freeing Tetrimino", __FILE__, __LINE__);
+        LOG_DEBUG("Freeing Tetrimino");
     }
 
     for (Block *block: blocks)
     {
-        delete block;
+        field->destroy_block(block);
     }
     blocks.resize(0);
 }
 
 bool Tetrimino::spawn (
-    int posX, int posY, int fallDelay, const TetriminoConfig &config,
-    bool ghost
+    int posX, int posY, int fallDelay, const TetriminoConfig &config
 )
 {
     this->type = config.type;
     this->rot = config.rot;
     this->posX = posX;
     this->posY = posY;
+    ghostValid = false;
 
     bool fit = true;
 
     rotations = &schemes[config.type];
 
     // Check if the tetrimino fits and create blocks
-    SDL_Rect *clip = ghost ? &blockClips[TETRIMINO_TOTAL] : &blockClips[config.type];
+    SDL_Rect *clip = &blockClips[config.type];
     totalBlocks = 0;
     for (int row = 0; row < MAX_SCHEME_LEN; ++row)
     {
@@ -134,18 +161,12 @@ bool Tetrimino::spawn (
                     fit = false;
                 }
                 
-                blocks.push_back(new Block(blockTextureSheet, clip));
+                blocks.push_back(field->create_block(blockTextureSheet, clip));
                 ++totalBlocks;
             }
         }
     }
 
-    // Only needed to create the blocks for a ghost
-    if (ghost)
-    {
-        return true;
-    }
-
     fallElapsed = sideElapsed = rotElapsed = 0;
     sideVel = rotVel = 0;
     
@@ -177,23 +198,25 @@ bool Tetrimino::spawn (
     return fit;
 }
 
-void Tetrimino::render (int x, int y, int size)
+void Tetrimino::take_view (TetriminoView &view)
 {
+    view.totalBlocks = totalBlocks;
+    view.blockTextureSheet = blockTextureSheet;
     if (!totalBlocks)
     {
         return;
     }
-    int blocksRendered = 0;
+    view.clip = &blockClips[type];
+
+    int blocksFound = 0;
     for (int row = 0; row < MAX_SCHEME_LEN; ++row)
     {
         for (int col = 0; col < MAX_SCHEME_LEN; ++col)
         {
             if ((*rotations)[rot][row][col])
             {
-                blocks[blocksRendered]->render(
-                    x + (posX + col) * size, y + (posY + row) * size, size
-                );
-                if (++blocksRendered == totalBlocks)
+                view.cells[blocksFound] = {posX + col, posY + row};
+                if (++blocksFound == totalBlocks)
                 {
                     row = MAX_SCHEME_LEN;
                     break;
@@ -201,19 +224,46 @@ void Tetrimino::render (int x, int y, int size)
             }
         }
     }
-    // Render a ghost
-    if (!check_collision_bottom())
+    // The ghost is where the tetrimino would be dropped to. Falling towards it does
+    // not change where that is, so it is only searched again after other moves.
+    if (
+        !ghostValid || posX != ghostPosX || rot != ghostRot || posY < ghostFromY
+        || posY > ghostY || field->get_version() != ghostVersion
+    )
+    {
+        ghostValid = true;
+        ghostPosX = posX;
+        ghostRot = rot;
+        ghostFromY = ghostY = posY;
+        ghostVersion = field->get_version();
+        if (!check_collision_bottom())
+        {
+            drop();
+            ghostY = posY;
+            posY = ghostFromY;
+        }
+    }
+    view.ghostShift = ghostY - posY;
+
+    view.progress = {0, 0};
+    if (view.ghostShift && fallDelay)
+    {
+        view.progress.y = std::min(1.0f, float(fallElapsed) / fallDelay);
+    }
+    if (sideElapsed * sideVel > 0)
     {
-        Tetrimino ghost;
-        ghost.init(field, blockTextureSheet, nullptr);
-        ghost.spawn(posX, posY, -1, TetriminoConfig(type, rot), true);
-        ghost.drop();
-        ghost.render(x, y, size);
-        ghost.free(false);
+        int dir = sideVel > 0 ? 1 : -1;
+        posX += dir;
+        bool blocked = dir > 0 ? check_collision_right() : check_collision_left();
+        posX -= dir;
+        if (!blocked)
+        {
+            view.progress.x = sideElapsed / 1000.0f;
+        }
     }
 }
 
-void Tetrimino::handle_event (Game &game, const SDL_Event &e)
+void Tetrimino::handle_event (Game &game, const SDL_Event &e, Uint32 late)
 {
     if (!totalBlocks)
     {
@@ -230,6 +280,7 @@ void Tetrimino::handle_event (Game &game, const SDL_Event &e)
                 shift(1);
             }
             sideVel += TETRIMINO_SIDE_SPEED;
+            credit_late(sideVel, TETRIMINO_SIDE_SPEED, sideElapsed, late);
             break;
         case LEFT:
             if (!game.is_paused())
@@ -237,6 +288,7 @@ void Tetrimino::handle_event (Game &game, const SDL_Event &e)
                 shift(-1);
             }
             sideVel -= TETRIMINO_SIDE_SPEED;
+            credit_late(sideVel, -TETRIMINO_SIDE_SPEED, sideElapsed, late);
             break;
         case ACC:
             fallDelay /= TETRIMINO_DROP_ACC;
@@ -269,6 +321,7 @@ void Tetrimino::handle_event (Game &game, const SDL_Event &e)
                 }
             }
             rotVel += TETRIMINO_ROT_SPEED;
+            credit_late(rotVel, TETRIMINO_ROT_SPEED, rotElapsed, late);
             break;
         case ROT_CW:
             if (!game.is_paused())
@@ -283,6 +336,7 @@ void Tetrimino::handle_event (Game &game, const SDL_Event &e)
                 }
             }
             rotVel -= TETRIMINO_ROT_SPEED;
+            credit_late(rotVel, -TETRIMINO_ROT_SPEED, rotElapsed, late);
             break;
         }
     }
@@ -317,20 +371,27 @@ bool Tetrimino::fall (int dt)
         return true;
     }
     fallElapsed += dt;
-    if (fallElapsed >= fallDelay)
+    if (fallElapsed < fallDelay)
     {
-        fallElapsed -= fallDelay;
-        if (check_collision_bottom())
-        {
-            stop();
+        return false;
+    }
 
-            Audio::play_sound(Audio::TETRIMINO_STOP);
-            return true;
-        }
-        ++posY;
-            
-        Audio::play_sound(Audio::TETRIMINO_FALL);
+    // Fall all rows due at once, the one after the last free row releasing the
+    // blocks
+    int freeRows = get_free_rows();
+    int rows = fallDelay ? fallElapsed / fallDelay : max(1, freeRows);
+    fallElapsed -= rows * fallDelay;
+    if (rows > freeRows)
+    {
+        posY += freeRows;
+        stop();
+
+        Audio::play_sound(Audio::TETRIMINO_STOP);
+        return true;
     }
+    posY += rows;
+
+    Audio::play_sound(Audio::TETRIMINO_FALL);
     return false;
 }
 
@@ -354,7 +415,7 @@ void Tetrimino::move (int dt)
     if (sideElapsed / 1000)
     {
         shift(sideElapsed / 1000);
-        sideElapsed -= 1000 * sideVel / abs(sideVel);
+        sideElapsed %= 1000;
     }
 
     if (rotElapsed * rotVel <= 0)
@@ -377,7 +438,7 @@ void Tetrimino::move (int dt)
         {
             Audio::play_sound(Audio::TETRIMINO_BLOCKED);
         }
-        rotElapsed -= 1000 * rotVel / abs(rotVel);
+        rotElapsed %= 1000;
     }
 }
 
@@ -386,26 +447,78 @@ TetriminoConfig Tetrimino::get_config () const
     return TetriminoConfig(type, rot);
 }
 
+Uint32 Tetrimino::get_checksum (Uint32 hash) const
+{
+    for (
+        int value : {
+            int(type), int(rot), totalBlocks, posX, posY, fallElapsed, sideVel,
+            sideElapsed, rotVel, rotElapsed
+        }
+    )
+    {
+        hash = hash_combine(hash, value);
+    }
+    return hash;
+}
+
 void Tetrimino::shift (int dx)
 {
-    posX += dx;
-    if (dx > 0 && check_collision_right() || dx < 0 && check_collision_left())
+    // Sweep a column at a time, so that the tetrimino can not pass through blocks
+    int dir = dx > 0 ? 1 : -1, shifted = 0;
+    for (; shifted != dx; shifted += dir)
     {
-        posX -= dx;
+        posX += dir;
+        if (dir > 0 ? check_collision_right() : check_collision_left())
+        {
+            posX -= dir;
+            break;
+        }
+    }
 
-        Audio::play_sound(Audio::TETRIMINO_BLOCKED);
+    if (shifted)
+    {
+        Audio::play_sound(Audio::TETRIMINO_MOVE);
     }
     else
     {
-        Audio::play_sound(Audio::TETRIMINO_MOVE);
+        Audio::play_sound(Audio::TETRIMINO_BLOCKED);
     }
 }
 
 void Tetrimino::drop ()
 {
-    while (!check_collision_bottom())
+    posY += get_free_rows();
+}
+
+int Tetrimino::get_free_rows () const
+{
+    int freeRows = field->get_height();
+    int blocksFound = 0;
+    for (int row = 0; row < MAX_SCHEME_LEN; ++row)
+    {
+        for (int col = 0; col < MAX_SCHEME_LEN; ++col)
+        {
+            if ((*rotations)[rot][row][col])
+            {
+                freeRows = min(
+                    freeRows, field->get_free_below(posX + col, posY + row)
+                );
+                if (++blocksFound == totalBlocks)
+                {
+                    return freeRows;
+                }
+            }
+        }
+    }
+    return freeRows;
+}
+
+void Tetrimino::credit_late (int vel, int speed, int &elapsed, Uint32 late)
+{
+    // Otherwise the velocity was already set and its elapsed time runs
+    if (vel == speed)
     {
-        ++posY;
+        elapsed = vel * int(late);
     }
 }
 
@@ -553,9 +666,11 @@ void Tetrimino::stop ()
 }
 
 
+std::mt19937 TetriminoConfig::rng;
+
 TetriminoConfig::TetriminoConfig ()
-    : type(Tetrimino::TetriminoType(rand() % Tetrimino::TETRIMINO_TOTAL))
-    , rot(Tetrimino::TetriminoRotation(rand() % Tetrimino::TETRIMINO_ROTATION_TOTAL))
+    : type(Tetrimino::TetriminoType(rng() % Tetrimino::TETRIMINO_TOTAL))
+    , rot(Tetrimino::TetriminoRotation(rng() % Tetrimino::TETRIMINO_ROTATION_TOTAL))
 {}
 
 TetriminoConfig::TetriminoConfig (
@@ -564,3 +679,8 @@ TetriminoConfig::TetriminoConfig (
     : type(type)
     , rot(rot)
 {}
+
+void TetriminoConfig::seed (Uint32 seed)
+{
+    rng.seed(seed);
+}
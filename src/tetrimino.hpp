@@ -11,8 +11,10 @@
 #include "texture.hpp"
 #include "util.hpp"
 #include "key_layout.hpp"
+#include "constants.hpp"
 
 #include <SDL2/SDL.h>
+#include <random>
 #include <vector>
 #include <string>
 
@@ -29,9 +31,22 @@ class TetrisField;
 class Game;
 class KeyLayout;
 
+/// Where a tetrimino and its ghost are, for rendering them on another thread.
+struct TetriminoView
+{
+    int totalBlocks = 0; // `0` if there is no tetrimino.
+    SDL_Point cells[MAX_SCHEME_LEN * MAX_SCHEME_LEN]; // Field position of each block.
+    int ghostShift; // Rows the ghost is below the blocks; `0` to not render it.
+    SDL_FPoint progress; // Fraction of the way to the next column and row.
+    Texture *blockTextureSheet;
+    const SDL_Rect *clip; // Clip of the blocks from `blockTextureSheet`.
+};
+
 /// The tetrimino class.
 class Tetrimino
 {
+    friend class EngineBench; // Benchmarks private hot paths (see bench/)
+
 public:
     /// Tetrimino commands.
     enum Commands{
@@ -89,11 +104,25 @@ public:
         Texture *blockTextureSheet
     );
 
+    /**
+     * @brief Render a tetrimino `view` with given parameters.
+     * @details
+     * Renders the ghost too if the tetrimino does not have blocks directly beneath.
+     * The blocks are drawn the `progress` of a cell on their way to the next column
+     * and row, so that they move smoothly between ticks. The ghost only follows
+     * horizontally, as it stays on its row.
+     * @param view The tetrimino to render.
+     * @param x Field x coordinate.
+     * @param y Field y coordinate.
+     * @param size The block size.
+     */
+    static void render_view(const TetriminoView &view, int x, int y, int size);
+
     /// Store `field`, `blockTextureSheet`, and `keyLayout`.
     void init(TetrisField *field, Texture *blockTextureSheet, KeyLayout *keyLayout);
 
     /**
-     * @brief Free the blocks.
+     * @brief Return the blocks to the field.
      * @param logMsg If `true`, log a message; default is `true`.
      */
     void free(bool logMsg=true);
@@ -104,24 +133,19 @@ public:
      * @param posY Field position y coordinate.
      * @param fallDelay Falling period.
      * @param config The tetrimino to spawn.
-     * @param ghost If `true`, use the ghost texture; default is `false`.
      * @return `true` if the tetrimino fits into the field.
      */
-    bool spawn(
-        int posX, int posY, int fallDelay, const TetriminoConfig &config,
-        bool ghost=false
-    );
+    bool spawn(int posX, int posY, int fallDelay, const TetriminoConfig &config);
 
     /**
-     * @brief If initialized, render the tetrimino with given parameters.
+     * @brief Store where the tetrimino and its ghost are to `view`.
      * @details
-     * If the tetrimino doesn't have blocks directly beneath, renders a ghost.
-     * @note Actual coordinates are calculated based on the tetrimino field position.
-     * @param x Field x coordinate.
-     * @param y Field y coordinate.
-     * @param size The block size.
+     * The progress to the next row is the elapsed part of the fall delay and the
+     * progress to the next column the auto shift accumulated while moving sideways,
+     * both `0` if the tetrimino can not move there.
+     * @see render_view
      */
-    void render(int x, int y, int size);
+    void take_view(TetriminoView &view);
 
     /**
      * @brief If initialized, handle tetrimino events.
@@ -133,15 +157,21 @@ public:
      * TetrisField.
      * On `ROT_CCW` or `ROT_CW` key press rotates the tetrimino counter-clockwise or
      * clockwise respectively and sets rotation speed.
+     * @param game The game.
+     * @param e The event.
+     * @param late Ms the event happened before the logic it is handled in. Auto
+     *     shifting or rotating started by a key press is credited with this time,
+     *     so that it repeats as if the press was handled when it happened.
      */
-    void handle_event(Game &game, const SDL_Event &e);
+    void handle_event(Game &game, const SDL_Event &e, Uint32 late=0);
 
     /**
      * @brief If initialized, move the tetrimino downwards if enough time has passed.
      * @details
-     * If there was a field block beneath before the call, moves the blocks to the
-     * tetris field.
-     * @note Moves no more than one block at a time.
+     * Falls a row for each fall delay passed, all in one call. If a field block or
+     * the bottom is reached before all rows were fallen, moves the blocks to the
+     * tetris field, as would falling one row at a time. A fall delay of 0 falls
+     * down to the field and releases the blocks on the next call.
      * @param dt Movement time.
      * @return `true` if the tetrimino reached a field block beneath and was released
      *     or if the tetrimino has not been spawned before.
@@ -158,6 +188,9 @@ public:
     /// Get the current tetrimino config.
     TetriminoConfig get_config() const;
 
+    /// Mix the placement and movement state into `hash`. @see hash_combine
+    Uint32 get_checksum(Uint32 hash) const;
+
 private:
     /// Blocks per second side movement speed.
     static constexpr int TETRIMINO_SIDE_SPEED = 7;
@@ -171,8 +204,8 @@ private:
     static std::vector<SDL_Rect> blockClips; /// The texture sheet clips.
 
     /**
-     * @brief Shift the tetrimino by `dx` if it does not cause a field collision.
-     * @note Might move the tetrimino through blocks if `dx` is large enough.
+     * @brief Shift the tetrimino by `dx` columns, stopping before the first column
+     *     which causes a field collision.
      */
     void shift(int dx);
 
@@ -182,6 +215,15 @@ private:
      */
     void drop();
 
+    /// Get the amount of rows the tetrimino can fall before reaching the field.
+    int get_free_rows() const;
+
+    /**
+     * @brief Start the elapsed time of velocity `vel` at `late` ms, if a key press
+     *     just started it with `speed`.
+     */
+    static void credit_late(int vel, int speed, int &elapsed, Uint32 late);
+
     /// `true` if the tetrimino was rotated by `dir` after shifting by `dx`, `dy`.
     bool check_adjacent(int dir, int dx, int dy);
 
@@ -221,6 +263,12 @@ private:
 
     /// Schemes for all rotations for the current type.
     std::vector<Scheme> *rotations;
+
+    /// Ghost row found from rows `ghostFromY` to `ghostY`, cleared by spawning.
+    bool ghostValid = false;
+    int ghostPosX, ghostFromY, ghostY;
+    TetriminoRotation ghostRot;
+    Uint32 ghostVersion; /// Field version the ghost was found for.
 };
 
 /// A struct for easy storage of a tetrimino type and rotation.
@@ -231,9 +279,16 @@ struct TetriminoConfig
 
     /// Create a config with given parameters.
     TetriminoConfig(Tetrimino::TetriminoType type, Tetrimino::TetriminoRotation rot);
+
+    /// Seed the generator of random configs, so that games can be replayed.
+    static void seed(Uint32 seed);
     
     Tetrimino::TetriminoType type;
     Tetrimino::TetriminoRotation rot;
+
+private:
+    // Unlike `rand()`, its sequence is the same on every platform
+    static std::mt19937 rng;
 };
 
 
@@ -4,7 +4,13 @@
  */
 
 #include "tetris_field.hpp"
+#include "trace.hpp"
+#include "util.hpp"
 #include "logger.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
 
 
 Block::Block (Texture *blockTextureSheet, const SDL_Rect *clip)
@@ -12,11 +18,22 @@ Block::Block (Texture *blockTextureSheet, const SDL_Rect *clip)
     , clip(clip)
 {}
 
-void Block::render (int x, int y, int size)
+void Block::render (int x, int y, int size) const
 {
     blockTextureSheet->render({x, y, size, size}, clip);
 }
 
+bool Block::is_empty () const
+{
+    return blockTextureSheet == nullptr;
+}
+
+
+TetrisField::Snapshot::Snapshot ()
+{
+    clearedLines.reserve(MAX_SCHEME_LEN + 1);
+}
+
 
 void TetrisField::init (
     int cellsHor, int cellsVer,
@@ -24,12 +41,40 @@ void TetrisField::init (
     Texture *particleTextureSheet
 )
 {
-    log("Initializing TetrisField", __FILE__, __LINE__);
+    LOG_INFO("Initializing TetrisField");
+
+    if (cellsVer > 32)
+    {
+        throw ExceptionLogic(
+            __FILE__, __LINE__, "TetrisField columns have to fit 32 bit masks"
+        );
+    }
     
     field = std::vector<std::vector<Block *>>(
         cellsVer, std::vector<Block *>(cellsHor, nullptr)
     );
+    columns.assign(cellsHor, 0);
+    clearedLines.reserve(MAX_SCHEME_LEN + 1);
     clearedLines = {-1};
+    renderedLines.reserve(MAX_SCHEME_LEN + 1);
+    renderedLines = {-1};
+    // Never reset, so that snapshots of previous games are never taken as current
+    renderedVersion = version++;
+
+    blockPool = std::vector<Block>(
+        cellsHor * cellsVer + MAX_SCHEME_LEN * MAX_SCHEME_LEN, Block(nullptr, nullptr)
+    );
+    freeBlocks.resize(0);
+    for (Block &block : blockPool)
+    {
+        freeBlocks.push_back(&block);
+    }
+
+    // A tetrimino can not clear more lines than its scheme has rows
+    clearLineParticles.init(
+        MAX_SCHEME_LEN, CLEAR_LINE_PARTICLES_MAX, CLEAR_LINE_PARTICLE_LIFESPAN,
+        CLEAR_LINE_PARTICLE_SHIFT_MAX, particleTextureSheet
+    );
 
     this->cellsHor = cellsHor;
     this->cellsVer = cellsVer;
@@ -41,98 +86,88 @@ void TetrisField::init (
 
 void TetrisField::free()
 {
-    log("Freeing TetrisField", __FILE__, __LINE__);
+    LOG_INFO("Freeing TetrisField");
     
+    field.clear();
+    columns.clear();
+    freeBlocks.clear();
+    blockPool.clear();
+    clearLineParticles.free();
+    cache.free();
+}
+
+void TetrisField::take_snapshot (Snapshot &snapshot) const
+{
+    if (
+        snapshot.version == version
+        && snapshot.cells.size() == size_t(cellsHor * cellsVer)
+    )
+    {
+        return;
+    }
+    snapshot.cells.resize(cellsHor * cellsVer);
     for (int row = 0; row < cellsVer; ++row)
     {
         for (int col = 0; col < cellsHor; ++col)
         {
-            if (field[row][col] != nullptr)
-            {
-                delete field[row][col];
-            }
+            const Block *block = field[row][col];
+            snapshot.cells[row * cellsHor + col] = block ? *block : Block();
         }
     }
+    snapshot.clearedLines = clearedLines;
+    snapshot.version = version;
+    snapshot.checksum = get_checksum();
 }
 
 void TetrisField::render (
-    int x, int y, int w, int h, Tetrimino &tetrimino, bool stopClearLineRender
+    int x, int y, int w, int h, const Snapshot &snapshot,
+    const TetriminoView &tetrimino, Uint32 clearLineElapsed
 )
 {
-    frameTexture->render({x, y, w, h});
-
-    int size = min(w / cellsHor, h / cellsVer); // Block size
-    int fieldX = x + (w - size * cellsHor) / 2; // Grid x coordinate
-    int fieldY = y + (h - size * cellsVer) / 2; // Grid y coordinate
+    TRACE_ZONE("TetrisField::render");
 
-    int shift = 0; // Amount of rendered clear lines
-
-    // row represents the actual row, row - shift represents the row being rendered
-    for (int row = cellsVer - 1; row - shift >= 0; --row)
+    bool stopClearLineRender = clearLineElapsed >= CLEAR_LINE_RENDER_TIME;
+    if (snapshot.version != renderedVersion)
     {
-        if (clearedLines[shift] == row - shift)
-        {
-            // If the row to be rendered was cleared, render the clear row texture
-            // instead and go back to the actual row on the next iteration
-            clearTexture->render(
-                {fieldX, fieldY + (row - shift) * size, size * cellsHor, size}
-            );
-            ++shift;
-            ++row;
-
-            // Add new particlers for newly appeared cleared rows
-            if (clearLineParticlers.size() < shift)
-            {
-                clearLineParticlers.push_back(new ParticleEmmiter(
-                    CLEAR_LINE_PARTICLES_MAX, CLEAR_LINE_PARTICLE_LIFESPAN,
-                    CLEAR_LINE_PARTICLE_SHIFT_MAX, particleTextureSheet
-                ));
-            }
-        }
-        else
+        renderedVersion = snapshot.version;
+        if (snapshot.clearedLines != renderedLines)
         {
-            // Render an actual row risen by the amount of cleared lines bellow
-            for (int col = 0; col < cellsHor; ++col)
-            {
-                if (field[row][col] != nullptr)
-                {
-                    field[row][col]->render(
-                        fieldX + col * size, fieldY + (row - shift) * size, size
-                    );
-                }
-                else
-                {
-                    bgTexture->render(
-                        {
-                            fieldX + col * size, fieldY + (row - shift) * size,
-                            size, size
-                        }
-                    );
-                }
-            }
+            // The particles follow the new lines, which `render_cache` emits again
+            renderedLines = snapshot.clearedLines;
+            clearLineParticles.clear();
         }
+        cache.invalidate();
     }
-
-    tetrimino.render(fieldX, fieldY, size);
-
+    // Checked before drawing, as blocks added later bring back the last clear
     if (stopClearLineRender)
     {
-        clearedLines = {-1};
-        for (ParticleEmmiter *&particler : clearLineParticlers)
+        if (renderedLines.front() != -1)
         {
-            delete particler;
+            cache.invalidate();
         }
-        clearLineParticlers.resize(0);
+        renderedLines = {-1};
+        clearLineParticles.clear();
     }
-    else
+
+    if (cache.begin(*frameTexture->get_renderer(), {x, y, w, h}))
     {
-        for (int i = 0; i < clearLineParticlers.size(); ++i)
-        {
-            clearLineParticlers[i]->render(
-                fieldX, fieldY + clearedLines[i] * size, size * cellsHor, size, 
-                size / 2
-            );
-        }
+        render_cache(w, h, snapshot);
+        cache.end();
+    }
+    cache.render();
+
+    int size = min(w / cellsHor, h / cellsVer); // Block size
+    int fieldX = x + (w - size * cellsHor) / 2; // Grid x coordinate
+    int fieldY = y + (h - size * cellsVer) / 2; // Grid y coordinate
+
+    Tetrimino::render_view(tetrimino, fieldX, fieldY, size);
+
+    if (!stopClearLineRender)
+    {
+        clearLineParticles.update(clearLineElapsed);
+        clearLineParticles.render(
+            fieldX, fieldY, size * cellsHor, size, renderedLines, size / 2
+        );
     }
 }
 
@@ -151,9 +186,59 @@ int TetrisField::get_height () const
     return cellsVer;
 }
 
+Uint32 TetrisField::get_version () const
+{
+    return version;
+}
+
+Uint32 TetrisField::get_checksum () const
+{
+    // Rows are hashed as occupancy bit masks, which fit fields up to 32 cells wide
+    Uint32 hash = HASH_SEED;
+    for (const std::vector<Block *> &row : field)
+    {
+        Uint32 mask = 0;
+        for (const Block *block : row)
+        {
+            mask = mask << 1 | (block != nullptr);
+        }
+        hash = hash_combine(hash, mask);
+    }
+    return hash;
+}
+
+int TetrisField::get_free_below (int posX, int posY) const
+{
+    // The highest block bit below the cell is the closest block. Cells above the
+    // field have every row below them, which shifting by 32 or more can not mask
+    int bit = cellsVer - 1 - posY;
+    Uint32 mask = bit >= 32 ? ~Uint32(0) : (Uint32(1) << bit) - 1;
+    Uint32 below = columns[posX] & mask;
+    return bit - 1 - SDL_MostSignificantBitIndex32(below);
+}
+
 void TetrisField::add_block (int posX, int posY, Block *block)
 {
     field[posY][posX] = block;
+    columns[posX] |= Uint32(1) << (cellsVer - 1 - posY);
+    ++version;
+}
+
+Block *TetrisField::create_block (Texture *blockTextureSheet, const SDL_Rect *clip)
+{
+    if (freeBlocks.empty())
+    {
+        throw ExceptionLogic(__FILE__, __LINE__, "TetrisField block pool exhausted");
+    }
+    Block *block = freeBlocks.back();
+    freeBlocks.pop_back();
+    *block = Block(blockTextureSheet, clip);
+    return block;
+}
+
+void TetrisField::destroy_block (Block *block)
+{
+    freeBlocks.push_back(block);
 }
 
 int TetrisField::clear_lines ()
@@ -179,7 +264,7 @@ int TetrisField::clear_lines ()
         {
             for (int col = 0; col < cellsHor; ++col)
             {
-                delete field[row][col];
+                destroy_block(field[row][col]);
             }
             ++shift;
             ++row;
@@ -190,9 +275,76 @@ int TetrisField::clear_lines ()
     // Empty the upper rows
     for (int row = 0; row < shift; ++row)
     {
-        field[row] = std::vector<Block *>(cellsHor, nullptr);
+        std::fill(field[row].begin(), field[row].end(), nullptr);
+    }
+    if (shift)
+    {
+        for (int col = 0; col < cellsHor; ++col)
+        {
+            columns[col] = 0;
+            for (int row = 0; row < cellsVer; ++row)
+            {
+                columns[col] = columns[col] << 1 | (field[row][col] != nullptr);
+            }
+        }
     }
     clearedLines.push_back(-1);
+    ++version;
 
     return shift;
 }
+
+void TetrisField::render_cache (int w, int h, const Snapshot &snapshot)
+{
+    frameTexture->render({0, 0, w, h});
+
+    int size = min(w / cellsHor, h / cellsVer); // Block size
+    int fieldX = (w - size * cellsHor) / 2; // Grid x coordinate
+    int fieldY = (h - size * cellsVer) / 2; // Grid y coordinate
+
+    int shift = 0; // Amount of rendered clear lines
+
+    // row represents the actual row, row - shift represents the row being rendered
+    for (int row = cellsVer - 1; row - shift >= 0; --row)
+    {
+        if (renderedLines[shift] == row - shift)
+        {
+            // If the row to be rendered was cleared, render the clear row texture
+            // instead and go back to the actual row on the next iteration
+            clearTexture->render(
+                {fieldX, fieldY + (row - shift) * size, size * cellsHor, size}
+            );
+            ++shift;
+            ++row;
+
+            // Emit new particles for newly appeared cleared rows
+            if (clearLineParticles.get_lines() < shift)
+            {
+                clearLineParticles.emit();
+            }
+        }
+        else
+        {
+            // Render an actual row risen by the amount of cleared lines bellow
+            for (int col = 0; col < cellsHor; ++col)
+            {
+                const Block &block = snapshot.cells[row * cellsHor + col];
+                if (!block.is_empty())
+                {
+                    block.render(
+                        fieldX + col * size, fieldY + (row - shift) * size, size
+                    );
+                }
+                else
+                {
+                    bgTexture->render(
+                        {
+                            fieldX + col * size, fieldY + (row - shift) * size,
+                            size, size
+                        }
+                    );
+                }
+            }
+        }
+    }
+}
@@ -8,6 +8,7 @@
 
 
 #include "texture.hpp"
+#include "render_cache.hpp"
 #include "tetrimino.hpp"
 #include "particles.hpp"
 
@@ -17,6 +18,7 @@
 
 
 class Tetrimino;
+struct TetriminoView;
 
 /// A tetrimino block class.
 class Block
@@ -24,10 +26,11 @@ class Block
 public:
     /**
      * @brief Initialize class members.
-     * @param blockTextureSheet A block textures sheet.
+     * @param blockTextureSheet A block textures sheet; by default, the block is
+     *     empty.
      * @param clip A clip from `blockTextureSheet` to use as the block's texture.
      */
-    Block(Texture *blockTextureSheet, const SDL_Rect *clip);
+    Block(Texture *blockTextureSheet=nullptr, const SDL_Rect *clip=nullptr);
 
     /**
      * @brief Draw the block with given location and dimensions.
@@ -35,7 +38,10 @@ public:
      * @param y Upper left corner y coordinate.
      * @param size Block size.
      */
-    void render(int x, int y, int size);
+    void render(int x, int y, int size) const;
+
+    /// `true` if the block has no texture sheet, e.g. an empty snapshot cell.
+    bool is_empty() const;
 
 private:
     Texture *blockTextureSheet;
@@ -45,16 +51,31 @@ private:
 /// A tetrimino block grid
 class TetrisField
 {
+    friend class EngineBench; // Benchmarks private hot paths (see bench/)
+
 public:
+    /// A copy of the field contents for rendering them on another thread.
+    struct Snapshot
+    {
+        std::vector<Block> cells; // Row by row; empty blocks are empty cells.
+        std::vector<int> clearedLines; // Of the last clear, `-1` terminated.
+        Uint32 version = 0; // Changes whenever blocks are added or lines cleared.
+        Uint32 checksum = 0; // See `get_checksum()`.
+
+        /// Reserve the cleared lines, so that taking snapshots does not allocate.
+        Snapshot();
+    };
+
     /**
      * @brief Create an empty field.
      * @param cellsHor Amount of cells in each row.
-     * @param cellsVer Amount of cells in each column.
+     * @param cellsVer Amount of cells in each column, up to 32.
      * @param bgTexture Empty cell texture.
      * @param frameTexture Texture to render behind the field (see `render()`).
      * @param clearTexture Texture to use for cleared rows.
      * @param particleTextureSheet Particle texture sheet to use for cleared row
      *     particles.
+     * @throws `ExceptionLogic` thrown if `cellsVer` is over 32.
      */
     void init(
         int cellsHor, int cellsVer,
@@ -62,26 +83,43 @@ public:
         Texture *particleTextureSheet
     );
 
-    /// Free all blocks.
+    /// Free the blocks, the particles and the cache.
     void free();
 
     /**
-     * @brief Render the field and a `tetrimino` with given parameters.
+     * @brief Copy the field contents to `snapshot`.
+     * @details
+     * The cells are only copied if the field changed since `snapshot` was taken.
+     * @note Does not allocate once `snapshot` holds a field of the same size.
+     */
+    void take_snapshot(Snapshot &snapshot) const;
+
+    /**
+     * @brief Render a `snapshot` of the field and a `tetrimino` with given
+     *     parameters.
      * @details
      * `frameTexture` is rendered to the entire rectangle defined by `x`, `y`, `w`,
      * `h`. The grid is centered and rendered above it with size calculated to fit
      * into both `w` and `h`. If `w`/`h` = `cellsHor`/`cellsVer`, the grid will fill
      * out the entire rectangle.
+     *
+     * The frame, the cells and the cleared rows are cached and only redrawn after
+     * the `snapshot` version or the size changed. Cleared rows are rendered for
+     * `CLEAR_LINE_RENDER_TIME` ms after the clear.
+     * @note Only touches rendering state, so it can run while another thread
+     *     changes the field.
      * @param x Upper left corner x coordinate.
      * @param y Upper left corner y coordinate.
      * @param w The width.
      * @param h The height.
+     * @param snapshot Field contents to render.
      * @param tetrimino Tetrimino to render.
-     * @param stopClearLineRender If `true` and a cleared line is being rendered,
-     *     stops rendering the cleared line.
+     * @param clearLineElapsed Time since the last line clear, which also drives
+     *     the clear line particles.
      */
     void render(
-        int x, int y, int w, int h, Tetrimino &tetrimino, bool stopClearLineRender
+        int x, int y, int w, int h, const Snapshot &snapshot,
+        const TetriminoView &tetrimino, Uint32 clearLineElapsed
     );
 
     /// `true` if the field has a block in column `posX`, row `posY`.
@@ -93,9 +131,38 @@ public:
     /// Get the amount of cells in each column.
     int get_height() const;
 
+    /// Get a checksum of the occupied cells.
+    Uint32 get_checksum() const;
+
+    /// Get a number which changes whenever blocks are added or lines cleared.
+    Uint32 get_version() const;
+
+    /**
+     * @brief Get the amount of empty cells directly below column `posX`, row
+     *     `posY`, down to the first block or the bottom.
+     * @details
+     * Looks the closest block up in the occupancy mask of the column, so it costs
+     * the same however far the cells go. `posY` can be above the field.
+     */
+    int get_free_below(int posX, int posY) const;
+
     /// Store a `block` in column `posX`, row `posY`.
     void add_block(int posX, int posY, Block *block);
 
+    /**
+     * @brief Take a block from the pool of the field.
+     * @details
+     * The pool holds enough blocks to fill the field and a tetrimino, so that
+     * spawning and clearing do not allocate.
+     * @param blockTextureSheet A block textures sheet.
+     * @param clip A clip from `blockTextureSheet` to use as the block's texture.
+     * @throws `ExceptionLogic` thrown if the pool is exhausted.
+     */
+    Block *create_block(Texture *blockTextureSheet, const SDL_Rect *clip);
+
+    /// Return a `block` taken by `create_block()` to the pool.
+    void destroy_block(Block *block);
+
     /**
      * @brief Find all rows filled with blocks and remove them.
      * @return The amount of cleared lines.
@@ -103,13 +170,24 @@ public:
     int clear_lines();
 
 private:
+    /// Draw the frame, the `snapshot` cells and the cleared rows to a `w`x`h` cache.
+    void render_cache(int w, int h, const Snapshot &snapshot);
+
     Texture *bgTexture, *frameTexture, *clearTexture, *particleTextureSheet;
-    std::vector<ParticleEmmiter *> clearLineParticlers;
+    RenderCache cache;
+    ParticlePool clearLineParticles; // A line for each cleared row.
+    Uint32 renderedVersion; // Snapshot version drawn to `cache`.
+    std::vector<int> renderedLines; // Cleared lines being rendered, like below.
     std::vector<std::vector<Block *>> field;
+    std::vector<Uint32> columns; // Occupancy masks, bit 0 is the bottom row.
+    std::vector<Block> blockPool;
+    std::vector<Block *> freeBlocks; // Blocks of `blockPool` not in use.
     int cellsHor, cellsVer;
 
     /// Cleared line indeces. `-1` is always stored as the last element.
     std::vector<int> clearedLines;
+    /// Changes whenever blocks are added, lines cleared or the field initialized.
+    Uint32 version = 0;
 };
 
 
@@ -4,11 +4,33 @@
  */
 
 #include "tetris_layout.hpp"
+#include "trace.hpp"
 #include "game.hpp"
 #include "audio.hpp"
 #include "key_layout.hpp"
 #include "constants.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
+
+#include <cstdio>
+
+
+/// Message and its color for clearing 1 to 4 lines at once.
+static const struct
+{
+    const char *text;
+    const Color *color;
+} CLEAR_MESSAGES[] = {
+    {"Line clear", &WHITE},
+    {"2 lines cleared!", &CYAN},
+    {"3 lines cleared!", &YELLOW},
+    {"TETRIS!", &RED},
+};
+
+TetrisLayout::Snapshot::Snapshot ()
+{
+    queue.reserve(TETRIMINO_QUEUE_LEN + 1);
+}
 
 
 void TetrisLayout::init (
@@ -23,7 +45,7 @@ void TetrisLayout::init (
     Text *scoreText, Text *scorePromptText,
     Text *highScoreText, Text *highScorePromptText,
     Text *msgText, Text *comboText,
-    Layout layout
+    Layout layout, int player
 )
 {
     field.init(
@@ -35,19 +57,28 @@ void TetrisLayout::init (
 
     tetrimino.init(&field, blockTextureSheet, tetriminoKeyLayout);
 
+    // Swapping the first time adds a config before spawning takes one
+    tetriminoQueue.reserve(TETRIMINO_QUEUE_LEN + 1);
     for (int i = 0; i < TETRIMINO_QUEUE_LEN; ++i)
     {
         tetriminoQueue.push_back(TetriminoConfig());
     }
-    tetriminoSwap = nullptr;
+    hasSwap = false;
     trySwap = false;
     swapped = 0;
+    spawns = swaps = 0;
+    messages = messageLines = 0;
 
     tetriminoFallDelay = TETRIMINO_INITIAL_FALL_DELAY;
 
     gameOver = false;
+    caughtUp = 0;
 
     linesCleared = score = combo = 0;
+    linesClearedCounter = &Metrics::counter(
+        "tetris_lines_cleared_total", "Lines cleared.",
+        "player=\"" + std::to_string(player) + "\""
+    );
 
     keyLayout = tetrisKeyLayout;
     this->bgTexture = bgTexture;
@@ -63,17 +94,35 @@ void TetrisLayout::init (
     this->clearLineTimer = clearLineTimer;
     this->gameOverTimer = gameOverTimer;
     this->layout = layout;
+    renderW = renderH = 0; // Draws the caches on the first render
+    shownSpawns = shownSwaps = 0;
+    shownScore = shownCombo = shownLinesCleared = shownMessages = 0;
+
+    take_snapshot(snapshots.get_write());
+    snapshots.fill();
 }
 
 void TetrisLayout::free ()
 {
-    field.free();
+    // The tetrimino returns its blocks to the field
     tetrimino.free();
+    field.free();
     tetriminoQueue.resize(0);
+    for (RenderCache *cache : {&queueCache, &swapCache, &promptsCache})
+    {
+        cache->free();
+    }
 }
 
 void TetrisLayout::handle_event (Game &game, const SDL_Event &e)
 {
+    TRACE_ZONE("TetrisLayout::handle_event");
+
+    Uint32 late = 0;
+    if (!gameOver && e.common.timestamp && !game.is_paused())
+    {
+        late = catch_up(e.common.timestamp);
+    }
     if (gameOver)
     {
         return;
@@ -82,7 +131,7 @@ void TetrisLayout::handle_event (Game &game, const SDL_Event &e)
     // Only handle current tetrimino event if it is not being swapped
     if (!trySwap)
     {
-        tetrimino.handle_event(game, e);
+        tetrimino.handle_event(game, e, late);
     }
 
     if (!game.is_paused())
@@ -102,14 +151,23 @@ void TetrisLayout::handle_event (Game &game, const SDL_Event &e)
 }
 
 void TetrisLayout::do_logic ()
+{
+    TRACE_ZONE("TetrisLayout::do_logic");
+
+    Uint32 elapsed = tetriminoTimer->lap();
+    advance(elapsed > caughtUp ? elapsed - caughtUp : 0);
+    caughtUp = 0;
+}
+
+void TetrisLayout::advance (Uint32 dt)
 {
     if (trySwap)
     {
         swap();
         trySwap = false;
     }
-    tetrimino.move(tetriminoTimer->get_elapsed());
-    if (tetrimino.fall(tetriminoTimer->get_elapsed()))
+    tetrimino.move(dt);
+    if (tetrimino.fall(dt))
     {
         int currLinesCleared = field.clear_lines();
         if (currLinesCleared)
@@ -125,23 +183,82 @@ void TetrisLayout::do_logic ()
 
         spawn_tetrimino();
     }
-    tetriminoTimer->start();
+}
+
+Uint32 TetrisLayout::catch_up (Uint32 timestamp)
+{
+    // The age of the event maps it onto the time of `tetriminoTimer`. Events are
+    // usually pumped once a frame and ticks lap the timer more often, so most
+    // happened before the current tick started
+    Uint32 now = Timer::get_ticks();
+    Uint32 age = SDL_TICKS_PASSED(now, timestamp) ? now - timestamp : 0;
+    Uint32 elapsed = tetriminoTimer->get_elapsed();
+    if (age >= elapsed)
+    {
+        return age - elapsed;
+    }
+    Uint32 at = elapsed - age;
+    if (at > caughtUp)
+    {
+        advance(at - caughtUp);
+        caughtUp = at;
+    }
+    return 0;
+}
+
+Uint32 TetrisLayout::publish ()
+{
+    TRACE_ZONE("TetrisLayout::publish");
+
+    Snapshot &snapshot = snapshots.get_write();
+    take_snapshot(snapshot);
+
+    Uint32 checksum = snapshot.checksum;
+
+    snapshots.publish();
+    return checksum;
+}
+
+bool TetrisLayout::update_snapshot ()
+{
+    return snapshots.update();
+}
+
+const TetrisLayout::Snapshot &TetrisLayout::get_snapshot () const
+{
+    return snapshots.get_read();
 }
 
 void TetrisLayout::render (int x, int y, int w, int h)
 {
+    TRACE_ZONE("TetrisLayout::render");
+
+    update_snapshot();
+    const Snapshot &snapshot = get_snapshot();
+    update_render_state(snapshot);
+
     bgTexture->render({x, y, w, h});
 
+    if (w != renderW || h != renderH)
+    {
+        for (RenderCache *cache : {&queueCache, &swapCache, &promptsCache})
+        {
+            cache->invalidate();
+        }
+        renderW = w;
+        renderH = h;
+    }
+
     switch (layout)
     {
     case FULL:
-        render_full(x, y, w, h);
+        render_full(snapshot, x, y, w, h);
         break;
     case REDUCED:
-        render_reduced(x, y, w, h);
+        render_reduced(snapshot, x, y, w, h);
         break;
     case MINIMAL:
-        render_minimal(x, y, w, h);
+        render_minimal(snapshot, x, y, w, h);
         break;
     }
 }
@@ -156,48 +273,151 @@ int TetrisLayout::get_score () const
     return score;
 }
 
-void TetrisLayout::render_full (int x, int y, int w, int h)
+Uint32 TetrisLayout::get_checksum () const
+{
+    return get_checksum(field.get_checksum());
+}
+
+Uint32 TetrisLayout::get_checksum (Uint32 fieldChecksum) const
+{
+    Uint32 hash = tetrimino.get_checksum(fieldChecksum);
+    for (const TetriminoConfig &config : tetriminoQueue)
+    {
+        hash = hash_combine(hash, config.type << 8 | config.rot);
+    }
+    hash = hash_combine(hash, hasSwap ? tetriminoSwap.type : -1);
+    for (int value : {score, combo, linesCleared, swapped, gameOver})
+    {
+        hash = hash_combine(hash, value);
+    }
+    return hash;
+}
+
+void TetrisLayout::take_snapshot (Snapshot &snapshot)
+{
+    field.take_snapshot(snapshot.field);
+    tetrimino.take_view(snapshot.tetrimino);
+    snapshot.queue = tetriminoQueue;
+    snapshot.hasSwap = hasSwap;
+    if (hasSwap)
+    {
+        snapshot.swap = tetriminoSwap;
+    }
+    snapshot.spawns = spawns;
+    snapshot.swaps = swaps;
+    snapshot.score = score;
+    snapshot.combo = combo;
+    snapshot.linesCleared = linesCleared;
+    snapshot.messages = messages;
+    snapshot.messageLines = messageLines;
+    snapshot.clearLineElapsed = clearLineTimer->get_elapsed();
+    snapshot.gameOverElapsed = gameOverTimer->get_elapsed();
+    snapshot.gameOver = gameOver;
+    snapshot.checksum = get_checksum(snapshot.field.checksum);
+}
+
+void TetrisLayout::update_render_state (const Snapshot &snapshot)
+{
+    if (snapshot.spawns != shownSpawns)
+    {
+        queueCache.invalidate();
+        shownSpawns = snapshot.spawns;
+    }
+    if (snapshot.swaps != shownSwaps)
+    {
+        swapCache.invalidate();
+        shownSwaps = snapshot.swaps;
+    }
+
+    // Formatted on the stack, as building strings would allocate every clear
+    char buf[32];
+    if (snapshot.score != shownScore)
+    {
+        int len = snprintf(buf, sizeof(buf), "%09d", snapshot.score);
+        scoreText->set_text(std::string_view(buf, len));
+        shownScore = snapshot.score;
+    }
+    if (snapshot.combo != shownCombo)
+    {
+        int len = snprintf(buf, sizeof(buf), "Combo: %d", snapshot.combo);
+        comboText->set_text(std::string_view(buf, len));
+        shownCombo = snapshot.combo;
+    }
+    if (snapshot.linesCleared != shownLinesCleared)
+    {
+        int len = snprintf(buf, sizeof(buf), "%04d", snapshot.linesCleared);
+        linesClearedText->set_text(std::string_view(buf, len));
+        shownLinesCleared = snapshot.linesCleared;
+    }
+    if (snapshot.messages != shownMessages)
+    {
+        const auto &message = CLEAR_MESSAGES[snapshot.messageLines - 1];
+        msg.set_text(message.text, TETRIS_MSG_TIME, message.color);
+        shownMessages = snapshot.messages;
+    }
+}
+
+void TetrisLayout::render_full (
+    const Snapshot &snapshot, int x, int y, int w, int h
+)
 {
     int fieldW = w / 3, fieldH = 3 * h / 4;
     int fieldX = x + (w - fieldW) / 2, fieldY = y + (h - fieldH) / 2;
     int blockSize = min(fieldW / field.get_width(), fieldH / field.get_height());
 
     // Render the tetrimino queue
-    for (int i = 0; i < tetriminoQueue.size(); ++i)
+    SDL_Point queuePositions[TETRIMINO_QUEUE_LEN + 1];
+    for (int i = 0; i < snapshot.queue.size(); ++i)
     {
-        Tetrimino::render_config(
-            tetriminoQueue[i],
+        queuePositions[i] = {
             fieldX + fieldW + blockSize,
-            fieldY + i * (MAX_SCHEME_LEN + 1) * blockSize / 2,
-            blockSize / 2,
-            blockTextureSheet
-        );
+            fieldY + i * (MAX_SCHEME_LEN + 1) * blockSize / 2
+        };
     }
+    render_queue(snapshot.queue, queuePositions, blockSize / 2);
     // Render the swap tetrimino
-    if (tetriminoSwap != nullptr)
-    {
-        Tetrimino::render_config(
-            *tetriminoSwap,
-            fieldX - (MAX_SCHEME_LEN + 1) * blockSize,
-            fieldY,
-            blockSize,
-            blockTextureSheet
-        );
-    }
+    render_swap(
+        snapshot, fieldX - (MAX_SCHEME_LEN + 1) * blockSize, fieldY, blockSize
+    );
 
     int promptW = blockSize * 9, promptH = blockSize;
     int promptSpace = promptH / 2;
     int promptX = fieldX - blockSize - promptW;
+    int linesY = fieldY + (MAX_SCHEME_LEN + 1) * blockSize;
+    int scoreBottomY = fieldY + fieldH;
+
+    // Render the prompts of the cleared lines and score info
+    Prompt prompts[] = {
+        {
+            linesClearedPromptText,
+            {promptX, linesY, promptW, promptH},
+            Text::TextAlign::TEXT_CENTER_LEFT
+        },
+        {
+            scorePromptText,
+            {
+                promptX,
+                scoreBottomY - 3 * promptH - 3 * promptSpace - promptSpace - promptH,
+                promptW,
+                promptH
+            },
+            Text::TextAlign::TEXT_CENTER_LEFT
+        },
+        {
+            highScorePromptText,
+            {
+                promptX,
+                scoreBottomY - promptH - promptSpace - promptH,
+                promptW,
+                promptH
+            },
+            Text::TextAlign::TEXT_CENTER_LEFT
+        },
+    };
+    bool hasHighScore = highScorePromptText != nullptr && highScoreText != nullptr;
+    render_prompts(prompts, hasHighScore ? 3 : 2);
 
     // Render cleared lines info under the swap tetrimino
-    int linesY = fieldY + (MAX_SCHEME_LEN + 1) * blockSize;
-    linesClearedPromptText->render(
-        promptX,
-        linesY,
-        promptW,
-        promptH,
-        Text::TextAlign::TEXT_CENTER_LEFT
-    );
     linesClearedText->render(
         promptX,
         linesY + promptSpace + promptH,
@@ -207,14 +427,6 @@ void TetrisLayout::render_full (int x, int y, int w, int h)
     );
 
     // Render score info adjacent to the field bottom
-    int scoreBottomY = fieldY + fieldH;
-    scorePromptText->render(
-        promptX,
-        scoreBottomY - 3 * promptH - 3 * promptSpace - promptSpace - promptH,
-        promptW,
-        promptH,
-        Text::TextAlign::TEXT_CENTER_LEFT
-    );
     scoreText->render(
         promptX,
         scoreBottomY - 2 * promptH - promptSpace - 2 * promptSpace - promptH,
@@ -222,15 +434,8 @@ void TetrisLayout::render_full (int x, int y, int w, int h)
         promptH,
         Text::TextAlign::TEXT_CENTER_RIGHT
     );
-    if (highScorePromptText != nullptr && highScoreText != nullptr)
+    if (hasHighScore)
     {
-        highScorePromptText->render(
-            promptX,
-            scoreBottomY - promptH - promptSpace - promptH,
-            promptW,
-            promptH,
-            Text::TextAlign::TEXT_CENTER_LEFT
-        );
         highScoreText->render(
             promptX,
             scoreBottomY - promptH,
@@ -262,58 +467,66 @@ void TetrisLayout::render_full (int x, int y, int w, int h)
         msgH
     );
 
-    field.render(
-        fieldX, fieldY, fieldW, fieldH,
-        tetrimino, clearLineTimer->get_elapsed() >= CLEAR_LINE_RENDER_TIME
-    );
+    render_field(snapshot, fieldX, fieldY, fieldW, fieldH);
 }
 
-void TetrisLayout::render_reduced (int x, int y, int w, int h)
+void TetrisLayout::render_reduced (
+    const Snapshot &snapshot, int x, int y, int w, int h
+)
 {
     int fieldW = w / 2, fieldH = 3 * h / 4;
     int fieldX = x + w / 12, fieldY = y + (h - fieldH) / 2;
     int blockSize = min(fieldW / field.get_width(), fieldH / field.get_height());
 
     // Render the swap tetrimino
-    if (tetriminoSwap != nullptr)
-    {
-        Tetrimino::render_config(
-            *tetriminoSwap,
-            fieldX + fieldW + blockSize,
-            fieldY,
-            blockSize,
-            blockTextureSheet
-        );
-    }
+    render_swap(snapshot, fieldX + fieldW + blockSize, fieldY, blockSize);
     // Render the tetrimino queue
     int queueBegX = fieldX + fieldW + 3 * blockSize / 4;
     int queueBegY = fieldY + (MAX_SCHEME_LEN + 1) * blockSize;
-    int firstColRows = tetriminoQueue.size() / 2 + tetriminoQueue.size() % 2;
-    for (int i = 0; i < tetriminoQueue.size(); ++i)
+    int firstColRows = snapshot.queue.size() / 2 + snapshot.queue.size() % 2;
+    SDL_Point queuePositions[TETRIMINO_QUEUE_LEN + 1];
+    for (int i = 0; i < snapshot.queue.size(); ++i)
     {
         int col = i >= firstColRows;
         int row = i - col * firstColRows;
-        Tetrimino::render_config(
-            tetriminoQueue[i],
+        queuePositions[i] = {
             queueBegX + col * (MAX_SCHEME_LEN + 1) * blockSize / 2,
-            queueBegY + row * (MAX_SCHEME_LEN + 1) * blockSize / 2,
-            blockSize / 2,
-            blockTextureSheet
-        );
+            queueBegY + row * (MAX_SCHEME_LEN + 1) * blockSize / 2
+        };
     }
+    render_queue(snapshot.queue, queuePositions, blockSize / 2);
 
-    // Render score and lines cleared info adjacent to the field bottom
     int promptW = blockSize * 9, promptH = blockSize;
     int promptSpace = promptH / 2;
     int promptX = fieldX + fieldW + blockSize;
     int scoreBottomY = fieldY + fieldH;
-    linesClearedPromptText->render(
-        promptX,
-        scoreBottomY - 3 * promptH - 3 * promptSpace - promptSpace - promptH,
-        promptW,
-        promptH,
-        Text::TextAlign::TEXT_CENTER_LEFT
-    );
+
+    // Render the prompts of the score and lines cleared info
+    Prompt prompts[] = {
+        {
+            linesClearedPromptText,
+            {
+                promptX,
+                scoreBottomY - 3 * promptH - 3 * promptSpace - promptSpace - promptH,
+                promptW,
+                promptH
+            },
+            Text::TextAlign::TEXT_CENTER_LEFT
+        },
+        {
+            scorePromptText,
+            {
+                promptX,
+                scoreBottomY - promptH - promptSpace - promptH,
+                promptW,
+                promptH
+            },
+            Text::TextAlign::TEXT_CENTER_LEFT
+        },
+    };
+    render_prompts(prompts, 2);
+
+    // Render score and lines cleared info adjacent to the field bottom
     linesClearedText->render(
         promptX,
         scoreBottomY - 2 * promptH - promptSpace - 2 * promptSpace - promptH,
@@ -321,13 +534,6 @@ void TetrisLayout::render_reduced (int x, int y, int w, int h)
         promptH,
         Text::TextAlign::TEXT_CENTER_LEFT
     );
-    scorePromptText->render(
-        promptX,
-        scoreBottomY - promptH - promptSpace - promptH,
-        promptW,
-        promptH,
-        Text::TextAlign::TEXT_CENTER_LEFT
-    );
     scoreText->render(
         promptX,
         scoreBottomY - promptH,
@@ -358,13 +564,12 @@ void TetrisLayout::render_reduced (int x, int y, int w, int h)
         msgH
     );
 
-    field.render(
-        fieldX, fieldY, fieldW, fieldH,
-        tetrimino, clearLineTimer->get_elapsed() >= CLEAR_LINE_RENDER_TIME
-    );
+    render_field(snapshot, fieldX, fieldY, fieldW, fieldH);
 }
 
-void TetrisLayout::render_minimal (int x, int y, int w, int h)
+void TetrisLayout::render_minimal (
+    const Snapshot &snapshot, int x, int y, int w, int h
+)
 {
     int paddingHor = w / 32;
     int fieldW = 2 * w / 3, fieldH = 13 * h / 16;
@@ -372,30 +577,21 @@ void TetrisLayout::render_minimal (int x, int y, int w, int h)
     int blockSize = min(fieldW / field.get_width(), fieldH / field.get_height());
 
     // Render the swap tetrimino
-    if (tetriminoSwap != nullptr)
-    {
-        Tetrimino::render_config(
-            *tetriminoSwap,
-            fieldX + fieldW + blockSize / 2,
-            fieldY,
-            blockSize,
-            blockTextureSheet
-        );
-    }
+    render_swap(snapshot, fieldX + fieldW + blockSize / 2, fieldY, blockSize);
     // Render the tetrimino queue adjacent to the field bottom
     int queueBegX = fieldX + fieldW + blockSize / 2 + blockSize / 2;
     int queueEndY = fieldY + fieldH;
-    for (int i = 0; i < tetriminoQueue.size(); ++i)
+    SDL_Point queuePositions[TETRIMINO_QUEUE_LEN + 1];
+    for (int i = 0; i < snapshot.queue.size(); ++i)
     {
-        Tetrimino::render_config(
-            tetriminoQueue[i],
+        int fromEnd = snapshot.queue.size() - i;
+        queuePositions[i] = {
             queueBegX,
-            queueEndY - (tetriminoQueue.size() - i) * MAX_SCHEME_LEN * blockSize / 2
-                - (tetriminoQueue.size() - i - 1) * blockSize / 2,
-            blockSize / 2,
-            blockTextureSheet
-        );
+            queueEndY - fromEnd * MAX_SCHEME_LEN * blockSize / 2
+                - (fromEnd - 1) * blockSize / 2
+        };
     }
+    render_queue(snapshot.queue, queuePositions, blockSize / 2);
 
     // Render combo info above the field in the left
     int promptSpace = h / 64;
@@ -409,13 +605,12 @@ void TetrisLayout::render_minimal (int x, int y, int w, int h)
         Text::TEXT_CENTER_LEFT
     );
     // Render score info above the field in the right
-    scorePromptText->render(
-        fieldX + fieldW - promptW,
-        fieldY - promptSpace - promptH,
-        promptW,
-        promptH,
+    Prompt prompt = {
+        scorePromptText,
+        {fieldX + fieldW - promptW, fieldY - promptSpace - promptH, promptW, promptH},
         Text::TextAlign::TEXT_CENTER_RIGHT
-    );
+    };
+    render_prompts(&prompt, 1);
     scoreText->render(
         fieldX + fieldW + blockSize,
         fieldY - promptSpace - promptH,
@@ -424,14 +619,101 @@ void TetrisLayout::render_minimal (int x, int y, int w, int h)
         Text::TextAlign::TEXT_CENTER_LEFT
     );
 
+    render_field(snapshot, fieldX, fieldY, fieldW, fieldH);
+}
+
+void TetrisLayout::render_field (
+    const Snapshot &snapshot, int x, int y, int w, int h
+)
+{
     field.render(
-        fieldX, fieldY, fieldW, fieldH,
-        tetrimino, clearLineTimer->get_elapsed() >= CLEAR_LINE_RENDER_TIME
+        x, y, w, h, snapshot.field, snapshot.tetrimino, snapshot.clearLineElapsed
     );
 }
 
+void TetrisLayout::render_queue (
+    const std::vector<TetriminoConfig> &queue, const SDL_Point *positions,
+    int blockSize
+)
+{
+    if (queue.empty())
+    {
+        return;
+    }
+
+    int size = MAX_SCHEME_LEN * blockSize;
+    SDL_Rect rect = {positions[0].x, positions[0].y, size, size};
+    for (int i = 1; i < int(queue.size()); ++i)
+    {
+        SDL_Rect config = {positions[i].x, positions[i].y, size, size};
+        SDL_UnionRect(&rect, &config, &rect);
+    }
+
+    if (queueCache.begin(*blockTextureSheet->get_renderer(), rect))
+    {
+        for (int i = 0; i < int(queue.size()); ++i)
+        {
+            Tetrimino::render_config(
+                queue[i],
+                positions[i].x - rect.x,
+                positions[i].y - rect.y,
+                blockSize,
+                blockTextureSheet
+            );
+        }
+        queueCache.end();
+    }
+    queueCache.render();
+}
+
+void TetrisLayout::render_swap (const Snapshot &snapshot, int x, int y, int blockSize)
+{
+    if (!snapshot.hasSwap)
+    {
+        return;
+    }
+
+    int size = MAX_SCHEME_LEN * blockSize;
+    if (swapCache.begin(*blockTextureSheet->get_renderer(), {x, y, size, size}))
+    {
+        Tetrimino::render_config(snapshot.swap, 0, 0, blockSize, blockTextureSheet);
+        swapCache.end();
+    }
+    swapCache.render();
+}
+
+void TetrisLayout::render_prompts (const Prompt *prompts, int count)
+{
+    SDL_Rect rect = prompts[0].rect;
+    for (int i = 1; i < count; ++i)
+    {
+        SDL_UnionRect(&rect, &prompts[i].rect, &rect);
+    }
+
+    if (promptsCache.begin(*bgTexture->get_renderer(), rect))
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const SDL_Rect &textRect = prompts[i].rect;
+            prompts[i].text->render(
+                textRect.x - rect.x, textRect.y - rect.y, textRect.w, textRect.h,
+                prompts[i].align
+            );
+        }
+        promptsCache.end();
+    }
+    promptsCache.render();
+}
+
 void TetrisLayout::spawn_tetrimino ()
 {
+    TRACE_ZONE("TetrisLayout::spawn_tetrimino");
+
+    static Counter &spawned = Metrics::counter(
+        "tetris_pieces_spawned_total", "Tetrimino spawn attempts."
+    );
+    spawned.inc();
+
     bool tetriminoFit = tetrimino.spawn(
         (field.get_width() - MAX_SCHEME_LEN) / 2, 0, tetriminoFallDelay,
         tetriminoQueue.front()
@@ -444,13 +726,14 @@ void TetrisLayout::spawn_tetrimino ()
 
         Audio::play_sound(Audio::TETRIS_GAME_OVER);
     }
-    tetriminoQueue.pop_front();
+    tetriminoQueue.erase(tetriminoQueue.begin());
     // If swapped > 0, decreases it
     // If then swapped == 1, does nothing, if otherwise swapped == 0, fills the queue
     if (!swapped || !--swapped)
     {
         tetriminoQueue.push_back(TetriminoConfig());
     }
+    ++spawns;
 }
 
 void TetrisLayout::swap ()
@@ -458,11 +741,10 @@ void TetrisLayout::swap ()
     if (!swapped)
     {
         swapped = 2;
-        if (tetriminoSwap != nullptr)
+        if (hasSwap)
         {
             // If there were swaps, put the current tetrimino to the queue front
-            tetriminoQueue.push_front(*tetriminoSwap);
-            delete tetriminoSwap;
+            tetriminoQueue.insert(tetriminoQueue.begin(), tetriminoSwap);
         }
         else
         {
@@ -470,7 +752,9 @@ void TetrisLayout::swap ()
             tetriminoQueue.push_back(TetriminoConfig());
         }
         // Move the current tetrimino to the swap buffer
-        tetriminoSwap = new TetriminoConfig(tetrimino.get_config());
+        tetriminoSwap = tetrimino.get_config();
+        hasSwap = true;
+        ++swaps;
         tetrimino.free();
 
         // Spawn a new tetrimino
@@ -485,42 +769,31 @@ void TetrisLayout::manage_score (int currLinesCleared)
     switch (currLinesCleared)
     {
     case 0:
-        if (combo)
-        {
-            comboText->set_text("Combo: 0");
-            combo = 0;
-        }
+        combo = 0;
         break;
     case 1:
-        msg.set_text("Line clear", TETRIS_MSG_TIME, &WHITE);
-        
         Audio::play_sound(Audio::TETRIS_SINGLE);
         break;
     case 2:
-        msg.set_text("2 lines cleared!", TETRIS_MSG_TIME, &CYAN);
-        
         Audio::play_sound(Audio::TETRIS_DOUBLE);
         break;
     case 3:
-        msg.set_text("3 lines cleared!", TETRIS_MSG_TIME, &YELLOW);
-        
         Audio::play_sound(Audio::TETRIS_TRIPLE);
         break;
     case 4:
-        msg.set_text("TETRIS!", TETRIS_MSG_TIME, &RED);
-        score += SCORE_TETRIS;
+        score += TETRIS_SCORE_TETRIS;
         
         Audio::play_sound(Audio::TETRIS_TETRIS);
         break;
     }
     if (currLinesCleared)
     {
-        score += currLinesCleared * MULT_LINE + combo * MULT_COMBO;
-        scoreText->set_text(get_padded(std::to_string(score), 9, '0'));
+        linesClearedCounter->inc(currLinesCleared);
+        score += currLinesCleared * TETRIS_SCORE_LINE + combo * TETRIS_SCORE_COMBO;
+        ++combo;
+        linesCleared += currLinesCleared;
 
-        comboText->set_text("Combo: " + std::to_string(++combo));
-        linesClearedText->set_text(
-            get_padded(std::to_string(linesCleared += currLinesCleared), 4, '0')
-        );
+        messageLines = currLinesCleared;
+        ++messages;
     }
 }
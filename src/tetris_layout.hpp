@@ -10,20 +10,32 @@
 #include "tetris_field.hpp"
 #include "tetrimino.hpp"
 #include "texture.hpp"
+#include "render_cache.hpp"
 #include "text.hpp"
 #include "timer.hpp"
 #include "timed_media.hpp"
 #include "key_layout.hpp"
+#include "triple_buffer.hpp"
 
 #include <SDL2/SDL.h>
-#include <deque>
+#include <vector>
 
 
 class KeyLayout;
+class Counter;
 
-/// A complete tetris setup class with logic, event handling and scoring.
+/**
+ * @brief A complete tetris setup class with logic, event handling and scoring.
+ * @details
+ * The logic may run on another thread than rendering: `publish()` hands a
+ * snapshot of the game to the rendering thread, and `render()` only draws the
+ * latest published snapshot and the state it owns, i.e. texts, caches, the message
+ * timer and the particles.
+ */
 class TetrisLayout
 {
+    friend class EngineBench; // Benchmarks whole gameplay frames (see bench/)
+
 public:
     /// Tetris commands.
     enum Commands{
@@ -37,6 +49,26 @@ public:
         MINIMAL, // No high score, no lines cleared, no messages.
     };
 
+    /// Everything rendering and game state transitions need from a single tick.
+    struct Snapshot
+    {
+        TetrisField::Snapshot field;
+        TetriminoView tetrimino;
+        std::vector<TetriminoConfig> queue;
+        TetriminoConfig swap{Tetrimino::TETRIMINO_I, Tetrimino::TETRIMINO_ROTATION_0};
+        bool hasSwap = false;
+        int spawns = 0, swaps = 0; // Change whenever the queue or swap changes.
+        int score = 0, combo = 0, linesCleared = 0;
+        int messages = 0; // Amount of messages, so that new ones are shown.
+        int messageLines = 0; // Lines cleared by the latest message's clear.
+        Uint32 clearLineElapsed = 0, gameOverElapsed = 0; // Timer values.
+        bool gameOver = false;
+        Uint32 checksum = 0; // See `get_checksum()`.
+
+        /// Reserve the queue, so that taking snapshots does not allocate.
+        Snapshot();
+    };
+
     /**
      * @brief Initialize class members.
      * @param cellsHor Amount of cells in each row.
@@ -64,6 +96,8 @@ public:
      * @param msgText Text to use for messages.
      * @param comboText Text to use for current combo display.
      * @param layout Controls how much is displayed; default is `FULL`.
+     * @param player Player index labeling the layout metrics.
+     * @note Publishes the initial snapshot.
      */
     void init(
         int cellsHor, int cellsVer,
@@ -77,10 +111,10 @@ public:
         Text *scoreText, Text *scorePromptText,
         Text *highScoreText, Text *highScorePromptText,
         Text *msgText, Text *comboText,
-        Layout layout=FULL
+        Layout layout=FULL, int player=0
     );
 
-    /// Free the class members.
+    /// Free the class members and the caches.
     void free();
 
     /**
@@ -88,11 +122,15 @@ public:
      * @details
      * Handles tetrimino events, and, if the game is not paused, swaps on `SWAP` key
      * press.
+     *
+     * If `e` has a timestamp and the game is not paused, the logic is first done up
+     * to the time of `e`, so that input takes effect when it happened rather than
+     * on the next `do_logic()`. E.g. auto shift then starts from the key press.
      */
     void handle_event(Game &game, const SDL_Event &e);
 
     /**
-     * @brief Do tetris logic.
+     * @brief Do tetris logic for the time passed since the last call.
      * @details
      * Moves the tetrimino. If the tetrimino fell, checks for and clears filled lines,
      * manages the score, increases tetrimino falling speed and spawns a new
@@ -101,7 +139,33 @@ public:
     void do_logic();
 
     /**
-     * @brief Render the tetrimino layout UI.
+     * @brief Publish a snapshot of the game for `render()` and `update_snapshot()`.
+     * @note Only called by the thread doing logic. Does not allocate once the
+     *     first snapshots were published.
+     * @return The checksum of the published game state, see `get_checksum()`.
+     */
+    Uint32 publish();
+
+    /**
+     * @brief Take the latest published snapshot. Only called by the rendering
+     *     thread.
+     * @return `true` if a snapshot was published since the last update.
+     */
+    bool update_snapshot();
+
+    /// Get the snapshot taken by the last `update_snapshot()`.
+    const Snapshot &get_snapshot() const;
+
+    /**
+     * @brief Render the tetrimino layout UI from the latest published snapshot.
+     * @details
+     * Updates the texts which changed since the last render. The tetrimino queue,
+     * the swap tetrimino and the prompts are cached and only redrawn when they
+     * change or the size changes.
+     *
+     * The tetrimino is drawn the fraction of a cell it is on its way to the next
+     * one, so that it moves smoothly at any refresh rate without lagging behind the
+     * logic.
      * @param x Upper left corner x coordinate.
      * @param y Upper left corner y coordinate.
      * @param w The width.
@@ -109,28 +173,74 @@ public:
      */
     void render(int x, int y, int w, int h);
 
-    /// `true` if a new tetrimino could not be spawned.
+    /// `true` if a new tetrimino could not be spawned. Only called by logic.
     bool game_over() const;
 
-    /// Get the current score.
+    /// Get the current score. Only called by logic.
     int get_score() const;
 
+    /**
+     * @brief Get a checksum of the game state, e.g. for the flight recorder. Only
+     *     called by logic.
+     */
+    Uint32 get_checksum() const;
+
 private:
-    static constexpr int MULT_LINE = 1000; /// Score per cleared line.
+    /// A text which does not change during a game.
+    struct Prompt
+    {
+        Text *text;
+        SDL_Rect rect; // Rectangle the text is fit into.
+        Text::TextAlign align;
+    };
+
+    /// Do `dt` ms of logic. @see do_logic
+    void advance(Uint32 dt);
+
+    /**
+     * @brief Do the logic up to `timestamp`, given in `Timer::get_ticks()` time.
+     * @return Ms the logic already passed `timestamp` by, i.e. how late an event
+     *     of `timestamp` is handled; `0` if the logic caught up to it.
+     */
+    Uint32 catch_up(Uint32 timestamp);
 
-    /// Score per combo accumulated before clearing a line.
-    static constexpr int MULT_COMBO = 1500;
+    /// Copy the game state to `snapshot`.
+    void take_snapshot(Snapshot &snapshot);
 
-    static constexpr int SCORE_TETRIS = 1000; /// Additional score for a 4-line clear.
+    /// Get the checksum of the game state given the checksum of the field.
+    Uint32 get_checksum(Uint32 fieldChecksum) const;
+
+    /// Set the texts and invalidate the caches which `snapshot` changed.
+    void update_render_state(const Snapshot &snapshot);
 
     /// Render the full layout.
-    void render_full(int x, int y, int w, int h);
+    void render_full(const Snapshot &snapshot, int x, int y, int w, int h);
 
     /// Render the reduced layout.
-    void render_reduced(int x, int y, int w, int h);
+    void render_reduced(const Snapshot &snapshot, int x, int y, int w, int h);
 
     /// Render the minimal layout.
-    void render_minimal(int x, int y, int w, int h);
+    void render_minimal(const Snapshot &snapshot, int x, int y, int w, int h);
+
+    /// Render the field and the tetrimino of `snapshot`.
+    void render_field(const Snapshot &snapshot, int x, int y, int w, int h);
+
+    /**
+     * @brief Render the tetrimino queue from its cache.
+     * @param queue The queued tetriminos.
+     * @param positions Upper left corner of each queued tetrimino.
+     * @param blockSize Block size of the queued tetriminos.
+     */
+    void render_queue(
+        const std::vector<TetriminoConfig> &queue, const SDL_Point *positions,
+        int blockSize
+    );
+
+    /// Render the swap tetrimino of `snapshot`, if any, from its cache at (`x`, `y`).
+    void render_swap(const Snapshot &snapshot, int x, int y, int blockSize);
+
+    /// Render `count` `prompts` from their cache.
+    void render_prompts(const Prompt *prompts, int count);
 
     /**
      * @brief Spawn a new tetrimino with the config from the front of the queue.
@@ -144,7 +254,7 @@ private:
     /// If the previous swapped tetrimino was released, or there were no swaps, swap.
     void swap();
 
-    /// Add score, set combo, and set message, score, and combo texts.
+    /// Add score, set combo, and set the message.
     void manage_score(int currLinesCleared);
 
     KeyLayout *keyLayout;
@@ -157,10 +267,19 @@ private:
 
     TetrisField field;
     Tetrimino tetrimino;
+    TripleBuffer<Snapshot> snapshots;
 
+    // Rendering state
     Layout layout;
-    std::deque<TetriminoConfig> tetriminoQueue;
-    TetriminoConfig *tetriminoSwap;
+    RenderCache queueCache, swapCache, promptsCache;
+    int renderW, renderH; // Size of the last render, to redraw caches on resizes.
+    int shownSpawns, shownSwaps; // Of the snapshot the caches were drawn for.
+    int shownScore, shownCombo, shownLinesCleared, shownMessages;
+
+    // Logic state
+    std::vector<TetriminoConfig> tetriminoQueue; // Reserved to never reallocate.
+    TetriminoConfig tetriminoSwap;
+    bool hasSwap; // `true` if `tetriminoSwap` holds a swapped tetrimino.
 
     /**
      * @brief If true, swap when doing logic.
@@ -174,10 +293,14 @@ private:
     bool trySwap;
 
     int swapped; // Amount of tetrimino spawns since the last swap.
+    int spawns, swaps; // Total spawns and swaps, to tell rendering of changes.
+    int messages, messageLines; // See `Snapshot`.
     int tetriminoFallDelay;
     int gameOver;
+    Uint32 caughtUp; // Time of `tetriminoTimer` the logic was done up to.
 
     int linesCleared; // Total lines cleared.
+    Counter *linesClearedCounter; // Lines cleared by the player in all games.
     int score, combo;
 };
 
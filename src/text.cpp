@@ -4,7 +4,10 @@
  */
 
 #include "text.hpp"
+#include "glyph_atlas.hpp"
+#include "trace.hpp"
 #include "logger.hpp"
+#include "constants.hpp"
 
 
 void Text::init (
@@ -12,15 +15,19 @@ void Text::init (
     const std::string &maxText
 )
 {
-    log("Initializing Text from \"" + text + "\"", __FILE__, __LINE__);
+    LOG_DEBUG("Initializing Text from \"{}\"", text);
 
     this->renderer = &renderer;
     this->font = &font;
     this->text = text;
     this->color = color;
     this->maxText = maxText.size() ? maxText : text;
+    this->text.reserve(this->maxText.size()); // So that `set_text` does not allocate
     lastW = lastH = -1;
     lastPtSize = -1;
+    textW = textH = 0;
+    glyphs = false;
+    dynamic = false;
 }
 
 void Text::free ()
@@ -30,91 +37,123 @@ void Text::free ()
 
 void Text::render (int x, int y, int w, int h, TextAlign centering)
 {
+    TRACE_ZONE("Text::render");
+
     if (text.empty())
     {
         return;
     }
     if (w != lastW || h != lastH)
     {
-        if (font->text_fits(maxText, w, h))
-        {
-            font->fit_font(maxText, w, h, font->get_size() + 1);
-        }
-        else
-        {
-            font->fit_font(maxText, w, h);
-        }
+        font->fit_font(maxText, w, h);
         if (font->get_size() != lastPtSize)
         {
-            texture.load_from_text(*renderer, *font, text, color);
             lastPtSize = font->get_size();
+            update();
         }
         lastW = w;
         lastH = h;
     }
+
     switch (centering)
     {
     case TEXT_CENTER:
-        texture.render(
-            x + (w - texture.get_width()) / 2, y + (h - texture.get_height()) / 2
-        );
+        x += (w - textW) / 2;
+        y += (h - textH) / 2;
         break;
 
     case TEXT_CENTER_TOP:
-        texture.render(x + (w - texture.get_width()) / 2, y);
+        x += (w - textW) / 2;
         break;
 
     case TEXT_CENTER_BOTTOM:
-        texture.render(
-            x + (w - texture.get_width()) / 2, y + h - texture.get_height()
-        );
+        x += (w - textW) / 2;
+        y += h - textH;
         break;
 
     case TEXT_CENTER_LEFT:
-        texture.render(x, y + (h - texture.get_height()) / 2);
+        y += (h - textH) / 2;
         break;
 
     case TEXT_CENTER_RIGHT:
-        texture.render(
-            x + w - texture.get_width(), y + (h - texture.get_height()) / 2
-        );
+        x += w - textW;
+        y += (h - textH) / 2;
         break;
 
     case TEXT_UPPER_LEFT:
-        texture.render(x, y);
         break;
 
     case TEXT_UPPER_RIGHT:
-        texture.render(x + w - texture.get_width(), y);
+        x += w - textW;
         break;
 
     case TEXT_BOTTOM_LEFT:
-        texture.render(x, y + h - texture.get_height());
+        y += h - textH;
         break;
 
     case TEXT_BOTTOM_RIGHT:
-        texture.render(x + w - texture.get_width(), y + h - texture.get_height());
+        x += w - textW;
+        y += h - textH;
         break;
     }
+
+    if (glyphs)
+    {
+        font->get_glyph_atlas(*renderer, lastPtSize).render(x, y, text, color);
+    }
+    else
+    {
+        texture.render(x, y);
+    }
 }
 
-void Text::set_text (const std::string &text, const Color *color)
+void Text::set_text (std::string_view text, const Color *color)
 {
-    this->text = text;
-    font->set_size(lastPtSize);
+    this->text.assign(text.data(), text.size());
+    dynamic = true;
     if (color != nullptr)
     {
         this->color = *color;
     }
-    texture.load_from_text(*renderer, *font, text, this->color);
+    if (lastPtSize != -1)
+    {
+        update();
+    }
 }
 
 int Text::get_width () const
 {
-    return texture.get_width();
+    return textW;
 }
 
 int Text::get_height () const
 {
-    return texture.get_height();
+    return textH;
+}
+
+void Text::update ()
+{
+    TRACE_ZONE("Text::update");
+
+    // Only text changing its contents is worth the atlas of a point size, as long
+    // as the atlas stays small
+    if (dynamic && lastPtSize <= GLYPH_ATLAS_MAX_PT_SIZE)
+    {
+        GlyphAtlas &atlas = font->get_glyph_atlas(*renderer, lastPtSize);
+        glyphs = atlas.has_glyphs(text);
+        if (glyphs)
+        {
+            texture.free();
+            textW = atlas.get_text_width(text);
+            textH = atlas.get_text_height(text);
+            return;
+        }
+    }
+    glyphs = false;
+
+    // Rasterize large or static text and text the atlas does not cover as a whole
+    font->set_size(lastPtSize);
+    texture.load_from_text(*renderer, *font, text, color);
+    textW = texture.get_width();
+    textH = texture.get_height();
 }
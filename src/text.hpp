@@ -11,8 +11,18 @@
 #include "texture.hpp"
 #include "font.hpp"
 
+#include <string>
+#include <string_view>
 
-/// Text wrapper class with simple and efficient rendering.
+
+/**
+ * @brief Text wrapper class with simple and efficient rendering.
+ * @details
+ * Text changed with `set_text()` is drawn as quads from the glyph atlas of the font
+ * at the fitted point size, so setting new text does not rasterize anything. Text
+ * which is never changed, larger than `GLYPH_ATLAS_MAX_PT_SIZE` or with characters
+ * the atlas does not have is rasterized into a texture of its own instead.
+ */
 class Text
 {
 public:
@@ -42,7 +52,7 @@ public:
         const std::string &maxText=""
     );
     
-    /// Free the texture.
+    /// Free the texture of text the glyph atlas does not cover.
     void free();
 
     /**
@@ -53,11 +63,11 @@ public:
      * @param h Maximum height.
      * @param centering Position to place the text in relative to the rectangle.
      * @note If `w` and `h` are the same since the previous call, uses the same
-     *     texture.
+     *     layout.
      * @note If called for the first time or the dimensions have changed,
-     *     fits the font point size starting from 1 if the current size is too small,
-     *     or from current size + 1 if `text` already fits.
-     *     If this results in a point size change, creates a new texture.
+     *     fits the font point size to `maxText`, which the font memoizes.
+     *     If this results in a point size change, lays the text out again, which
+     *     rasterizes the text or the glyph atlas of a new point size once.
      */
     void render(int x, int y, int w, int h, TextAlign centering=TEXT_CENTER);
 
@@ -66,25 +76,33 @@ public:
      * @param text The new text.
      * @param color New color; by default, does not change collor.
      * @note
-     * Creates a new texture after setting `font` point size to the last one used for
-     * rendering by this object. Should not be called before a first `render` call on
-     * this object.
+     * Lays out `text` with the glyph atlas of the point size last used for rendering
+     * by this object. Only text larger than `GLYPH_ATLAS_MAX_PT_SIZE` or not covered
+     * by the atlas is rasterized, after setting `font` point size to that size.
      * @note `text` should fit in the same dimensions as `maxText`.
+     * @note Does not allocate unless `text` is longer than any previous text and
+     *     `maxText`.
      */
-    void set_text(const std::string &text, const Color *color=nullptr);
+    void set_text(std::string_view text, const Color *color=nullptr);
     
-    /// Get texture width.
+    /// Get text width.
     int get_width() const;
     
-    /// Get texture height.
+    /// Get text height.
     int get_height() const;
 
 private:
+    /// Lay out `text` at `lastPtSize`, rasterizing it unless drawn from the atlas.
+    void update();
+
     Renderer *renderer;
     Font *font;
     std::string text, maxText;
     Color color;
-    Texture texture;
+    Texture texture; // Rasterized `text`, unless `glyphs` is set.
+    bool glyphs; // `true` if `text` is drawn from the glyph atlas.
+    bool dynamic; // `true` once `text` was changed with `set_text()`.
+    int textW, textH;
     int lastW, lastH, lastPtSize;
 };
 
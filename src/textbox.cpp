@@ -13,7 +13,7 @@ void TextBox::init (
     const std::string &maxText
 )
 {
-    log("Initializing TextBox", __FILE__, __LINE__);
+    LOG_DEBUG("Initializing TextBox");
 
     text.init(renderer, font, line, textColor, maxText);
     box.init(renderer, fillColor, frameColor);
@@ -41,7 +41,7 @@ void TextBox::set_fill_color (const Color &color)
     box.set_fill_color(color);
 }
 
-void TextBox::set_text (const std::string &line, const Color *color)
+void TextBox::set_text (std::string_view line, const Color *color)
 {
     text.set_text(line, color);
 }
@@ -60,7 +60,7 @@ public:
      * @param line The new text.
      * @param color New color; by default, does not change collor.
      */
-    void set_text(const std::string &line, const Color *color=nullptr);
+    void set_text(std::string_view line, const Color *color=nullptr);
 
 private:
     Text text;
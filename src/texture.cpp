@@ -1,11 +1,46 @@
 /**
  * @file  texture.cpp
- * @brief Implementation of the class Texture.
+ * @brief Implementation of the classes Texture and TextureAtlas.
  */
 
 #include "texture.hpp"
+#include "font.hpp"
+#include "trace.hpp"
+#include "constants.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+
+/// Estimated bytes of all loaded textures, assuming 4 bytes per pixel.
+static Gauge &residentBytes = Metrics::gauge(
+    "texture_bytes_resident", "Estimated bytes of loaded textures."
+);
+
+
+/**
+ * @brief Load the image stored in `path` as a surface.
+ * @param keyColor The transparent pixel; `nullptr` to not use color keying.
+ * @throws `ExceptionSDL` thrown if the image could not be loaded.
+ */
+static SDL_Surface *load_surface (const std::string &path, const Color *keyColor)
+{
+    SDL_Surface *surface = IMG_Load(path.c_str());
+    if (surface == NULL)
+    {
+        throw ExceptionSDL(__FILE__, __LINE__, IMG_GetError());
+    }
+    if (keyColor != nullptr)
+    {
+        SDL_SetColorKey(
+            surface, SDL_TRUE,
+            SDL_MapRGB(surface->format, keyColor->r, keyColor->b, keyColor->g)
+        );
+    }
+    return surface;
+}
 
 
 Texture::~Texture ()
@@ -17,13 +52,18 @@ void Texture::free()
 {
     if (texture != NULL)
     {
-        log("Freeing Texture", __FILE__, __LINE__);
+        LOG_DEBUG("Freeing Texture");
 
-        SDL_DestroyTexture(texture);
+        if (owned)
+        {
+            residentBytes.add(-4LL * w * h);
+            renderer->destroy_texture(texture);
+        }
         texture = NULL;
         renderer = nullptr;
         w = 0;
         h = 0;
+        colorMod = {255, 255, 255, 255};
     }
 }
 
@@ -31,10 +71,33 @@ void Texture::load_from_file (
     Renderer &renderer, const std::string &path, const Color *keyColor
 )
 {
-    log("Loading texture from \"" + path + "\"", __FILE__, __LINE__);
+    TRACE_ZONE("Texture::load_from_file");
+
+    LOG_INFO("Loading texture from \"{}\"", path);
 
     // Destroy previous texture
     free();
+    this->renderer = &renderer;
+
+    // Use the region if the image is packed
+    const TextureAtlas *atlas = renderer.get_atlas();
+    const TextureAtlas::Region *packed = nullptr;
+    if (atlas != nullptr)
+    {
+        packed = atlas->find(path, keyColor);
+    }
+    if (packed != nullptr)
+    {
+        texture = packed->page;
+        owned = false;
+        region = packed->rect;
+        textureW = packed->pageW;
+        textureH = packed->pageH;
+        w = region.w;
+        h = region.h;
+        SDL_GetTextureBlendMode(texture, &blendMode);
+        return;
+    }
     
     // If color keying is not needed, load texture straight from image
     if (keyColor == nullptr)
@@ -45,16 +108,7 @@ void Texture::load_from_file (
     // Otherwise, load surface
     else
     {
-        SDL_Surface *surface = IMG_Load(path.c_str());
-        if (surface == NULL)
-        {
-            throw ExceptionSDL(__FILE__, __LINE__, IMG_GetError());
-        }
-
-        SDL_SetColorKey(
-            surface, SDL_TRUE,
-            SDL_MapRGB(surface->format, keyColor->r, keyColor->b, keyColor->g)
-        );
+        SDL_Surface *surface = load_surface(path, keyColor);
 
         // Create texture from surface pixels
         texture = renderer.create_texture_from_surface(surface);
@@ -62,43 +116,61 @@ void Texture::load_from_file (
         h = surface->h;
         SDL_FreeSurface(surface);
     }
-
-    this->renderer = &renderer;
+    owned = true;
+    region = {0, 0, w, h};
+    textureW = w;
+    textureH = h;
+    SDL_GetTextureBlendMode(texture, &blendMode);
+    residentBytes.add(4LL * w * h);
 }
 
 void Texture::load_from_text (
     Renderer &renderer, Font &font, const std::string &text, const Color &color
 )
 {
-    log("Loading texture from text \"" + text + "\"", __FILE__, __LINE__);
+    TRACE_ZONE("Texture::load_from_text");
+
+    LOG_DEBUG("Loading texture from text \"{}\"", text);
 
+    SDL_Surface *surface = font.create_text_surface(text, color);
+    load_from_surface(renderer, surface);
+    SDL_FreeSurface(surface);
+}
+
+void Texture::load_from_surface (Renderer &renderer, SDL_Surface *surface)
+{
     // Destroy previous texture
     free();
 
-    SDL_Surface *surface = font.create_text_surface(text, color);
-    
     // Create texture from surface pixels
     texture = renderer.create_texture_from_surface(surface);
     w = surface->w;
     h = surface->h;
-    SDL_FreeSurface(surface);
+    owned = true;
+    region = {0, 0, w, h};
+    textureW = w;
+    textureH = h;
+    SDL_GetTextureBlendMode(texture, &blendMode);
+    residentBytes.add(4LL * w * h);
 
     this->renderer = &renderer;
 }
 
 void Texture::set_color (const Color *color)
 {
-    SDL_SetTextureColorMod(texture, color->r, color->g, color->b);
+    colorMod.r = color->r;
+    colorMod.g = color->g;
+    colorMod.b = color->b;
 }
 
 void Texture::set_blend_mode (SDL_BlendMode blending)
 {
-    SDL_SetTextureBlendMode(texture, blending);
+    blendMode = blending;
 }
 
 void Texture::set_alpha (Uint8 alpha)
 {
-    SDL_SetTextureAlphaMod(texture, alpha);
+    colorMod.a = alpha;
 }
 
 void Texture::render (
@@ -114,7 +186,7 @@ void Texture::render (
         renderQuad.h = clip->h;
     }
 
-    renderer->render_texture(texture, clip, &renderQuad, angle, center, flip);
+    render(renderQuad, clip, angle, center, flip);
 }
 
 void Texture::render (
@@ -122,7 +194,17 @@ void Texture::render (
     double angle, const SDL_Point *center, SDL_RendererFlip flip
 )
 {
-    renderer->render_texture(texture, clip, &renderQuad, angle, center, flip);
+    // Clips are relative to the region
+    SDL_Rect textureClip = region;
+    if (clip != NULL)
+    {
+        textureClip = {region.x + clip->x, region.y + clip->y, clip->w, clip->h};
+    }
+
+    renderer->render_texture(
+        texture, textureW, textureH, &textureClip, &renderQuad, colorMod, blendMode,
+        angle, center, flip
+    );
 }
 
 int Texture::get_width () const
@@ -135,3 +217,244 @@ int Texture::get_height () const
     return h;
 }
 
+Renderer *Texture::get_renderer () const
+{
+    return renderer;
+}
+
+
+
+TextureAtlas::~TextureAtlas ()
+{
+    free();
+}
+
+void TextureAtlas::init (Renderer &renderer, const std::vector<Image> &images)
+{
+    TRACE_ZONE("TextureAtlas::init");
+
+    LOG_INFO("Packing {} images into the texture atlas", images.size());
+
+    free();
+    this->renderer = &renderer;
+
+    int pageSize = ATLAS_PAGE_SIZE;
+    if (renderer.get_max_texture_size() > 0)
+    {
+        pageSize = std::min(pageSize, renderer.get_max_texture_size());
+    }
+
+    std::vector<SDL_Surface *> surfaces;
+    auto free_surfaces = [&surfaces]()
+    {
+        for (SDL_Surface *surface : surfaces)
+        {
+            SDL_FreeSurface(surface);
+        }
+    };
+    try
+    {
+        for (const Image &image : images)
+        {
+            surfaces.push_back(load_surface(image.path, image.keyColor));
+        }
+    }
+    catch (const ExceptionSDL &)
+    {
+        free_surfaces();
+        throw;
+    }
+
+    // Shelves fill up best with the tallest images first
+    std::vector<size_t> order;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        int slotW = surfaces[i]->w + 2 * PADDING;
+        int slotH = surfaces[i]->h + 2 * PADDING;
+        if (slotW > pageSize || slotH > pageSize)
+        {
+            LOG_WARNING("Image \"{}\" is too large for the atlas", images[i].path);
+            continue;
+        }
+        order.push_back(i);
+    }
+    std::stable_sort(
+        order.begin(), order.end(),
+        [&surfaces](size_t a, size_t b){ return surfaces[a]->h > surfaces[b]->h; }
+    );
+
+    // Place the images on shelves, opening a new page when a page is full
+    std::vector<SDL_Rect> slots(images.size());
+    std::vector<int> slotPages(images.size());
+    std::vector<SDL_Point> pageSizes;
+    int x = 0, y = 0, shelfH = 0;
+    for (size_t i : order)
+    {
+        int slotW = surfaces[i]->w + 2 * PADDING;
+        int slotH = surfaces[i]->h + 2 * PADDING;
+        if (x + slotW > pageSize)
+        {
+            x = 0;
+            y += shelfH;
+            shelfH = 0;
+        }
+        if (pageSizes.empty() || y + slotH > pageSize)
+        {
+            pageSizes.push_back({0, 0});
+            x = 0;
+            y = 0;
+            shelfH = 0;
+        }
+        slots[i] = {x, y, slotW, slotH};
+        slotPages[i] = pageSizes.size() - 1;
+        SDL_Point &used = pageSizes.back();
+        used.x = std::max(used.x, x + slotW);
+        used.y = std::max(used.y, y + slotH);
+        x += slotW;
+        shelfH = std::max(shelfH, slotH);
+    }
+
+    for (size_t page = 0; page < pageSizes.size(); ++page)
+    {
+        int pageW = pageSizes[page].x, pageH = pageSizes[page].y;
+        SDL_Surface *pageSurface = SDL_CreateRGBSurfaceWithFormat(
+            0, pageW, pageH, 32, SDL_PIXELFORMAT_RGBA32
+        );
+        if (pageSurface == NULL)
+        {
+            free_surfaces();
+            throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
+        }
+        SDL_FillRect(pageSurface, NULL, 0);
+
+        std::vector<SDL_Rect> rects;
+        for (size_t i : order)
+        {
+            if (slotPages[i] != int(page))
+            {
+                continue;
+            }
+
+            // Copy the pixels as they are, color key included
+            SDL_Rect rect = {
+                slots[i].x + PADDING, slots[i].y + PADDING, surfaces[i]->w,
+                surfaces[i]->h
+            };
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dst = rect;
+            SDL_BlitSurface(surfaces[i], NULL, pageSurface, &dst);
+            rects.push_back(rect);
+
+            const Color *keyColor = images[i].keyColor;
+            regions.push_back({
+                images[i].path, keyColor != nullptr,
+                keyColor ? *keyColor : Color{0, 0, 0}, NULL, rect, pageW, pageH
+            });
+        }
+
+        // Repeat the edge pixels into the padding
+        SDL_LockSurface(pageSurface);
+        Uint8 *pixels = static_cast<Uint8 *>(pageSurface->pixels);
+        auto pixel = [pixels, pageSurface](int x, int y) -> Uint32 &
+        {
+            return reinterpret_cast<Uint32 *>(pixels + y * pageSurface->pitch)[x];
+        };
+        for (const SDL_Rect &rect : rects)
+        {
+            for (int py = rect.y - PADDING; py < rect.y + rect.h + PADDING; ++py)
+            {
+                int srcY = std::clamp(py, rect.y, rect.y + rect.h - 1);
+                for (int px = rect.x - PADDING; px < rect.x + rect.w + PADDING; ++px)
+                {
+                    int srcX = std::clamp(px, rect.x, rect.x + rect.w - 1);
+                    if (srcX != px || srcY != py)
+                    {
+                        pixel(px, py) = pixel(srcX, srcY);
+                    }
+                }
+            }
+        }
+        SDL_UnlockSurface(pageSurface);
+
+        SDL_Texture *texture;
+        try
+        {
+            texture = renderer.create_texture_from_surface(pageSurface);
+        }
+        catch (const ExceptionSDL &)
+        {
+            SDL_FreeSurface(pageSurface);
+            free_surfaces();
+            throw;
+        }
+        SDL_FreeSurface(pageSurface);
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        pages.push_back(texture);
+        bytes += 4LL * pageW * pageH;
+
+        LOG_INFO("Created texture atlas page {}x{}", pageW, pageH);
+    }
+    free_surfaces();
+
+    // Regions were added page by page
+    size_t region = 0;
+    for (size_t page = 0; page < pageSizes.size(); ++page)
+    {
+        for (size_t i : order)
+        {
+            if (slotPages[i] == int(page))
+            {
+                regions[region++].page = pages[page];
+            }
+        }
+    }
+
+    residentBytes.add(bytes);
+    renderer.set_atlas(this);
+}
+
+void TextureAtlas::free ()
+{
+    if (renderer == nullptr)
+    {
+        return;
+    }
+
+    LOG_DEBUG("Freeing TextureAtlas");
+
+    if (renderer->get_atlas() == this)
+    {
+        renderer->set_atlas(nullptr);
+    }
+    for (SDL_Texture *page : pages)
+    {
+        renderer->destroy_texture(page);
+    }
+    residentBytes.add(-bytes);
+    pages.clear();
+    regions.clear();
+    bytes = 0;
+    renderer = nullptr;
+}
+
+const TextureAtlas::Region *TextureAtlas::find (
+    const std::string &path, const Color *keyColor
+) const
+{
+    for (const Region &region : regions)
+    {
+        if (region.path != path || region.keyed != (keyColor != nullptr))
+        {
+            continue;
+        }
+        if (
+            keyColor == nullptr
+            || (region.keyColor.r == keyColor->r && region.keyColor.g == keyColor->g
+                && region.keyColor.b == keyColor->b)
+        )
+        {
+            return &region;
+        }
+    }
+    return nullptr;
+}
@@ -1,6 +1,6 @@
 /**
  * @file  texture.hpp
- * @brief Include file for Texture class.
+ * @brief Include file for Texture and TextureAtlas classes.
  */
 
 #ifndef TEXTURE_HPP
@@ -8,15 +8,22 @@
 
 
 #include "renderer.hpp"
-#include "font.hpp"
 #include "util.hpp"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <string>
+#include <vector>
 
 
-/// SDL_Texture wrapper class.
+class Font;
+
+/**
+ * @brief SDL_Texture wrapper class.
+ * @details
+ * A texture either owns its SDL texture or is a region of a `TextureAtlas` page.
+ * Clips and sizes are relative to the region either way.
+ */
 class Texture
 {
 public:
@@ -28,6 +35,9 @@ public:
     /**
      * @brief Load and color key a texture from the image stored in `path` using
      *     `renderer`.
+     * @details
+     * If the atlas of `renderer` packed `path` with the same `keyColor`, the texture
+     * becomes its region and nothing is loaded.
      * @note Stores a pointer to `renderer`.
      * @param renderer Renderer to use for texture creation.
      * @param path Image path.
@@ -50,13 +60,21 @@ public:
         const Color &color={0, 0, 0}
     );
 
-    /// Set texture color mode.
+    /**
+     * @brief Create texture from the pixels of `surface` using `renderer`.
+     * @note Stores a pointer to `renderer`. Does not free `surface`.
+     * @param renderer Renderer to use for texture creation.
+     * @param surface The surface.
+     */
+    void load_from_surface(Renderer &renderer, SDL_Surface *surface);
+
+    /// Set the color the texture is multiplied by when rendered.
     void set_color(const Color *color);
 
-    /// Set texture blend mode.
+    /// Set the blend mode the texture is rendered with.
     void set_blend_mode(SDL_BlendMode blending);
 
-    /// Set texture transparency.
+    /// Set the transparency the texture is rendered with.
     void set_alpha(Uint8 alpha);
 
     /**
@@ -99,10 +117,78 @@ public:
     /// Get texture height.
     int get_height() const;
 
+    /// Get the renderer the texture was created with; `nullptr` if not created.
+    Renderer *get_renderer() const;
+
 private:
     SDL_Texture *texture = NULL;
     Renderer *renderer = nullptr;
     int w, h;
+    bool owned = true; // `false` for atlas regions.
+    SDL_Rect region; // Region of `texture` the texture uses.
+    int textureW, textureH; // Size of `texture`.
+
+    // Applied per rendered quad since quads are drawn later in batches
+    SDL_Color colorMod = {255, 255, 255, 255};
+    SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND;
+};
+
+
+/**
+ * @brief Images packed into a few large textures, the pages, at startup.
+ * @details
+ * Once set as the atlas of a renderer, textures loaded from packed images become
+ * regions of the pages, so batched quads of different images can share a texture.
+ * Images are packed on shelves with their edge pixels repeated around them, so that
+ * filtering does not bleed the neighbouring images in.
+ */
+class TextureAtlas
+{
+public:
+    /// An image to pack.
+    struct Image
+    {
+        const char *path;
+        const Color *keyColor; // The transparent pixel; `nullptr` for none.
+    };
+
+    /// A packed image.
+    struct Region
+    {
+        std::string path;
+        bool keyed;
+        Color keyColor;
+        SDL_Texture *page;
+        SDL_Rect rect; // Location in `page`.
+        int pageW, pageH;
+    };
+
+    ~TextureAtlas();
+
+    /**
+     * @brief Load `images`, pack them into pages and set the atlas of `renderer`.
+     * @details
+     * Pages are at most `ATLAS_PAGE_SIZE` pixels and the maximum texture size of
+     * `renderer` wide and high; larger images are not packed.
+     * @throws `ExceptionSDL` thrown if an image could not be loaded or a page could
+     *     not be created.
+     */
+    void init(Renderer &renderer, const std::vector<Image> &images);
+
+    /// Unset the atlas of the renderer and destroy the pages.
+    void free();
+
+    /// Get the region of `path` packed with `keyColor`; `nullptr` if not packed.
+    const Region *find(const std::string &path, const Color *keyColor) const;
+
+private:
+    /// Pixels around each image filled with its edge pixels.
+    static constexpr int PADDING = 2;
+
+    Renderer *renderer = nullptr;
+    std::vector<SDL_Texture *> pages;
+    std::vector<Region> regions;
+    long long bytes = 0; // Estimated bytes of the pages.
 };
 
 
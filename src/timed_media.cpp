@@ -20,7 +20,7 @@ void TimedText::render (int x, int y, int w, int h, Text::TextAlign centering)
     }
 }
 
-void TimedText::set_text (const std::string &text, int time, const Color *color)
+void TimedText::set_text (std::string_view text, int time, const Color *color)
 {
     this->text->set_text(text, color);
     timer->start();
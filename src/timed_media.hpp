@@ -10,7 +10,7 @@
 #include "text.hpp"
 #include "timer.hpp"
 
-#include <string>
+#include <string_view>
 
 
 /// Text that stops rendering after set time.
@@ -44,7 +44,7 @@ public:
      * @param time Time before the text stops being rendered.
      * @param color New color; by default, does not change collor.
      */
-    void set_text(const std::string &text, int time, const Color *color=nullptr);
+    void set_text(std::string_view text, int time, const Color *color=nullptr);
 
 private:
     Text *text;
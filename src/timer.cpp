@@ -8,11 +8,15 @@
 #include <SDL2/SDL.h>
 
 
-Timer::Timer (): startTime(SDL_GetTicks()), pauseTime(0) {}
+bool Timer::manualClock = false;
+Uint32 Timer::manualTicks = 0;
+
+
+Timer::Timer (): startTime(get_ticks()), pauseTime(0) {}
 
 void Timer::start ()
 {
-    startTime = SDL_GetTicks();
+    startTime = get_ticks();
     pauseTime = 0;
 }
 
@@ -22,14 +26,29 @@ Uint32 Timer::get_elapsed () const
     {
         return pauseTime - startTime;
     }
-    return SDL_GetTicks() - startTime;
+    return get_ticks() - startTime;
+}
+
+Uint32 Timer::lap ()
+{
+    if (pauseTime)
+    {
+        // Stay paused with nothing elapsed since the lap
+        Uint32 elapsed = pauseTime - startTime;
+        startTime = pauseTime;
+        return elapsed;
+    }
+    Uint32 now = get_ticks();
+    Uint32 elapsed = now - startTime;
+    startTime = now;
+    return elapsed;
 }
 
 void Timer::pause ()
 {
     if (!pauseTime)
     {
-        pauseTime = SDL_GetTicks();
+        pauseTime = get_ticks();
     }
 }
 
@@ -39,7 +58,28 @@ void Timer::unpause ()
     {
         // Substract time between pause and previous start so that it will be added
         // on elapsed time calculation
-        startTime = SDL_GetTicks() - (pauseTime - startTime);
+        startTime = get_ticks() - (pauseTime - startTime);
         pauseTime = 0;
     }
 }
+
+void Timer::use_manual_clock ()
+{
+    manualClock = true;
+    manualTicks = 1;
+}
+
+void Timer::advance_manual_clock (Uint32 ms)
+{
+    manualTicks += ms;
+}
+
+void Timer::use_sdl_clock ()
+{
+    manualClock = false;
+}
+
+Uint32 Timer::get_ticks ()
+{
+    return manualClock ? manualTicks : SDL_GetTicks();
+}
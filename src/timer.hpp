@@ -46,7 +46,37 @@ public:
     /// Get total running time from the last start time setting.
     Uint32 get_elapsed() const;
 
+    /**
+     * @brief Get the elapsed time and start from 0.
+     * @details
+     * Unlike `get_elapsed()` followed by `start()`, reads the clock once, so that
+     * no time is lost between laps. A paused timer stays paused.
+     */
+    Uint32 lap();
+
+    /**
+     * @brief Drive all timers by `advance_manual_clock()` instead of the SDL clock.
+     * @details
+     * Makes timing deterministic for headless runs. The manual clock starts at 1 ms,
+     * since a pause time of 0 means not paused.
+     * @note Timers started before switching clocks have to be restarted.
+     */
+    static void use_manual_clock();
+
+    /// Advance the manual clock by `ms`.
+    static void advance_manual_clock(Uint32 ms);
+
+    /// Drive all timers by `SDL_GetTicks()` again.
+    static void use_sdl_clock();
+
+    /// Get the current time of the clock in use, e.g. to compare event timestamps.
+    static Uint32 get_ticks();
+
 private:
+
+    static bool manualClock;
+    static Uint32 manualTicks;
+
     Uint32 startTime; // Time on start.
     Uint32 pauseTime; // Time on pause.
 };
@@ -0,0 +1,105 @@
+/**
+ * @file  trace.cpp
+ * @brief Implementation of the class Trace.
+ */
+
+#include "trace.hpp"
+#include "flight_recorder.hpp"
+#include "exceptions.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+
+std::mutex Trace::ringsMutex;
+std::vector<std::unique_ptr<Trace::Ring>> Trace::rings;
+
+
+void Trace::record (const char *name, Uint64 start, Uint64 end)
+{
+    Ring *ring = get_ring();
+    Uint64 head = ring->head.load(std::memory_order_relaxed);
+    ring->zones[head % TRACE_RING_LEN] = {name, start, end};
+    ring->head.store(head + 1, std::memory_order_release);
+
+    FlightRecorder::record_zone(name, start, end);
+}
+
+void Trace::dump (const std::string &path)
+{
+    std::ofstream fout(path);
+    if (fout.fail())
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+
+    std::vector<std::pair<int, Zone>> zones;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const std::unique_ptr<Ring> &ring : rings)
+        {
+            Uint64 head = ring->head.load(std::memory_order_acquire);
+            Uint64 first = head > TRACE_RING_LEN ? head - TRACE_RING_LEN : 0;
+            size_t begin = zones.size();
+            for (Uint64 i = first; i < head; ++i)
+            {
+                zones.push_back({ring->threadId, ring->zones[i % TRACE_RING_LEN]});
+            }
+
+            // Drop the zones the owning thread might have overwritten while they
+            // were copied, including the one it might be writing now
+            Uint64 unsafe = ring->head.load(std::memory_order_acquire) + 1;
+            if (unsafe > first + TRACE_RING_LEN)
+            {
+                Uint64 overwritten = std::min(
+                    unsafe - first - TRACE_RING_LEN, head - first
+                );
+                zones.erase(
+                    zones.begin() + begin, zones.begin() + begin + overwritten
+                );
+            }
+        }
+    }
+
+    Uint64 origin = ~Uint64(0);
+    for (const auto &zone : zones)
+    {
+        origin = std::min(origin, zone.second.start);
+    }
+    double usPerTick = 1e6 / SDL_GetPerformanceFrequency();
+
+    fout << std::fixed << std::setprecision(3);
+    fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < zones.size(); ++i)
+    {
+        const Zone &zone = zones[i].second;
+        fout << "{\"name\": \"" << zone.name << "\", \"ph\": \"X\", \"pid\": 1"
+            << ", \"tid\": " << zones[i].first
+            << ", \"ts\": " << (zone.start - origin) * usPerTick
+            << ", \"dur\": " << (zone.end - zone.start) * usPerTick
+            << "}" << (i + 1 < zones.size() ? ",\n" : "\n");
+    }
+    fout << "]}\n";
+
+    if (fout.fail())
+    {
+        std::string msg = "Could not write to \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+}
+
+Trace::Ring *Trace::get_ring ()
+{
+    thread_local Ring *ring = nullptr;
+    if (ring == nullptr)
+    {
+        // Rings are kept after their thread exits so its zones can still be dumped
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(std::unique_ptr<Ring>(new Ring));
+        ring = rings.back().get();
+        ring->threadId = rings.size();
+    }
+    return ring;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file  trace.hpp
+ * @brief Include file for Trace and TraceZone classes and the `TRACE_ZONE` macro.
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+
+#include "constants.hpp"
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief A purely static class storing timed zones of every thread.
+ * @details
+ * Each thread writes its zones into its own ring buffer of `TRACE_RING_LEN` zones
+ * without locking; the oldest zones are overwritten. The mutex is only taken when
+ * a thread records its first zone and on dumping.
+ */
+class Trace
+{
+public:
+    /**
+     * @brief Store a zone of the calling thread.
+     * @param name Zone name. Must outlive the trace, e.g. a string literal.
+     * @param start Performance counter value on zone start.
+     * @param end Performance counter value on zone end.
+     */
+    static void record(const char *name, Uint64 start, Uint64 end);
+
+    /**
+     * @brief Write the stored zones of all threads to `path` in Chrome trace JSON.
+     * @note Zones overwritten while dumping are skipped.
+     * @throws `ExceptionFile` thrown if `path` could not be written.
+     */
+    static void dump(const std::string &path);
+
+private:
+    struct Zone
+    {
+        const char *name;
+        Uint64 start, end;
+    };
+
+    /// A single producer ring buffer.
+    struct Ring
+    {
+        Zone zones[TRACE_RING_LEN];
+        std::atomic<Uint64> head{0}; // Total amount of recorded zones.
+        int threadId;
+    };
+
+    /// Get the ring of the calling thread, registering it on the first call.
+    static Ring *get_ring();
+
+    static std::mutex ringsMutex; // Guards `rings`.
+    static std::vector<std::unique_ptr<Ring>> rings; // Rings of all threads.
+};
+
+/// Records a zone from construction to destruction.
+class TraceZone
+{
+public:
+    /// Start the zone named `name`.
+    explicit TraceZone(const char *name)
+        : name(name)
+        , start(SDL_GetPerformanceCounter())
+    {}
+
+    /// End the zone and record it.
+    ~TraceZone()
+    {
+        Trace::record(name, start, SDL_GetPerformanceCounter());
+    }
+
+    TraceZone(const TraceZone &) = delete;
+    TraceZone &operator=(const TraceZone &) = delete;
+
+private:
+    const char *name;
+    Uint64 start;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+/// Record a zone named `name` until the end of the enclosing scope.
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+
+#endif
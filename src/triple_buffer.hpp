@@ -0,0 +1,123 @@
+/**
+ * @file  triple_buffer.hpp
+ * @brief Include file for TripleBuffer class template.
+ */
+
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+
+#include <atomic>
+
+
+/**
+ * @brief Hands the latest value from a writer thread to a reader thread without
+ *     locking.
+ * @details
+ * The writer and the reader each own one of three slots and the third one is
+ * shared. Publishing swaps the written slot with the shared one, and updating swaps
+ * the read slot with the shared one if something was published since. Neither side
+ * ever waits for the other, and the reader always sees a complete value; values
+ * published faster than they are read are skipped.
+ *
+ * Usage:
+ * @code
+ * // Writer thread
+ * buffer.get_write() = value;
+ * buffer.publish();
+ *
+ * // Reader thread
+ * buffer.update();
+ * use(buffer.get_read());
+ * @endcode
+ * @tparam T Value type. Has to be default constructible and copy assignable.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    /**
+     * @brief Copy the slots of `other`, e.g. when a vector of owners grows.
+     * @note Must not be called while other threads use either buffer.
+     */
+    TripleBuffer (const TripleBuffer &other)
+    {
+        *this = other;
+    }
+
+    /// @copydoc TripleBuffer(const TripleBuffer &)
+    TripleBuffer &operator= (const TripleBuffer &other)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            slots[i] = other.slots[i];
+        }
+        write = other.write;
+        shared.store(other.shared.load(std::memory_order_relaxed));
+        read = other.read;
+        return *this;
+    }
+
+    /**
+     * @brief Copy the written slot to the other slots, so that the reader starts
+     *     with it.
+     * @note Must not be called while the other thread uses the buffer.
+     */
+    void fill ()
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (i != write)
+            {
+                slots[i] = slots[write];
+            }
+        }
+        shared.store(shared.load(std::memory_order_relaxed) & INDEX);
+    }
+
+    /// Get the slot to write the next value to. Only called by the writer.
+    T &get_write ()
+    {
+        return slots[write];
+    }
+
+    /// Make the written slot the latest value. Only called by the writer.
+    void publish ()
+    {
+        write = shared.exchange(write | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+     * @brief Take the latest value, if any was published since the last update.
+     * @note Only called by the reader.
+     * @return `true` if `get_read()` changed.
+     */
+    bool update ()
+    {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH))
+        {
+            return false;
+        }
+        read = shared.exchange(read, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /// Get the value taken by the last update. Only called by the reader.
+    const T &get_read () const
+    {
+        return slots[read];
+    }
+
+private:
+    static constexpr int INDEX = 3; // Mask of the slot index in `shared`.
+    static constexpr int FRESH = 4; // Set in `shared` if it was published.
+
+    T slots[3];
+    int write = 0, read = 2;
+    std::atomic<int> shared{1}; // Index of the shared slot, with `FRESH`.
+};
+
+
+#endif
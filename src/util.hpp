@@ -48,5 +48,18 @@ int max(int x, int y);
  */
 std::string get_padded(const std::string &str, int len, char padding);
 
+/// Initial value of hashes built with `hash_combine`.
+constexpr Uint32 HASH_SEED = 2166136261u;
+
+/**
+ * @brief Mix `value` into `hash`, FNV-1a style but a word at a time.
+ * @note Meant for cheap checksums, not for hash tables or security.
+ */
+inline Uint32 hash_combine (Uint32 hash, Uint32 value)
+{
+    hash = (hash ^ value) * 16777619u;
+    return hash ^ hash >> 15;
+}
+
 
 #endif
@@ -0,0 +1,557 @@
+/**
+ * @file  vector_env.cpp
+ * @brief Implementation of the vectorized tetris environment.
+ */
+
+#include "vector_env.hpp"
+#include "constants.hpp"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+
+namespace
+{
+
+constexpr int TYPES = 7; // Same as `Tetrimino::TETRIMINO_TOTAL`.
+constexpr int ROTATIONS = 4; // Same as `Tetrimino::TETRIMINO_ROTATION_TOTAL`.
+
+constexpr int W = TETRIS_FIELD_WIDTH, H = TETRIS_FIELD_HEIGHT;
+
+/// Amount of wall bits to the left of the field in a row mask.
+constexpr int PAD = MAX_SCHEME_LEN;
+
+/// Row mask with only the walls set.
+constexpr uint32_t WALLS = ~(((1u << W) - 1) << PAD);
+
+constexpr uint32_t FULL_ROW = ~0u;
+
+/// Positions a scheme left column can take in a placement action.
+constexpr int COLUMNS = W + MAX_SCHEME_LEN - 1;
+
+constexpr int SPAWN_X = (W - MAX_SCHEME_LEN) / 2;
+
+constexpr int OBS_SIZE = W * H + 2 + TETRIMINO_QUEUE_LEN;
+
+/// Shift offsets tried in order when a rotation collides, as in `Tetrimino::rotate`.
+constexpr int KICKS[][2] = {
+    {-1, 0}, {1, 0}, {0, -1}, {0, 1},
+    {-2, 0}, {2, 0}, {0, -2}, {0, 2},
+    {-1, -1}, {1, -1}, {-1, 1}, {1, 1},
+};
+
+/// `true` if a scheme at `x`, `y` overlaps with blocks, the walls or the floor.
+inline bool collides (const uint32_t *rows, const uint8_t *shape, int x, int y)
+{
+    if (x + PAD < 0)
+    {
+        return true;
+    }
+    for (int row = 0; row < MAX_SCHEME_LEN; ++row)
+    {
+        if (shape[row])
+        {
+            int fieldRow = y + row;
+            if (
+                fieldRow < 0 || fieldRow >= H ||
+                rows[fieldRow] & (uint32_t(shape[row]) << (x + PAD))
+            )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+inline uint32_t next_random (uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/// Pack a random tetrimino type and rotation into a byte.
+inline uint8_t random_config (uint32_t &state)
+{
+    uint32_t r = next_random(state);
+    return uint8_t(r % TYPES | (r / TYPES % ROTATIONS) << 4);
+}
+
+} // namespace
+
+
+/// Structure of arrays with a single entry per game.
+struct TetrisVecEnv
+{
+    int numEnvs;
+
+    std::vector<uint32_t> rows; // `H` row masks per game.
+    std::vector<uint8_t> queue; // `TETRIMINO_QUEUE_LEN` packed configs per game.
+    std::vector<uint8_t> queueHead;
+    std::vector<uint8_t> type, rot;
+    std::vector<int32_t> posX, posY;
+    std::vector<int32_t> fallDelay, fallElapsed;
+    std::vector<int32_t> score, combo;
+    std::vector<uint32_t> random;
+    std::vector<uint8_t> over;
+
+    /// Scheme rows as bit masks with scheme column `col` stored in bit `col`.
+    uint8_t shapes[TYPES][ROTATIONS][MAX_SCHEME_LEN];
+
+    /**
+     * @brief Read the tetrimino schemes into `shapes`.
+     * @return `false` if the file could not be read.
+     */
+    bool load_shapes(const char *path);
+
+    void init(int numEnvs, uint32_t seed);
+
+    /// Clear the field and the score and spawn the first tetrimino.
+    void reset(int i);
+
+    /**
+     * @brief Spawn the next tetrimino from the queue.
+     * @return `true` if the tetrimino fits into the field.
+     */
+    bool spawn(int i);
+
+    /// Rotate by `dir` trying the wall kicks on collision.
+    void rotate(int i, int dir);
+
+    /// Shift by `dx` if it does not cause a collision.
+    void shift(int i, int dx);
+
+    /// Move down until a block or the floor is reached.
+    void drop(int i);
+
+    /**
+     * @brief Add the tetrimino to the field, clear lines, score and spawn.
+     * @return The score increase.
+     */
+    int release(int i);
+
+    /// Apply gravity for `dt` ms with `fallDelay` divided by `div`.
+    int fall(int i, int dt, int div);
+
+    /// Write the observation of game `i` to `obs`.
+    void write_obs(int i, uint8_t *obs) const;
+
+    /// Write outputs for game `i` and reset it if it is over.
+    void finish_step(int i, int reward, uint8_t *obs, float *rewards, uint8_t *dones);
+
+    /// Get the index of the first action outside of [0, `total`), or `-1` if none.
+    int find_invalid(const int32_t *actions, int total) const;
+};
+
+bool TetrisVecEnv::load_shapes (const char *path)
+{
+    std::ifstream fin(path);
+    if (fin.fail())
+    {
+        return false;
+    }
+    for (int t = 0; t < TYPES; ++t)
+    {
+        for (int r = 0; r < ROTATIONS; ++r)
+        {
+            for (int row = 0; row < MAX_SCHEME_LEN; ++row)
+            {
+                shapes[t][r][row] = 0;
+                for (int col = 0; col < MAX_SCHEME_LEN; ++col)
+                {
+                    int elem;
+                    fin >> elem;
+                    if (fin.fail())
+                    {
+                        return false;
+                    }
+                    if (elem)
+                    {
+                        shapes[t][r][row] |= 1 << col;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void TetrisVecEnv::init (int numEnvs, uint32_t seed)
+{
+    this->numEnvs = numEnvs;
+    rows.resize(numEnvs * H);
+    queue.resize(numEnvs * TETRIMINO_QUEUE_LEN);
+    queueHead.resize(numEnvs);
+    type.resize(numEnvs);
+    rot.resize(numEnvs);
+    posX.resize(numEnvs);
+    posY.resize(numEnvs);
+    fallDelay.resize(numEnvs);
+    fallElapsed.resize(numEnvs);
+    score.resize(numEnvs);
+    combo.resize(numEnvs);
+    random.resize(numEnvs);
+    over.resize(numEnvs);
+
+    for (int i = 0; i < numEnvs; ++i)
+    {
+        // Xorshift state must not be 0
+        random[i] = (seed + 1) * 2654435761u + i * 40503u;
+        if (!random[i])
+        {
+            random[i] = 1;
+        }
+        reset(i);
+    }
+}
+
+void TetrisVecEnv::reset (int i)
+{
+    uint32_t *field = &rows[i * H];
+    for (int row = 0; row < H; ++row)
+    {
+        field[row] = WALLS;
+    }
+    for (int j = 0; j < TETRIMINO_QUEUE_LEN; ++j)
+    {
+        queue[i * TETRIMINO_QUEUE_LEN + j] = random_config(random[i]);
+    }
+    queueHead[i] = 0;
+    fallDelay[i] = TETRIMINO_INITIAL_FALL_DELAY;
+    score[i] = combo[i] = 0;
+    over[i] = !spawn(i);
+}
+
+bool TetrisVecEnv::spawn (int i)
+{
+    uint8_t &head = queueHead[i];
+    uint8_t &config = queue[i * TETRIMINO_QUEUE_LEN + head];
+    type[i] = config & 0xF;
+    rot[i] = config >> 4;
+    config = random_config(random[i]);
+    head = (head + 1) % TETRIMINO_QUEUE_LEN;
+
+    posX[i] = SPAWN_X;
+    posY[i] = 0;
+    fallElapsed[i] = 0;
+
+    return !collides(&rows[i * H], shapes[type[i]][rot[i]], posX[i], posY[i]);
+}
+
+void TetrisVecEnv::rotate (int i, int dir)
+{
+    const uint32_t *field = &rows[i * H];
+    int newRot = (rot[i] + dir + ROTATIONS) % ROTATIONS;
+    const uint8_t *shape = shapes[type[i]][newRot];
+
+    if (!collides(field, shape, posX[i], posY[i]))
+    {
+        rot[i] = newRot;
+        return;
+    }
+    for (const int *kick : KICKS)
+    {
+        if (!collides(field, shape, posX[i] + kick[0], posY[i] + kick[1]))
+        {
+            posX[i] += kick[0];
+            posY[i] += kick[1];
+            rot[i] = newRot;
+            return;
+        }
+    }
+}
+
+void TetrisVecEnv::shift (int i, int dx)
+{
+    if (!collides(&rows[i * H], shapes[type[i]][rot[i]], posX[i] + dx, posY[i]))
+    {
+        posX[i] += dx;
+    }
+}
+
+void TetrisVecEnv::drop (int i)
+{
+    const uint32_t *field = &rows[i * H];
+    const uint8_t *shape = shapes[type[i]][rot[i]];
+    while (!collides(field, shape, posX[i], posY[i] + 1))
+    {
+        ++posY[i];
+    }
+}
+
+int TetrisVecEnv::release (int i)
+{
+    uint32_t *field = &rows[i * H];
+    const uint8_t *shape = shapes[type[i]][rot[i]];
+    for (int row = 0; row < MAX_SCHEME_LEN; ++row)
+    {
+        if (shape[row])
+        {
+            field[posY[i] + row] |= uint32_t(shape[row]) << (posX[i] + PAD);
+        }
+    }
+
+    // Compact the rows from the bottom skipping the filled ones
+    int cleared = 0;
+    for (int row = H - 1; row >= 0; --row)
+    {
+        if (field[row] == FULL_ROW)
+        {
+            ++cleared;
+        }
+        else if (cleared)
+        {
+            field[row + cleared] = field[row];
+        }
+    }
+    for (int row = 0; row < cleared; ++row)
+    {
+        field[row] = WALLS;
+    }
+
+    // Same scoring as `TetrisLayout::manage_score`
+    int reward = 0;
+    if (cleared)
+    {
+        reward = cleared * TETRIS_SCORE_LINE + combo[i] * TETRIS_SCORE_COMBO;
+        if (cleared == 4)
+        {
+            reward += TETRIS_SCORE_TETRIS;
+        }
+        ++combo[i];
+    }
+    else
+    {
+        combo[i] = 0;
+    }
+    score[i] += reward;
+
+    if (--fallDelay[i] < TETRIMINO_MIN_FALL_DELAY)
+    {
+        fallDelay[i] = TETRIMINO_MIN_FALL_DELAY;
+    }
+
+    over[i] = !spawn(i);
+
+    return reward;
+}
+
+int TetrisVecEnv::fall (int i, int dt, int div)
+{
+    int delay = fallDelay[i] / div;
+    fallElapsed[i] += dt;
+    if (fallElapsed[i] >= delay)
+    {
+        fallElapsed[i] -= delay;
+        if (collides(&rows[i * H], shapes[type[i]][rot[i]], posX[i], posY[i] + 1))
+        {
+            return release(i);
+        }
+        ++posY[i];
+    }
+    return 0;
+}
+
+void TetrisVecEnv::write_obs (int i, uint8_t *obs) const
+{
+    const uint32_t *field = &rows[i * H];
+    for (int row = 0; row < H; ++row)
+    {
+        uint32_t mask = field[row] >> PAD;
+        for (int col = 0; col < W; ++col)
+        {
+            obs[row * W + col] = (mask >> col) & 1;
+        }
+    }
+
+    const uint8_t *shape = shapes[type[i]][rot[i]];
+    for (int row = 0; row < MAX_SCHEME_LEN; ++row)
+    {
+        for (int col = 0; col < MAX_SCHEME_LEN; ++col)
+        {
+            if (shape[row] >> col & 1)
+            {
+                obs[(posY[i] + row) * W + posX[i] + col] = 2;
+            }
+        }
+    }
+
+    obs += W * H;
+    *obs++ = type[i];
+    *obs++ = rot[i];
+    for (int j = 0; j < TETRIMINO_QUEUE_LEN; ++j)
+    {
+        *obs++ = queue[
+            i * TETRIMINO_QUEUE_LEN + (queueHead[i] + j) % TETRIMINO_QUEUE_LEN
+        ] & 0xF;
+    }
+}
+
+void TetrisVecEnv::finish_step (
+    int i, int reward, uint8_t *obs, float *rewards, uint8_t *dones
+)
+{
+    if (rewards != NULL)
+    {
+        rewards[i] = float(reward);
+    }
+    if (dones != NULL)
+    {
+        dones[i] = over[i];
+    }
+    if (over[i])
+    {
+        reset(i);
+    }
+    if (obs != NULL)
+    {
+        write_obs(i, obs + i * OBS_SIZE);
+    }
+}
+
+int TetrisVecEnv::find_invalid (const int32_t *actions, int total) const
+{
+    for (int i = 0; i < numEnvs; ++i)
+    {
+        if (actions[i] < 0 || actions[i] >= total)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+TetrisVecEnv *tetris_venv_create (int numEnvs, const char *schemesPath, uint32_t seed)
+{
+    if (numEnvs <= 0)
+    {
+        return NULL;
+    }
+    TetrisVecEnv *env = new TetrisVecEnv;
+    if (!env->load_shapes(schemesPath))
+    {
+        delete env;
+        return NULL;
+    }
+    env->init(numEnvs, seed);
+    return env;
+}
+
+void tetris_venv_free (TetrisVecEnv *env)
+{
+    delete env;
+}
+
+int tetris_venv_num_envs (const TetrisVecEnv *env)
+{
+    return env->numEnvs;
+}
+
+int tetris_venv_obs_size ()
+{
+    return OBS_SIZE;
+}
+
+int tetris_venv_placement_actions ()
+{
+    return ROTATIONS * COLUMNS;
+}
+
+void tetris_venv_reset (TetrisVecEnv *env, uint8_t *obs)
+{
+    for (int i = 0; i < env->numEnvs; ++i)
+    {
+        env->reset(i);
+        if (obs != NULL)
+        {
+            env->write_obs(i, obs + i * OBS_SIZE);
+        }
+    }
+}
+
+int tetris_venv_step_placement (
+    TetrisVecEnv *env, const int32_t *actions,
+    uint8_t *obs, float *rewards, uint8_t *dones
+)
+{
+    int invalid = env->find_invalid(actions, ROTATIONS * COLUMNS);
+    if (invalid != -1)
+    {
+        return invalid;
+    }
+    for (int i = 0; i < env->numEnvs; ++i)
+    {
+        int newRot = actions[i] / COLUMNS;
+        int newX = actions[i] % COLUMNS - (MAX_SCHEME_LEN - 1);
+        if (
+            !collides(
+                &env->rows[i * H], env->shapes[env->type[i]][newRot], newX,
+                env->posY[i]
+            )
+        )
+        {
+            env->rot[i] = newRot;
+            env->posX[i] = newX;
+        }
+        env->drop(i);
+        env->finish_step(i, env->release(i), obs, rewards, dones);
+    }
+    return -1;
+}
+
+int tetris_venv_step_tick (
+    TetrisVecEnv *env, const int32_t *actions, int dt,
+    uint8_t *obs, float *rewards, uint8_t *dones
+)
+{
+    int invalid = env->find_invalid(actions, TETRIS_VENV_TICK_ACTIONS_TOTAL);
+    if (invalid != -1)
+    {
+        return invalid;
+    }
+    for (int i = 0; i < env->numEnvs; ++i)
+    {
+        int reward = 0, div = 1;
+        switch (actions[i])
+        {
+        case TETRIS_VENV_RIGHT:
+            env->shift(i, 1);
+            break;
+        case TETRIS_VENV_LEFT:
+            env->shift(i, -1);
+            break;
+        case TETRIS_VENV_ACC:
+            div = TETRIMINO_DROP_ACC;
+            break;
+        case TETRIS_VENV_DROP:
+            env->drop(i);
+            reward = env->release(i);
+            break;
+        case TETRIS_VENV_ROT_CCW:
+            env->rotate(i, 1);
+            break;
+        case TETRIS_VENV_ROT_CW:
+            env->rotate(i, -1);
+            break;
+        }
+        if (actions[i] != TETRIS_VENV_DROP)
+        {
+            reward = env->fall(i, dt, div);
+        }
+        env->finish_step(i, reward, obs, rewards, dones);
+    }
+    return -1;
+}
+
+int tetris_venv_score (const TetrisVecEnv *env, int index)
+{
+    if (index < 0 || index >= env->numEnvs)
+    {
+        return -1;
+    }
+    return env->score[index];
+}
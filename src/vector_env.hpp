@@ -0,0 +1,141 @@
+/**
+ * @file  vector_env.hpp
+ * @brief C interface for stepping many independent tetris games at once.
+ */
+
+#ifndef VECTOR_ENV_HPP
+#define VECTOR_ENV_HPP
+
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A batch of independent tetris games stored as structure of arrays.
+ * @details
+ * The games follow the rules of `TetrisField` and `Tetrimino`: the same schemes,
+ * spawn position, wall kicks, gravity, scoring and fall delay acceleration. There
+ * is no swapping. A game that reaches game over is reported as done and is reset
+ * automatically on the same call.
+ * @example
+ *
+ *     TetrisVecEnv *env = tetris_venv_create(4096, "schemes.txt", 1);
+ *     uint8_t *obs = malloc(4096 * tetris_venv_obs_size());
+ *     float *rewards = malloc(4096 * sizeof(float));
+ *     uint8_t *dones = malloc(4096);
+ *     tetris_venv_reset(env, obs);
+ *     while (training)
+ *     {
+ *         // actions[i] is in [0, tetris_venv_placement_actions())
+ *         if (tetris_venv_step_placement(env, actions, obs, rewards, dones) != -1)
+ *         {
+ *             // An action was out of range
+ *         }
+ *     }
+ *     tetris_venv_free(env);
+ */
+typedef struct TetrisVecEnv TetrisVecEnv;
+
+/// Per tick actions for `tetris_venv_step_tick`.
+enum TetrisVecEnvTickAction {
+    TETRIS_VENV_NONE, // Only apply gravity.
+    TETRIS_VENV_RIGHT, // Shift one cell to the right.
+    TETRIS_VENV_LEFT, // Shift one cell to the left.
+    TETRIS_VENV_ACC, // Fall with accelerated speed during this tick.
+    TETRIS_VENV_DROP, // Drop and release the tetrimino.
+    TETRIS_VENV_ROT_CCW, // Rotate counter-clockwise.
+    TETRIS_VENV_ROT_CW, // Rotate clockwise.
+    TETRIS_VENV_TICK_ACTIONS_TOTAL,
+};
+
+/**
+ * @brief Create `numEnvs` games.
+ * @param numEnvs Amount of games.
+ * @param schemesPath Path to the tetrimino schemes file.
+ * @param seed Seed for the per game random generators.
+ * @return The environment or `NULL` if `schemesPath` could not be read.
+ */
+TetrisVecEnv *tetris_venv_create(int numEnvs, const char *schemesPath, uint32_t seed);
+
+/// Free the environment.
+void tetris_venv_free(TetrisVecEnv *env);
+
+/// Get the amount of games.
+int tetris_venv_num_envs(const TetrisVecEnv *env);
+
+/**
+ * @brief Get the amount of bytes in a single game observation.
+ * @details
+ * An observation is the field row by row, top to bottom, with `0` for empty cells,
+ * `1` for field blocks and `2` for the current tetrimino blocks, followed by the
+ * current tetrimino type and rotation, followed by the types of the pending
+ * tetriminos from the next one on.
+ */
+int tetris_venv_obs_size(void);
+
+/**
+ * @brief Get the amount of placement actions.
+ * @details
+ * Action `a` places the tetrimino with rotation `a / columns` with its scheme left
+ * column at field column `a % columns - 3`, where `columns` is the field width + 3.
+ */
+int tetris_venv_placement_actions(void);
+
+/**
+ * @brief Restart all games and write their observations.
+ * @param env The environment.
+ * @param obs Output buffer of `numEnvs * tetris_venv_obs_size()` bytes; `NULL` to
+ *     skip writing.
+ */
+void tetris_venv_reset(TetrisVecEnv *env, uint8_t *obs);
+
+/**
+ * @brief Place the current tetrimino in every game.
+ * @details
+ * The tetrimino is moved to the position selected by the action at its current
+ * height, dropped and released. If the position collides with field blocks, the
+ * tetrimino is dropped from its current position instead.
+ * @param env The environment.
+ * @param actions `numEnvs` placement actions.
+ * @param obs Output buffer of `numEnvs * tetris_venv_obs_size()` bytes; `NULL` to
+ *     skip writing.
+ * @param rewards Output buffer of `numEnvs` score increases; `NULL` to skip.
+ * @param dones Output buffer of `numEnvs` game over flags; `NULL` to skip.
+ * @return `-1` on success, otherwise the index of the first action outside of
+ *     [0, `tetris_venv_placement_actions()`), in which case no game is stepped.
+ */
+int tetris_venv_step_placement(
+    TetrisVecEnv *env, const int32_t *actions,
+    uint8_t *obs, float *rewards, uint8_t *dones
+);
+
+/**
+ * @brief Apply one `TetrisVecEnvTickAction` and `dt` ms of gravity in every game.
+ * @param env The environment.
+ * @param actions `numEnvs` tick actions.
+ * @param dt Tick duration in ms.
+ * @param obs Output buffer of `numEnvs * tetris_venv_obs_size()` bytes; `NULL` to
+ *     skip writing.
+ * @param rewards Output buffer of `numEnvs` score increases; `NULL` to skip.
+ * @param dones Output buffer of `numEnvs` game over flags; `NULL` to skip.
+ * @return `-1` on success, otherwise the index of the first action that is not a
+ *     `TetrisVecEnvTickAction`, in which case no game is stepped.
+ */
+int tetris_venv_step_tick(
+    TetrisVecEnv *env, const int32_t *actions, int dt,
+    uint8_t *obs, float *rewards, uint8_t *dones
+);
+
+/// Get the current score of the game with index `index`, or `-1` if out of range.
+int tetris_venv_score(const TetrisVecEnv *env, int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -9,6 +9,8 @@
 #include "exceptions.hpp"
 #include "logger.hpp"
 
+#include <cstring>
+
 
 KeyMap Window::keyMap{
     {
@@ -20,7 +22,7 @@ KeyMap Window::keyMap{
 
 void Window::init (Game &game)
 {
-    log("Initializing Window", __FILE__, __LINE__);
+    LOG_INFO("Initializing Window");
 
     window = SDL_CreateWindow(
         "Tetris",
@@ -45,7 +47,7 @@ void Window::init (Game &game)
 
 void Window::free ()
 {
-    log("Freeing window", __FILE__, __LINE__);
+    LOG_INFO("Freeing window");
     
     if (window != NULL)
     {
@@ -54,11 +56,20 @@ void Window::free ()
     }
 }
 
-SDL_Renderer *Window::create_renderer ()
+SDL_Renderer *Window::create_renderer (bool vsync)
 {
-    SDL_Renderer *renderer = SDL_CreateRenderer(
-        window, -1, SDL_RENDERER_ACCELERATED// | SDL_RENDERER_PRESENTVSYNC
-    );
+    // The dummy video driver of headless runs only has the software renderer
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    const char *driver = SDL_GetCurrentVideoDriver();
+    if (driver != NULL && strcmp(driver, "dummy") == 0)
+    {
+        flags = SDL_RENDERER_SOFTWARE;
+    }
+    if (vsync)
+    {
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, flags);
     if (renderer == NULL)
     {
         throw ExceptionSDL(__FILE__, __LINE__, SDL_GetError());
@@ -146,6 +157,16 @@ int Window::get_height () const
     return h;
 }
 
+int Window::get_refresh_rate () const
+{
+    SDL_DisplayMode mode;
+    if (SDL_GetWindowDisplayMode(window, &mode) < 0)
+    {
+        return 0;
+    }
+    return mode.refresh_rate;
+}
+
 bool Window::has_mouse_focus() const
 {
     return mouseFocus;
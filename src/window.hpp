@@ -34,10 +34,11 @@ public:
 
     /**
      * @brief Create an SDL renderer attached to the window.
+     * @param vsync `true` to synchronize presenting with the display refresh.
      * @return A pointer to the created renderer.
      * @throws `ExceptionSDL` thrown if the renderer could not be created.
      */
-    SDL_Renderer *create_renderer();
+    SDL_Renderer *create_renderer(bool vsync=false);
 
     /**
      * @brief Handle SDL window events.
@@ -52,6 +53,9 @@ public:
 
     /// Get window height.
     int get_height() const;
+
+    /// Get the refresh rate of the display the window is on; `0` if unknown.
+    int get_refresh_rate() const;
     
     bool has_mouse_focus() const;
     bool has_keyboard_focus() const;
@@ -0,0 +1,257 @@
+/**
+ * @file  log_decode.cpp
+ * @brief Offline decoder turning binary logs into the text log format.
+ * @details
+ * Usage: `log_decode [log.bin] [out.txt]`. The output defaults to the standard
+ * output. Binary logs are written by games built with `-DLOG_BINARY`; see
+ * `LogRecordKind` for the record layout.
+ */
+
+#include "logger.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// A call site read from a definition record.
+struct Definition
+{
+    int level;
+    int line;
+    std::string file;
+    std::string format;
+};
+
+/// Bounds checked reader of a single record.
+class RecordReader
+{
+public:
+    RecordReader (const char *data, size_t len)
+        : data(data)
+        , left(len)
+    {}
+
+    template <typename T>
+    bool read (T &value)
+    {
+        return read_bytes(&value, sizeof(value));
+    }
+
+    bool read_string (std::string &value)
+    {
+        uint16_t len;
+        if (!read(len) || len > left)
+        {
+            return false;
+        }
+        value.assign(data, len);
+        data += len;
+        left -= len;
+        return true;
+    }
+
+private:
+    bool read_bytes (void *value, size_t len)
+    {
+        if (len > left)
+        {
+            return false;
+        }
+        memcpy(value, data, len);
+        data += len;
+        left -= len;
+        return true;
+    }
+
+    const char *data;
+    size_t left;
+};
+
+
+/// Read the next argument and format it, `false` if the record has no more.
+static bool read_arg (RecordReader &reader, std::string &text)
+{
+    uint8_t tag;
+    if (!reader.read(tag))
+    {
+        return false;
+    }
+
+    char buf[32];
+    switch (tag)
+    {
+        case LOG_ARG_INT:
+        {
+            int64_t value;
+            if (!reader.read(value))
+            {
+                return false;
+            }
+            snprintf(buf, sizeof(buf), "%lld", (long long)value);
+            text = buf;
+            return true;
+        }
+        case LOG_ARG_UINT:
+        {
+            uint64_t value;
+            if (!reader.read(value))
+            {
+                return false;
+            }
+            snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+            text = buf;
+            return true;
+        }
+        case LOG_ARG_DOUBLE:
+        {
+            double value;
+            if (!reader.read(value))
+            {
+                return false;
+            }
+            snprintf(buf, sizeof(buf), "%g", value);
+            text = buf;
+            return true;
+        }
+        case LOG_ARG_STRING:
+            return reader.read_string(text);
+        default:
+            return false;
+    }
+}
+
+/// Format a message record like the text logger does.
+static std::string format_message (
+    const Definition &definition, RecordReader &reader
+)
+{
+    std::string msg = definition.file + "\t" + std::to_string(definition.line)
+        + ": \t[" + get_log_level_name(definition.level) + "] ";
+
+    // Placeholders of arguments which did not fit the record are kept as is
+    const std::string &format = definition.format;
+    size_t pos = 0, placeholder;
+    std::string arg;
+    while (
+        (placeholder = format.find("{}", pos)) != std::string::npos
+        && read_arg(reader, arg)
+    )
+    {
+        msg += format.substr(pos, placeholder - pos) + arg;
+        pos = placeholder + 2;
+    }
+    msg += format.substr(pos);
+    while (read_arg(reader, arg))
+    {
+        msg += arg;
+    }
+    return msg + "\n";
+}
+
+
+int main (int argc, char **argv)
+{
+    const char *inPath = argc > 1 ? argv[1] : "log.bin";
+    std::ifstream fin(inPath, std::ios::binary);
+    if (fin.fail())
+    {
+        printf("Could not open \"%s\"\n", inPath);
+        return 1;
+    }
+    std::vector<char> data(
+        (std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>()
+    );
+
+    std::ofstream fout;
+    if (argc > 2)
+    {
+        fout.open(argv[2]);
+        if (fout.fail())
+        {
+            printf("Could not open \"%s\"\n", argv[2]);
+            return 1;
+        }
+    }
+    std::ostream &out = argc > 2 ? fout : std::cout;
+
+    // Split into records. Definitions are collected first, because a message may
+    // be stored before the definition of its site when threads race
+    std::vector<RecordReader> records;
+    std::map<uint32_t, Definition> definitions;
+    size_t pos = 0;
+    while (pos + sizeof(uint16_t) <= data.size())
+    {
+        uint16_t len;
+        memcpy(&len, &data[pos], sizeof(len));
+        if (len <= sizeof(len) || pos + len > data.size())
+        {
+            printf("Corrupted record at byte %zu, stopping\n", pos);
+            break;
+        }
+        RecordReader reader(&data[pos + sizeof(len)], len - sizeof(len));
+        uint8_t kind;
+        reader.read(kind);
+        if (kind == LOG_RECORD_DEFINITION)
+        {
+            uint32_t id;
+            uint8_t level;
+            int32_t line;
+            Definition definition;
+            if (
+                reader.read(id) && reader.read(level) && reader.read(line)
+                && reader.read_string(definition.file)
+                && reader.read_string(definition.format)
+            )
+            {
+                definition.level = level;
+                definition.line = line;
+                definitions[id] = definition;
+            }
+        }
+        else
+        {
+            records.push_back(
+                RecordReader(&data[pos + sizeof(len)], len - sizeof(len))
+            );
+        }
+        pos += len;
+    }
+
+    for (RecordReader &reader : records)
+    {
+        uint8_t kind;
+        uint32_t value;
+        reader.read(kind);
+        if (!reader.read(value))
+        {
+            continue;
+        }
+
+        if (kind == LOG_RECORD_DROPPED)
+        {
+            out << "[WARNING] " << value
+                << " log messages dropped: the log buffer was full\n";
+        }
+        else if (kind == LOG_RECORD_MESSAGE)
+        {
+            auto definition = definitions.find(value);
+            if (definition == definitions.end())
+            {
+                out << "[WARNING] Message of unknown call site " << value << "\n";
+            }
+            else
+            {
+                out << format_message(definition->second, reader);
+            }
+        }
+    }
+
+    return out.fail() ? 1 : 0;
+}
@@ -0,0 +1,463 @@
+/**
+ * @file  perf_fuzz.cpp
+ * @brief Fuzzer searching for replays with the slowest ticks and frames.
+ * @details
+ * Usage: `perf_fuzz [--runs <amount>] [--ticks <amount>] [--seed <seed>]
+ * [--out <dir>]` or `perf_fuzz --replay <path>`.
+ *
+ * Generates replays biased towards expensive gameplay: multi-line clears which
+ * start many particle emitters, rotation chains kicking against walls and stacks,
+ * and rapid swaps. The replays are run headlessly by `ReplayRunner`; the ones with
+ * the slowest tick and the slowest frame are kept and mutated further. At the end,
+ * the kept replays are minimized and written to `<out>/tick_<rank>.replay` and
+ * `<out>/frame_<rank>.replay`, by default to `perf_fuzz/`.
+ *
+ * With `--replay`, runs a single replay and prints its slowest tick and frame and
+ * the checksum of the final layout.
+ * Has to be run from the game directory as it loads the game assets.
+ */
+
+#include "replay.hpp"
+#include "replay_runner.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+
+/// Amount of runs whose per tick minimum is taken to filter out noise.
+constexpr int MEASURE_REPS = 3;
+
+/// Amount of replays kept for each objective.
+constexpr int CORPUS_LEN = 4;
+
+/// Minimization keeps removals that leave at least this fraction of the cost.
+constexpr double MINIMIZE_KEEP = 0.9;
+
+/// Maximum amount of candidate replays measured while minimizing a replay.
+constexpr int MINIMIZE_RUNS_MAX = 150;
+
+/// What to make slow.
+enum Objective {
+    TICK, // Event handling and logic of a single tick.
+    FRAME, // A whole frame, including rendering.
+    OBJECTIVES_TOTAL,
+};
+
+static const char *OBJECTIVE_NAMES[OBJECTIVES_TOTAL] = {"tick", "frame"};
+
+/// Kinds of input the generator is biased towards.
+enum Strategy {
+    CLEARS, // Place tetriminos all over the field to clear lines.
+    KICKS, // Rotate while pushing against walls and stacks.
+    SWAPS, // Swap as often as possible.
+    STRATEGIES_TOTAL,
+};
+
+/// Worst costs of a replay, each with its tick.
+struct Cost
+{
+    double ns[OBJECTIVES_TOTAL];
+    int tick[OBJECTIVES_TOTAL];
+};
+
+/// A replay kept by the fuzzer.
+struct Case
+{
+    Replay replay;
+    Cost cost;
+};
+
+
+static std::mt19937 rng;
+static ReplayStats stats;
+
+
+/// Get a random integer in [`min`, `max`].
+static int random_int (int min, int max)
+{
+    return min + rng() % (max - min + 1);
+}
+
+/// Add a press of `key` on `tick` released `hold` ticks later.
+static void press (Replay &replay, int tick, SDL_Keycode key, int hold=1)
+{
+    replay.events.push_back({tick, true, key});
+    replay.events.push_back({tick + hold, false, key});
+}
+
+/**
+ * @brief Add input of `strategy` from `tick` on.
+ * @return The tick after the added input.
+ */
+static int add_burst (Replay &replay, Strategy strategy, int tick)
+{
+    SDL_Keycode side = rng() % 2 ? SDLK_LEFT : SDLK_RIGHT;
+    SDL_Keycode rotation = rng() % 2 ? SDLK_q : SDLK_e;
+    switch (strategy)
+    {
+    case CLEARS:
+        // Tap the tetrimino to a random column and drop it; side keys shift a cell
+        // on press, holding them is much slower
+        if (rng() % 2)
+        {
+            press(replay, tick, rotation);
+            tick += 2;
+        }
+        for (int taps = random_int(0, TETRIS_FIELD_WIDTH / 2); taps > 0; --taps)
+        {
+            press(replay, tick, side);
+            tick += 2;
+        }
+        press(replay, tick, SDLK_UP);
+        return tick + random_int(2, 6);
+    case KICKS:
+    {
+        // Keep pushing against the wall or the stack and rotate every few ticks,
+        // sometimes back
+        int hold = random_int(10, 60);
+        SDL_Keycode back = rotation == SDLK_q ? SDLK_e : SDLK_q;
+        press(replay, tick, side, hold);
+        for (int t = tick + 1; t < tick + hold; t += random_int(1, 3))
+        {
+            press(replay, t, rng() % 4 ? rotation : back);
+        }
+        if (rng() % 2)
+        {
+            press(replay, tick + hold, SDLK_UP);
+        }
+        return tick + hold + 2;
+    }
+    case SWAPS:
+        for (int swaps = random_int(1, 8); swaps > 0; --swaps)
+        {
+            press(replay, tick, SDLK_SPACE);
+            tick += random_int(1, 3);
+        }
+        if (rng() % 3 == 0)
+        {
+            press(replay, tick, SDLK_UP);
+            tick += 2;
+        }
+        return tick;
+    default:
+        return tick + 1;
+    }
+}
+
+static void sort_events (Replay &replay)
+{
+    std::stable_sort(
+        replay.events.begin(), replay.events.end(),
+        [](const ReplayEvent &a, const ReplayEvent &b){ return a.tick < b.tick; }
+    );
+}
+
+/// Generate a replay of `ticks` ticks with input of `strategy`.
+static Replay generate (Strategy strategy, int ticks)
+{
+    Replay replay;
+    replay.seed = rng();
+    replay.ticks = ticks;
+    for (int tick = 0; tick < ticks; )
+    {
+        tick = add_burst(replay, strategy, tick);
+    }
+    sort_events(replay);
+    return replay;
+}
+
+/// Apply a random mutation to `replay`.
+static void mutate (Replay &replay)
+{
+    std::vector<ReplayEvent> &events = replay.events;
+    switch (events.empty() ? 0 : rng() % 4)
+    {
+    case 0:
+    {
+        // Add input of a random strategy
+        int tick = random_int(0, replay.ticks - 1);
+        add_burst(replay, Strategy(rng() % STRATEGIES_TOTAL), tick);
+        break;
+    }
+    case 1:
+    {
+        // Remove a range of events
+        size_t begin = rng() % events.size();
+        size_t end = std::min(events.size(), begin + random_int(1, 16));
+        events.erase(events.begin() + begin, events.begin() + end);
+        break;
+    }
+    case 2:
+        // Move an event
+        events[rng() % events.size()].tick += random_int(-8, 8);
+        break;
+    case 3:
+        // Play the same input with other tetriminos
+        replay.seed = rng();
+        break;
+    }
+
+    events.erase(
+        std::remove_if(
+            events.begin(), events.end(),
+            [&replay](const ReplayEvent &event){
+                return event.tick < 0 || event.tick >= replay.ticks;
+            }
+        ),
+        events.end()
+    );
+    sort_events(replay);
+}
+
+/// Get the worst tick and frame of `replay` over `reps` runs.
+static Cost measure (const Replay &replay, int reps)
+{
+    // The minimum of each tick over the runs filters out preemptions and the like
+    std::vector<double> minNs[OBJECTIVES_TOTAL];
+    for (int rep = 0; rep < reps; ++rep)
+    {
+        ReplayRunner::run(replay, stats);
+        const std::vector<double> *ns[OBJECTIVES_TOTAL] = {
+            &stats.tickNs, &stats.frameNs
+        };
+        for (int obj = 0; obj < OBJECTIVES_TOTAL; ++obj)
+        {
+            if (rep == 0)
+            {
+                minNs[obj] = *ns[obj];
+            }
+            for (size_t tick = 0; tick < minNs[obj].size(); ++tick)
+            {
+                minNs[obj][tick] = std::min(minNs[obj][tick], (*ns[obj])[tick]);
+            }
+        }
+    }
+
+    Cost cost;
+    for (int obj = 0; obj < OBJECTIVES_TOTAL; ++obj)
+    {
+        auto worst = std::max_element(minNs[obj].begin(), minNs[obj].end());
+        cost.ns[obj] = worst == minNs[obj].end() ? 0 : *worst;
+        cost.tick[obj] = worst - minNs[obj].begin();
+    }
+    return cost;
+}
+
+/// Keep `candidate` in `corpus` if it is among the worst for `obj`.
+static bool keep (std::vector<Case> &corpus, const Case &candidate, Objective obj)
+{
+    if (
+        corpus.size() == CORPUS_LEN
+        && candidate.cost.ns[obj] <= corpus.back().cost.ns[obj]
+    )
+    {
+        return false;
+    }
+    if (corpus.size() == CORPUS_LEN)
+    {
+        corpus.pop_back();
+    }
+    corpus.push_back(candidate);
+    std::stable_sort(
+        corpus.begin(), corpus.end(),
+        [obj](const Case &a, const Case &b){ return a.cost.ns[obj] > b.cost.ns[obj]; }
+    );
+    return true;
+}
+
+/// Drop the ticks after the worst one for `obj`, including their events.
+static void truncate (Case &c, Objective obj)
+{
+    c.replay.ticks = c.cost.tick[obj] + 1;
+    c.replay.events.erase(
+        std::remove_if(
+            c.replay.events.begin(), c.replay.events.end(),
+            [&c](const ReplayEvent &event){ return event.tick >= c.replay.ticks; }
+        ),
+        c.replay.events.end()
+    );
+}
+
+/// Remove as many events of `c` as possible while keeping its cost for `obj`.
+static void minimize (Case &c, Objective obj)
+{
+    double target = c.cost.ns[obj] * MINIMIZE_KEEP;
+    truncate(c, obj);
+
+    // Remove chunks of events, halving the chunk size whenever none can be removed
+    int runs = 0;
+    size_t chunk = std::max<size_t>(1, c.replay.events.size() / 2);
+    while (chunk > 0 && runs < MINIMIZE_RUNS_MAX)
+    {
+        bool removed = false;
+        for (
+            size_t begin = 0;
+            begin < c.replay.events.size() && runs < MINIMIZE_RUNS_MAX;
+        )
+        {
+            Case candidate = c;
+            std::vector<ReplayEvent> &events = candidate.replay.events;
+            events.erase(
+                events.begin() + begin,
+                events.begin() + std::min(events.size(), begin + chunk)
+            );
+            candidate.cost = measure(candidate.replay, MEASURE_REPS);
+            ++runs;
+            if (candidate.cost.ns[obj] >= target)
+            {
+                c = candidate;
+                truncate(c, obj);
+                removed = true;
+            }
+            else
+            {
+                begin += chunk;
+            }
+        }
+        if (!removed)
+        {
+            chunk /= 2;
+        }
+    }
+}
+
+static void print_cost (const char *name, const Case &c)
+{
+    printf(
+        "%-24s tick %8.1f us at %5d  frame %8.1f us at %5d  %zu events\n",
+        name, c.cost.ns[TICK] / 1e3, c.cost.tick[TICK],
+        c.cost.ns[FRAME] / 1e3, c.cost.tick[FRAME], c.replay.events.size()
+    );
+}
+
+
+int main (int argc, char *argv[])
+{
+    int runs = 200, ticks = 1800;
+    Uint32 seed = 1;
+    std::string outDir = "perf_fuzz", replayPath = "";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--runs") == 0)
+        {
+            runs = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (strcmp(argv[i], "--ticks") == 0)
+        {
+            ticks = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--out") == 0)
+        {
+            outDir = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--replay") == 0)
+        {
+            replayPath = argv[i + 1];
+        }
+    }
+
+    int exitCode = 0;
+    try
+    {
+        Logger::get()->init("perf_fuzz_log.txt");
+        ReplayRunner::init();
+
+        if (!replayPath.empty())
+        {
+            Case c;
+            c.replay.load(replayPath);
+            c.cost = measure(c.replay, MEASURE_REPS);
+            print_cost(replayPath.c_str(), c);
+            printf(
+                "%d ticks run%s, checksum %08x\n", stats.ticksRun,
+                stats.gameOver ? " until the game over" : "", stats.checksum
+            );
+        }
+        else
+        {
+            rng.seed(seed);
+            std::vector<Case> corpus[OBJECTIVES_TOTAL];
+            for (int run = 0; run < runs; ++run)
+            {
+                Case c;
+                bool fresh = corpus[TICK].empty() || rng() % 2;
+                if (fresh)
+                {
+                    c.replay = generate(Strategy(run % STRATEGIES_TOTAL), ticks);
+                }
+                else
+                {
+                    std::vector<Case> &parents = corpus[rng() % OBJECTIVES_TOTAL];
+                    c.replay = parents[rng() % parents.size()].replay;
+                    mutate(c.replay);
+                }
+
+                // Only candidates that look slow on a single run are measured well
+                c.cost = measure(c.replay, 1);
+                bool slow = false;
+                for (int obj = 0; obj < OBJECTIVES_TOTAL; ++obj)
+                {
+                    slow = slow || corpus[obj].size() < CORPUS_LEN
+                        || c.cost.ns[obj] > corpus[obj].back().cost.ns[obj];
+                }
+                if (!slow)
+                {
+                    continue;
+                }
+                c.cost = measure(c.replay, MEASURE_REPS);
+                for (int obj = 0; obj < OBJECTIVES_TOTAL; ++obj)
+                {
+                    if (keep(corpus[obj], c, Objective(obj)))
+                    {
+                        std::string name = "run " + std::to_string(run) + " "
+                            + OBJECTIVE_NAMES[obj];
+                        print_cost(name.c_str(), c);
+                    }
+                }
+            }
+
+            std::filesystem::create_directories(outDir);
+            for (int obj = 0; obj < OBJECTIVES_TOTAL; ++obj)
+            {
+                for (size_t rank = 0; rank < corpus[obj].size(); ++rank)
+                {
+                    Case &c = corpus[obj][rank];
+                    minimize(c, Objective(obj));
+                    std::string path = outDir + "/" + OBJECTIVE_NAMES[obj] + "_"
+                        + std::to_string(rank) + ".replay";
+                    c.replay.save(path);
+                    print_cost(path.c_str(), c);
+                }
+            }
+        }
+
+        ReplayRunner::free();
+    }
+    catch (const Exception &e)
+    {
+        printf("%s\n", e.what().c_str());
+        exitCode = e.get_exit_code();
+    }
+    catch (const std::exception &e)
+    {
+        printf("Standard exception: %s\n", e.what());
+        exitCode = -1;
+    }
+
+    Logger::get()->free();
+
+    return exitCode;
+}
@@ -0,0 +1,316 @@
+/**
+ * @file  replay_check.cpp
+ * @brief Regression gate replaying the replay corpus against stored baselines.
+ * @details
+ * Usage: `replay_check [--dir <dir>] [--reps <repetitions>] [--tolerance <fraction>]
+ * [--update]`.
+ *
+ * Runs every `*.replay` of the corpus, by default `replays/`, with `ReplayRunner`
+ * and without rendering, and compares the outcome with `<dir>/baselines.txt`:
+ * - The checksum of the final layout and the amount of ticks run must match
+ *     exactly, i.e. gameplay must be preserved bit for bit.
+ * - The allocations of a run must not exceed the baseline.
+ * - The throughput in ticks per second, taking the fastest repetition of each tick,
+ *     must not drop below the baseline by more than the tolerance, by default 15%.
+ *
+ * Prints a line per replay with the throughput change and exits with 1 if any
+ * check failed. With `--update`, writes the measured values as the new baselines
+ * instead. Throughput baselines depend on the machine, so they should be updated on
+ * the machine running the checks. Has to be run from the game directory as it
+ * loads the game assets.
+ */
+
+#include "replay.hpp"
+#include "replay_runner.hpp"
+#include "benchmark.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+
+/// Name of the baselines file in the corpus directory.
+constexpr const char *BASELINES_NAME = "baselines.txt";
+
+/// Default fraction the throughput may drop below its baseline.
+constexpr double DEFAULT_TOLERANCE = 0.15;
+
+/// Default amount of runs of each replay.
+constexpr int DEFAULT_REPS = 10;
+
+/// Outcome and costs of a replay, measured or stored as a baseline.
+struct Measurement
+{
+    std::string name; // File name of the replay.
+    Uint32 checksum;
+    int ticksRun;
+    long long allocs; // Fewest allocations of a run.
+    double ticksPerSec; // Throughput with the fastest run of each tick.
+};
+
+
+static ReplayStats stats;
+
+
+/**
+ * @brief Read the baselines from `path`.
+ * @return The baselines; none if `path` does not exist.
+ * @throws `ExceptionFile` thrown if `path` is malformed.
+ */
+static std::vector<Measurement> load_baselines (const std::string &path)
+{
+    std::vector<Measurement> baselines;
+    std::ifstream fin(path);
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(fin, line))
+    {
+        ++lineNum;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream sin(line);
+        Measurement baseline;
+        if (
+            !(sin >> baseline.name >> std::hex >> baseline.checksum >> std::dec
+                >> baseline.ticksRun >> baseline.allocs >> baseline.ticksPerSec)
+        )
+        {
+            std::string msg = "Malformed baselines \"" + path + "\" at line "
+                + std::to_string(lineNum);
+            throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+        }
+        baselines.push_back(baseline);
+    }
+    return baselines;
+}
+
+/**
+ * @brief Write `baselines` to `path`.
+ * @throws `ExceptionFile` thrown if `path` could not be written.
+ */
+static void save_baselines (
+    const std::string &path, const std::vector<Measurement> &baselines
+)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        std::string msg = "Could not open \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+    fprintf(file, "# replay checksum ticks_run allocs ticks_per_sec\n");
+    for (const Measurement &baseline : baselines)
+    {
+        fprintf(
+            file, "%s %08x %d %lld %.0f\n", baseline.name.c_str(),
+            baseline.checksum, baseline.ticksRun, baseline.allocs,
+            baseline.ticksPerSec
+        );
+    }
+    if (fclose(file) != 0)
+    {
+        std::string msg = "Could not write to \"" + path + "\"";
+        throw ExceptionFile(__FILE__, __LINE__, msg.c_str());
+    }
+}
+
+/// Run `replay` `reps` times without rendering.
+static Measurement measure (const std::string &name, const Replay &replay, int reps)
+{
+    Measurement result{name, 0, 0, -1, 0};
+    std::vector<double> minNs;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+        // The first run may still grow the buffers of the stats
+        long long allocsStart = process_alloc_count();
+        ReplayRunner::run(replay, stats, false);
+        long long allocs = process_alloc_count() - allocsStart;
+        result.allocs = rep == 0 ? allocs : std::min(result.allocs, allocs);
+        result.checksum = stats.checksum;
+        result.ticksRun = stats.ticksRun;
+
+        // The minimum of each tick over the runs filters out preemptions and the like
+        if (rep == 0)
+        {
+            minNs = stats.tickNs;
+        }
+        for (size_t tick = 0; tick < minNs.size(); ++tick)
+        {
+            minNs[tick] = std::min(minNs[tick], stats.tickNs[tick]);
+        }
+    }
+
+    double ns = 0;
+    for (double tickNs : minNs)
+    {
+        ns += tickNs;
+    }
+    result.ticksPerSec = ns > 0 ? result.ticksRun * 1e9 / ns : 0;
+    return result;
+}
+
+/**
+ * @brief Compare `result` with `baseline` and print the outcome.
+ * @return `true` if all checks passed.
+ */
+static bool check (
+    const Measurement &result, const Measurement &baseline, double tolerance
+)
+{
+    double change = baseline.ticksPerSec > 0
+        ? result.ticksPerSec / baseline.ticksPerSec - 1 : 0;
+    printf(
+        "%-24s %08x %6d ticks %6lld allocs %10.0f ticks/s %+6.1f%%",
+        result.name.c_str(), result.checksum, result.ticksRun, result.allocs,
+        result.ticksPerSec, change * 100
+    );
+
+    bool passed = true;
+    if (result.checksum != baseline.checksum || result.ticksRun != baseline.ticksRun)
+    {
+        printf(
+            "  DIVERGED from %08x after %d ticks", baseline.checksum,
+            baseline.ticksRun
+        );
+        passed = false;
+    }
+    if (result.allocs > baseline.allocs)
+    {
+        printf("  ALLOCS above %lld", baseline.allocs);
+        passed = false;
+    }
+    if (change < -tolerance)
+    {
+        printf("  SLOWER than the %.0f%% tolerance", tolerance * 100);
+        passed = false;
+    }
+    printf("\n");
+    return passed;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string dir = "replays";
+    int reps = DEFAULT_REPS;
+    double tolerance = DEFAULT_TOLERANCE;
+    bool update = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--update") == 0)
+        {
+            update = true;
+        }
+        else if (i + 1 == argc)
+        {
+            break;
+        }
+        else if (strcmp(argv[i], "--dir") == 0)
+        {
+            dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--reps") == 0)
+        {
+            reps = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0)
+        {
+            tolerance = std::max(0.0, atof(argv[++i]));
+        }
+    }
+
+    int exitCode = 0;
+    try
+    {
+        Logger::get()->init("replay_check_log.txt");
+
+        std::vector<std::string> names;
+        for (const auto &entry : std::filesystem::directory_iterator(dir))
+        {
+            if (entry.path().extension() == ".replay")
+            {
+                names.push_back(entry.path().filename().string());
+            }
+        }
+        std::sort(names.begin(), names.end());
+        std::string baselinesPath = dir + "/" + BASELINES_NAME;
+        std::vector<Measurement> baselines = load_baselines(baselinesPath);
+
+        ReplayRunner::init();
+        std::vector<Measurement> results;
+        int failed = 0;
+        for (const std::string &name : names)
+        {
+            Replay replay;
+            replay.load(dir + "/" + name);
+            results.push_back(measure(name, replay, reps));
+            if (update)
+            {
+                continue;
+            }
+
+            auto baseline = std::find_if(
+                baselines.begin(), baselines.end(),
+                [&name](const Measurement &baseline){ return baseline.name == name; }
+            );
+            if (baseline == baselines.end())
+            {
+                printf("%-24s no baseline, run with --update\n", name.c_str());
+                ++failed;
+            }
+            else if (!check(results.back(), *baseline, tolerance))
+            {
+                ++failed;
+            }
+        }
+        ReplayRunner::free();
+
+        if (update)
+        {
+            save_baselines(baselinesPath, results);
+            printf(
+                "Wrote %zu baselines to %s\n", results.size(), baselinesPath.c_str()
+            );
+        }
+        else
+        {
+            for (const Measurement &baseline : baselines)
+            {
+                const std::string &name = baseline.name;
+                if (std::find(names.begin(), names.end(), name) == names.end())
+                {
+                    printf("%-24s replay of the baseline missing\n", name.c_str());
+                    ++failed;
+                }
+            }
+            printf("%zu replays checked, %d failed\n", names.size(), failed);
+            exitCode = failed ? 1 : 0;
+        }
+    }
+    catch (const Exception &e)
+    {
+        printf("%s\n", e.what().c_str());
+        exitCode = e.get_exit_code();
+    }
+    catch (const std::exception &e)
+    {
+        printf("Standard exception: %s\n", e.what());
+        exitCode = -1;
+    }
+
+    Logger::get()->free();
+
+    return exitCode;
+}